@@ -5,6 +5,7 @@
 #  SPEECHD_INCLUDE_DIR, where to find libspeechd.h
 #  SPEECHD_LIBRARIES, the libraries needed to link against speechd
 #  SPEECHD_FOUND, If false, speechd was not found
+#  SPEECHD_VERSION, version of speechd, if libspeechd_version.h is installed
 #
 # Redistribution and use is allowed according to the terms of the BSD license.
 # For details see the accompanying COPYING-CMAKE-SCRIPTS file.
@@ -13,5 +14,14 @@ find_path(SPEECHD_INCLUDE_DIR libspeechd.h PATH_SUFFIXES speech-dispatcher)
 
 find_library(SPEECHD_LIBRARIES NAMES speechd)
 
+if (SPEECHD_INCLUDE_DIR AND EXISTS "${SPEECHD_INCLUDE_DIR}/libspeechd_version.h")
+  file(STRINGS "${SPEECHD_INCLUDE_DIR}/libspeechd_version.h" _speechd_version_lines
+       REGEX "#define LIBSPEECHD_M[A-Z]+_VERSION")
+  string(REGEX REPLACE ".*MAJOR_VERSION[ \t]+([0-9]+).*" "\\1" _speechd_major "${_speechd_version_lines}")
+  string(REGEX REPLACE ".*MINOR_VERSION[ \t]+([0-9]+).*" "\\1" _speechd_minor "${_speechd_version_lines}")
+  string(REGEX REPLACE ".*MICRO_VERSION[ \t]+([0-9]+).*" "\\1" _speechd_micro "${_speechd_version_lines}")
+  set(SPEECHD_VERSION "${_speechd_major}.${_speechd_minor}.${_speechd_micro}")
+endif (SPEECHD_INCLUDE_DIR AND EXISTS "${SPEECHD_INCLUDE_DIR}/libspeechd_version.h")
+
 include(FindPackageHandleStandardArgs)
 find_package_handle_standard_args(Speechd REQUIRED_VARS SPEECHD_INCLUDE_DIR SPEECHD_LIBRARIES)
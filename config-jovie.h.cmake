@@ -1,2 +1,3 @@
 #cmakedefine SPEECHD_FOUND ${SPEECHD_FOUND}
+#cmakedefine SPEECHD_VERSION "${SPEECHD_VERSION}"
 
@@ -28,6 +28,7 @@
 // Qt includes.
 #include <QtXml/QDomDocument>
 #include <QtCore/QFile>
+#include <QtCore/QtConcurrentRun>
 
 // KDE includes.
 #include <kdebug.h>
@@ -41,13 +42,17 @@
 #include "filterproc.h"
 #include "talkercode.h"
 #include "cdataescaper.h"
+#include "filewatcher.h"
 
 /**
  * Constructor.
  */
 StringReplacerProc::StringReplacerProc( QObject *parent, QVariantList list) :
-    KttsFilterProc(parent, list)
+    KttsFilterProc(parent, list),
+    m_reloadPending(false),
+    m_wasModified(false)
 {
+    connect(&m_loader, SIGNAL(finished()), this, SLOT(slotWordListLoaded()));
 }
 
 /**
@@ -55,8 +60,9 @@ StringReplacerProc::StringReplacerProc( QObject *parent, QVariantList list) :
  */
 /*virtual*/ StringReplacerProc::~StringReplacerProc()
 {
-    m_matchList.clear();
-    m_substList.clear();
+    m_loader.waitForFinished();
+    if ( !m_wordListFile.isEmpty() )
+        FileWatcher::self()->removeFile( m_wordListFile );
 }
 
 bool StringReplacerProc::init(KConfig* c, const QString& configGroup){
@@ -68,24 +74,46 @@ bool StringReplacerProc::init(KConfig* c, const QString& configGroup){
     KConfigGroup config( c, configGroup );
     wordsFilename = config.readEntry( "WordListFile", wordsFilename );
 
+    // Watch the file even if it cannot be read yet, so it is picked up once it can.
+    if ( wordsFilename != m_wordListFile )
+    {
+        FileWatcher* watcher = FileWatcher::self();
+        if ( m_wordListFile.isEmpty() )
+            connect( watcher, SIGNAL(fileChanged(QString)), this, SLOT(slotFileChanged(QString)) );
+        else
+            watcher->removeFile( m_wordListFile );
+        m_wordListFile = wordsFilename;
+        watcher->addFile( m_wordListFile );
+    }
+
+    m_loader.waitForFinished();
+    m_wordList = loadWordList( m_wordListFile );
+    return !m_wordList.isNull();
+}
+
+/**
+ * Parses and compiles a word list file.
+ * @param wordsFilename     The word list file.
+ * @return                  The compiled word list, or null if the file cannot be read.
+ */
+/*static*/ StringReplacerProc::WordListPtr StringReplacerProc::loadWordList(const QString& wordsFilename)
+{
     // Open existing word list.
     QFile file( wordsFilename );
     if ( !file.open( QIODevice::ReadOnly ) )
     {
-        //kDebug() << "StringReplacerProc::init: couldn't open file " << wordsFilename;
-        return false;
+        //kDebug() << "StringReplacerProc::loadWordList: couldn't open file " << wordsFilename;
+        return WordListPtr();
     }
     QDomDocument doc( QLatin1String( "" ) );
     if ( !doc.setContent( &file ) ) {
-        //kDebug() << "StringReplacerProc::init: couldn't get xml from file " << wordsFilename;
+        //kDebug() << "StringReplacerProc::loadWordList: couldn't get xml from file " << wordsFilename;
         file.close();
-        return false;
+        return WordListPtr();
     }
     file.close();
 
-    // Clear list.
-    m_matchList.clear();
-    m_substList.clear();
+    WordList* wordList = new WordList;
 
     // Name setting.
     // QDomNodeList nameList = doc.elementsByTagName( "name" );
@@ -94,23 +122,21 @@ bool StringReplacerProc::init(KConfig* c, const QString& configGroup){
 
     // Language Codes setting.  List may be single element of comma-separated values,
     // or multiple elements.
-    m_languageCodeList.clear();
     QDomNodeList languageList = doc.elementsByTagName( QLatin1String( "language-code" ) );
     for ( int ndx=0; ndx < languageList.count(); ++ndx )
     {
         QDomNode languageNode = languageList.item( ndx );
-        m_languageCodeList += languageNode.toElement().text().split( QLatin1Char(','), QString::SkipEmptyParts);
+        wordList->languageCodeList += languageNode.toElement().text().split( QLatin1Char(','), QString::SkipEmptyParts);
     }
 
     // AppId.  Apply this filter only if DCOP appId of application that queued
     // the text contains this string.  List may be single element of comma-separated values,
     // or multiple elements.
-    m_appIdList.clear();
     QDomNodeList appIdList = doc.elementsByTagName( QLatin1String( "appid" ) );
     for ( int ndx=0; ndx < appIdList.count(); ++ndx )
     {
         QDomNode appIdNode = appIdList.item( ndx );
-        m_appIdList += appIdNode.toElement().text().split( QLatin1Char( ',' ), QString::SkipEmptyParts);
+        wordList->appIdList += appIdNode.toElement().text().split( QLatin1Char( ',' ), QString::SkipEmptyParts);
     }
 
     // Word list.
@@ -157,11 +183,11 @@ bool StringReplacerProc::init(KConfig* c, const QString& configGroup){
             // Add Regular Expression to list (if valid).
         if ( rx.isValid() )
         {
-            m_matchList.append( rx );
-            m_substList.append( subst );
+            wordList->matchList.append( rx );
+            wordList->substList.append( subst );
         }
     }
-    return true;
+    return WordListPtr( wordList );
 }
 
 /**
@@ -178,6 +204,10 @@ bool StringReplacerProc::init(KConfig* c, const QString& configGroup){
 {
     Q_UNUSED(talkerCode);
     m_wasModified = false;
+    // Hold on to the word list, a new version may be swapped in meanwhile.
+    const WordListPtr wordList = m_wordList;
+    if ( !wordList )
+        return inputText;
     // If language doesn't match, return input unmolested.
     //if ( !m_languageCodeList.isEmpty() )
     //{
@@ -196,15 +226,15 @@ bool StringReplacerProc::init(KConfig* c, const QString& configGroup){
     //    }
     //}
     // If appId doesn't match, return input unmolested.
-    if ( !m_appIdList.isEmpty() )
+    if ( !wordList->appIdList.isEmpty() )
     {
          //kDebug() << "StringReplacerProc::convert: converting " << inputText << " if appId "
          //    << appId << " matches " << m_appIdList << endl;
         bool found = false;
         QString appIdStr = appId;
-        for ( int ndx=0; ndx < m_appIdList.count(); ++ndx )
+        for ( int ndx=0; ndx < wordList->appIdList.count(); ++ndx )
         {
-            if ( appIdStr.contains(m_appIdList[ndx]) )
+            if ( appIdStr.contains(wordList->appIdList[ndx]) )
             {
                 found = true;
                 break;
@@ -217,11 +247,11 @@ bool StringReplacerProc::init(KConfig* c, const QString& configGroup){
         }
     }
     QString newText = inputText;
-    const int listCount = m_matchList.count();
+    const int listCount = wordList->matchList.count();
     for ( int index = 0; index < listCount; ++index )
     {
-        //kDebug() << "newtext = " << newText << " matching " << m_matchList[index].pattern() << " replacing with " << m_substList[index];
-        newText.replace( m_matchList[index], m_substList[index] );
+        //kDebug() << "newtext = " << newText << " matching " << wordList->matchList[index].pattern() << " replacing with " << wordList->substList[index];
+        newText.replace( wordList->matchList[index], wordList->substList[index] );
     }
     m_wasModified = true;
     return newText;
@@ -233,3 +263,29 @@ bool StringReplacerProc::init(KConfig* c, const QString& configGroup){
  */
 /*virtual*/ bool StringReplacerProc::wasModified() { return m_wasModified; }
 
+
+void StringReplacerProc::slotFileChanged(const QString& path)
+{
+    if ( path != m_wordListFile )
+        return;
+    if ( m_loader.isRunning() )
+    {
+        m_reloadPending = true;
+        return;
+    }
+    kDebug() << "StringReplacerProc::slotFileChanged: compiling " << path;
+    m_loader.setFuture( QtConcurrent::run( &StringReplacerProc::loadWordList, m_wordListFile ) );
+}
+
+void StringReplacerProc::slotWordListLoaded()
+{
+    WordListPtr wordList = m_loader.result();
+    // A word list being saved may not parse yet; keep the last good one.
+    if ( wordList )
+        m_wordList = wordList;
+    if ( m_reloadPending )
+    {
+        m_reloadPending = false;
+        slotFileChanged( m_wordListFile );
+    }
+}
@@ -30,6 +30,8 @@
 #include <QtCore/QTextStream>
 #include <QtCore/QRegExp>
 #include <QtCore/QStringList>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QFutureWatcher>
 
 // KTTS includes.
 #include "filterproc.h"
@@ -77,16 +79,38 @@ public:
      */
     virtual bool wasModified();
 
+private slots:
+    void slotFileChanged(const QString &path);
+    void slotWordListLoaded();
+
 private:
-    // Language codes supported by the filter.
-    QStringList m_languageCodeList;
-    // If not empty, apply filter only to apps containing one or more of these strings.
-    QStringList m_appIdList;
-
-    // List of regular expressions to match.
-    QList<QRegExp> m_matchList;
-    // List of substitutions to replace matches.
-    QList<QString> m_substList;
+    // A compiled word list.  Never changed once loaded, so a new version
+    // can be swapped in while the old one is still referenced.
+    struct WordList
+    {
+        // Language codes supported by the filter.
+        QStringList languageCodeList;
+        // If not empty, apply filter only to apps containing one or more of these strings.
+        QStringList appIdList;
+        // List of regular expressions to match.
+        QList<QRegExp> matchList;
+        // List of substitutions to replace matches.
+        QList<QString> substList;
+    };
+    typedef QSharedPointer<const WordList> WordListPtr;
+
+    // Parses and compiles a word list file.  Null if it cannot be read.
+    // Safe to run in a worker thread.
+    static WordListPtr loadWordList(const QString &wordsFilename);
+
+    // The word list file, watched for changes.
+    QString m_wordListFile;
+    // The word list in use.  Replaced between calls to convert.
+    WordListPtr m_wordList;
+    // Compiles a changed word list in the background.
+    QFutureWatcher<WordListPtr> m_loader;
+    // The file changed again while it was being compiled.
+    bool m_reloadPending;
     // True if this filter did anything to the text.
     bool m_wasModified;
 };
@@ -35,6 +35,7 @@
 
 // KTTS includes.
 #include "talkercode.h"
+#include "talkerchooserrule.h"
 
 TalkerChooserProc::TalkerChooserProc( QObject *parent, const QVariantList& args ) :
     KttsFilterProc(parent, args) 
@@ -51,6 +52,7 @@ TalkerChooserProc::~TalkerChooserProc()
 bool TalkerChooserProc::init(KConfig* c, const QString& configGroup){
     // kDebug() << "PlugInProc::init: Running";
     KConfigGroup config( c, configGroup );
+    m_name = config.readEntry( "UserFilterName" );
     m_re = config.readEntry( "MatchRegExp" );
     m_appIdList = config.readEntry( "AppIDs", QStringList() );
     m_chosenTalkerCode = TalkerCode(config.readEntry("TalkerCode"), false);
@@ -104,3 +106,12 @@ bool TalkerChooserProc::init(KConfig* c, const QString& configGroup){
     *talkerCode = m_chosenTalkerCode;
     return inputText;
 }
+
+/*virtual*/ bool TalkerChooserProc::talkerChooserRule(TalkerChooserRule *rule)
+{
+    rule->name = m_name;
+    rule->matchRegExp = m_re;
+    rule->appIds = m_appIdList;
+    rule->talkerCode = m_chosenTalkerCode;
+    return true;
+}
@@ -81,8 +81,17 @@ public:
      */
     virtual QString convert(const QString& inputText, TalkerCode* talkerCode, const QString& appId);
 
+    /**
+     * Returns the rule of this filter, so that FilterMgr can evaluate it
+     * together with the rules of the other talker choosers.
+     * @param rule      Receives the rule of the filter.
+     * @return          True.
+     */
+    virtual bool talkerChooserRule(TalkerChooserRule *rule);
+
 private:
 
+    QString         m_name;
     QString         m_re;
     QStringList     m_appIdList;
     TalkerCode      m_chosenTalkerCode;
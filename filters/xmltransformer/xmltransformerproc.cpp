@@ -41,6 +41,7 @@
 
 // KTTS includes.
 #include "filterproc.h"
+#include "stylesheetcache.h"
 
 /**
  * Constructor.
@@ -57,6 +58,7 @@ XmlTransformerProc::XmlTransformerProc( QObject *parent, const QVariantList& arg
 /*virtual*/ XmlTransformerProc::~XmlTransformerProc()
 {
     delete m_xsltProc;
+    if (!m_xsltFilePath.isEmpty()) StylesheetCache::self()->removeStylesheet(m_xsltFilePath);
     if (!m_inFilename.isEmpty()) QFile::remove(m_inFilename);
     if (!m_outFilename.isEmpty()) QFile::remove(m_outFilename);
 }
@@ -66,7 +68,15 @@ bool XmlTransformerProc::init(KConfig* c, const QString& configGroup)
     // kDebug() << "XmlTransformerProc::init: Running.";
     KConfigGroup config( c, configGroup );
     m_UserFilterName = config.readEntry( "UserFilterName" );
-    m_xsltFilePath = config.readEntry( "XsltFilePath" );
+    // The stylesheet is watched, so edits apply from the next job on.
+    QString xsltFilePath = config.readEntry( "XsltFilePath" );
+    if ( xsltFilePath != m_xsltFilePath )
+    {
+        StylesheetCache* cache = StylesheetCache::self();
+        if ( !m_xsltFilePath.isEmpty() ) cache->removeStylesheet( m_xsltFilePath );
+        m_xsltFilePath = xsltFilePath;
+        if ( !m_xsltFilePath.isEmpty() ) cache->addStylesheet( m_xsltFilePath );
+    }
     m_xsltprocPath = config.readEntry( "XsltprocPath" );
     m_rootElementList = config.readEntry( "RootElement", QStringList() );
     m_doctypeList = config.readEntry( "DocType", QStringList() );
@@ -222,7 +232,7 @@ bool XmlTransformerProc::asyncConvert(const QString& inputText, TalkerCode* talk
     m_xsltProc->setOutputChannelMode(KProcess::SeparateChannels);
     *m_xsltProc << m_xsltprocPath;
     *m_xsltProc << QLatin1String("-o") << m_outFilename  << QLatin1String("--novalid")
-            << m_xsltFilePath << m_inFilename;
+            << StylesheetCache::self()->stylesheetFile(m_xsltFilePath) << m_inFilename;
     // Warning: This won't compile under KDE 3.2.  See FreeTTS::argsToStringList().
     // kDebug() << "SSMLConvert::transform: executing command: " <<
     //     m_xsltProc->args() << endl;
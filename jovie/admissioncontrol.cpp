@@ -0,0 +1,137 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Rate limits and the pending text budget of the jobs Jovie accepts.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// AdmissionControl includes.
+#include "admissioncontrol.h"
+
+// Qt includes.
+#include <QtCore/QMap>
+#include <QtCore/QPair>
+
+AdmissionControl::AdmissionControl() :
+    m_pendingBytes(0)
+{
+}
+
+AdmissionControl::OverflowPolicy AdmissionControl::policy(const QString &name)
+{
+    if (name == QLatin1String("drop-oldest"))
+        return DropOldest;
+    if (name == QLatin1String("drop-lowest-priority"))
+        return DropLowestPriority;
+    return Reject;
+}
+
+bool AdmissionControl::takeToken(const QString &appId, int rate, int burst, qint64 now)
+{
+    QHash<QString, Bucket>::iterator it = m_buckets.find(appId);
+    if (it == m_buckets.end())
+    {
+        Bucket bucket;
+        bucket.tokens = qMax(1, burst);
+        bucket.stamp = now;
+        it = m_buckets.insert(appId, bucket);
+    }
+    else
+    {
+        it->tokens = qMin(double(qMax(1, burst)), it->tokens + (now - it->stamp) * rate / 1000.0);
+        it->stamp = now;
+    }
+    if (it->tokens < 1.0)
+        return false;
+    it->tokens -= 1.0;
+    return true;
+}
+
+void AdmissionControl::forget(const QString &appId)
+{
+    m_buckets.remove(appId);
+}
+
+void AdmissionControl::add(int jobNum, const QString &appId, KSpeech::JobPriority priority, qint64 bytes, bool dispatched)
+{
+    Pending pending;
+    pending.appId = appId;
+    pending.priority = priority;
+    pending.bytes = bytes;
+    pending.dispatched = dispatched;
+    remove(jobNum);
+    m_pending.insert(jobNum, pending);
+    m_pendingBytes += bytes;
+}
+
+void AdmissionControl::setDispatched(int jobNum)
+{
+    QHash<int, Pending>::iterator it = m_pending.find(jobNum);
+    if (it != m_pending.end())
+        it->dispatched = true;
+}
+
+void AdmissionControl::remove(int jobNum)
+{
+    QHash<int, Pending>::iterator it = m_pending.find(jobNum);
+    if (it == m_pending.end())
+        return;
+    m_pendingBytes -= it->bytes;
+    m_pending.erase(it);
+}
+
+qint64 AdmissionControl::pendingBytes() const
+{
+    return m_pendingBytes;
+}
+
+bool AdmissionControl::makeRoom(qint64 bytes, qint64 maxBytes, OverflowPolicy policy,
+                                KSpeech::JobPriority priority, QList<int> *jobNums) const
+{
+    jobNums->clear();
+    qint64 excess = m_pendingBytes + bytes - maxBytes;
+    if (excess <= 0)
+        return true;
+    if (policy == Reject || bytes > maxBytes)
+        return false;
+
+    // Candidates in the order they are dropped.  Job numbers of waiting jobs
+    // grow with their age, so they order the jobs of one priority.
+    QMap<QPair<int, int>, qint64> candidates;
+    for (QHash<int, Pending>::const_iterator it = m_pending.constBegin(); it != m_pending.constEnd(); ++it)
+    {
+        if (it->dispatched)
+            continue;
+        if (policy == DropOldest)
+            candidates.insert(qMakePair(0, it.key()), it->bytes);
+        else if (it->priority >= priority)
+            candidates.insert(qMakePair(-int(it->priority), it.key()), it->bytes);
+    }
+    for (QMap<QPair<int, int>, qint64>::const_iterator it = candidates.constBegin();
+         it != candidates.constEnd() && excess > 0; ++it)
+    {
+        jobNums->append(it.key().second);
+        excess -= it.value();
+    }
+    if (excess > 0)
+    {
+        jobNums->clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,134 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Rate limits and the pending text budget of the jobs Jovie accepts.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef ADMISSIONCONTROL_H
+#define ADMISSIONCONTROL_H
+
+// Qt includes.
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QString>
+
+#include <kspeech.h>
+
+/**
+ * @class AdmissionControl
+ *
+ * Decides whether a new job is accepted.
+ *
+ * Every application has a token bucket.  It holds up to @e burst tokens and
+ * refills at @e rate tokens a second, and each job takes one.  An application
+ * with an empty bucket has its jobs refused until the bucket refills.
+ *
+ * The text of the jobs accepted and not yet ended is counted against a global
+ * budget.  When a new job does not fit, the overflow policy either refuses it
+ * or makes room by dropping jobs still waiting in Jovie's scheduler.  Jobs
+ * already handed to speech-dispatcher cannot be dropped one by one, so without
+ * the scheduler a job that does not fit is always refused.
+ */
+class AdmissionControl
+{
+public:
+    enum OverflowPolicy
+    {
+        Reject,                 /* refuse the new job */
+        DropOldest,             /* drop the oldest waiting jobs */
+        DropLowestPriority      /* drop waiting jobs of the lowest priority, not above the new job's */
+    };
+
+    AdmissionControl();
+
+    /**
+     * The policy named "reject", "drop-oldest" or "drop-lowest-priority".
+     * Reject for any other name.
+     */
+    static OverflowPolicy policy(const QString &name);
+
+    /**
+     * Takes a token from the bucket of an application.
+     * @param rate              Tokens a second.  Must be more than 0.
+     * @param burst             Size of the bucket.
+     * @param now               Milliseconds, from any fixed point in time.
+     * @return                  False if the bucket is empty.
+     */
+    bool takeToken(const QString &appId, int rate, int burst, qint64 now);
+
+    /**
+     * Drops the bucket of an application.
+     */
+    void forget(const QString &appId);
+
+    /**
+     * Counts a job accepted.
+     * @param bytes             Size of its text.
+     * @param dispatched        True if it went to speech-dispatcher already.
+     */
+    void add(int jobNum, const QString &appId, KSpeech::JobPriority priority, qint64 bytes, bool dispatched);
+
+    /**
+     * Notes that a job waiting in the scheduler went to speech-dispatcher.
+     */
+    void setDispatched(int jobNum);
+
+    /**
+     * Stops counting a job, once it ended.
+     */
+    void remove(int jobNum);
+
+    /**
+     * Size of the text of the jobs counted.
+     */
+    qint64 pendingBytes() const;
+
+    /**
+     * Chooses the waiting jobs to drop so a new job fits in the budget.
+     * @param bytes             Size of the text of the new job.
+     * @param maxBytes          The budget.
+     * @param priority          Priority of the new job.
+     * @param jobNums           Set to the jobs to drop.
+     * @return                  False if the job does not fit however many are
+     *                          dropped.  @p jobNums is then empty.
+     */
+    bool makeRoom(qint64 bytes, qint64 maxBytes, OverflowPolicy policy,
+                  KSpeech::JobPriority priority, QList<int> *jobNums) const;
+
+private:
+    struct Bucket
+    {
+        double tokens;
+        qint64 stamp;           /* when tokens was last brought up to date */
+    };
+
+    struct Pending
+    {
+        QString appId;
+        KSpeech::JobPriority priority;
+        qint64 bytes;
+        bool dispatched;
+    };
+
+    QHash<QString, Bucket> m_buckets;
+    QHash<int, Pending> m_pending;
+    qint64 m_pendingBytes;
+};
+
+#endif // ADMISSIONCONTROL_H
@@ -40,6 +40,8 @@ public:
         isApplicationPaused(false),
         autoConfigureTalkersOn(false),
         isSystemManager(false),
+        rateLimit(0),
+        rateBurst(0),
         jobList(),
         unregistered(false) {}
 
@@ -57,6 +59,8 @@ protected:
     QString ssmlFilterXsltFile;
     bool autoConfigureTalkersOn;
     bool isSystemManager;
+    int rateLimit;
+    int rateBurst;
     TJobList jobList;
     bool unregistered;
 };
@@ -88,6 +92,9 @@ bool AppData::autoConfigureTalkersOn() const { return d->autoConfigureTalkersOn;
 void AppData::setAutoConfigureTalkersOn(bool autoConfigureTalkersOn) { d->autoConfigureTalkersOn = autoConfigureTalkersOn; }
 bool AppData::isSystemManager() const { return d->isSystemManager; }
 void AppData::setIsSystemManager(bool isSystemManager) { d->isSystemManager = isSystemManager; }
+int AppData::rateLimit() const { return d->rateLimit; }
+int AppData::rateBurst() const { return d->rateBurst; }
+void AppData::setRateLimit(int rateLimit, int rateBurst) { d->rateLimit = qMax(0, rateLimit); d->rateBurst = qMax(0, rateBurst); }
 int AppData::lastJobNum() const
 {
     if (d->jobList.isEmpty())
@@ -99,6 +106,13 @@ TJobListPtr AppData::jobList() const { return &(d->jobList); }
 bool AppData::unregistered() const { return d->unregistered; }
 void AppData::setUnregistered(bool unregistered) { d->unregistered = unregistered; }
 
+int AppData::memoryUsage() const
+{
+    const int strings = d->appId.size() + d->applicationName.size() + d->defaultTalker.size() +
+        d->sentenceDelimiter.size() + d->htmlFilterXsltFile.size() + d->ssmlFilterXsltFile.size();
+    return sizeof(AppData) + sizeof(AppDataPrivate) + strings * sizeof(QChar);
+}
+
 /*
 void AppData::debugDump()
 {
@@ -26,12 +26,55 @@
 #define APPDATA_H
 
 // Qt includes.
-#include <QtCore/QList>
+#include <QtCore/QString>
 
 // KDE includes.
 #include <kspeech.h>
 
-typedef QList<int> TJobList;
+/**
+ * @class JobRing
+ *
+ * The latest job numbers of an application, oldest first.  Holds at most
+ * Capacity of them; appending to a full ring drops the oldest, so the
+ * bookkeeping of an application does not grow with the jobs it queues.
+ */
+class JobRing
+{
+public:
+    enum { Capacity = 32 };
+
+    JobRing() : m_first(0), m_count(0) {}
+
+    void append(int jobNum)
+    {
+        m_jobs[(m_first + m_count) % Capacity] = jobNum;
+        if (m_count < Capacity)
+            ++m_count;
+        else
+            m_first = (m_first + 1) % Capacity;
+    }
+    int at(int i) const { return m_jobs[(m_first + i) % Capacity]; }
+    int last() const { return at(m_count - 1); }
+    int count() const { return m_count; }
+    bool isEmpty() const { return m_count == 0; }
+    bool contains(int jobNum) const
+    {
+        for (int i = 0; i < m_count; ++i)
+        {
+            if (at(i) == jobNum)
+                return true;
+        }
+        return false;
+    }
+    void clear() { m_first = m_count = 0; }
+
+private:
+    int m_jobs[Capacity];
+    int m_first;
+    int m_count;
+};
+
+typedef JobRing TJobList;
 typedef TJobList* TJobListPtr;
 
 class AppDataPrivate;
@@ -199,6 +242,21 @@ public:
     */
     void setIsSystemManager(bool isSystemManager);
     
+    /**
+    * Returns the number of jobs a second the application may queue, and how
+    * many it may queue at once.  0 means the RateLimit and RateBurst of
+    * kttsdrc apply.
+    */
+    int rateLimit() const;
+    int rateBurst() const;
+
+    /**
+    * Sets the rate limit of the application.
+    * @param rateLimit      Jobs a second.  0 for the configured limit.
+    * @param rateBurst      Jobs at once.  0 for the configured burst.
+    */
+    void setRateLimit(int rateLimit, int rateBurst);
+
     /**
     * Return the JobNum of the last job queued by the application.
     * 0 if none.
@@ -206,8 +264,8 @@ public:
     int lastJobNum() const;
     
     /**
-    * List of jobs for this app.  Caller may add or delete jobs,
-    * but must not delete the list.
+    * The latest jobs of this app.  Caller may add jobs or clear the list,
+    * but must not delete it.
     */
     TJobListPtr jobList() const;
     
@@ -217,6 +275,11 @@ public:
     bool unregistered() const;
     void setUnregistered(bool unregistered);
 
+    /**
+    * Approximate bytes of memory used by this object.
+    */
+    int memoryUsage() const;
+
     // void debugDump();
 
 private:
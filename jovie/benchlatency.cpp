@@ -0,0 +1,125 @@
+#include <QtTest>
+#include <QtCore/QtEndian>
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusConnectionInterface>
+#include <QtDBus/QDBusMessage>
+#include <QtNetwork/QLocalSocket>
+
+#include <kstandarddirs.h>
+#include <qtest_kde.h>
+
+#include "benchlatency.h"
+
+// Opcodes of the local socket protocol, see SocketServer.
+enum { opSay = 1, opPing = 7, opSayReply = 0x81, opPong = 0x87 };
+
+static QDBusMessage kspeechCall(const char *method)
+{
+    return QDBusMessage::createMethodCall(QLatin1String("org.kde.KSpeech"), QLatin1String("/KSpeech"),
+        QLatin1String("org.kde.KSpeech"), QLatin1String(method));
+}
+
+static QByteArray int32(qint32 value)
+{
+    uchar bytes[4];
+    qToBigEndian<qint32>(value, bytes);
+    return QByteArray(reinterpret_cast<const char *>(bytes), 4);
+}
+
+void BenchLatency::initTestCase()
+{
+    m_socket = 0;
+    m_requestId = 0;
+    if (!QDBusConnection::sessionBus().interface()->isServiceRegistered(QLatin1String("org.kde.KSpeech")))
+        QSKIP("Jovie is not running", SkipAll);
+    m_socket = new QLocalSocket(this);
+    m_socket->connectToServer(KStandardDirs::locateLocal("socket", QLatin1String("jovie")));
+    if (!m_socket->waitForConnected(1000))
+    {
+        delete m_socket;
+        m_socket = 0;
+    }
+}
+
+void BenchLatency::cleanupTestCase()
+{
+    delete m_socket;
+    m_socket = 0;
+}
+
+qint32 BenchLatency::socketRequest(quint8 opcode, quint8 replyOpcode, const QByteArray &args)
+{
+    const qint32 requestId = ++m_requestId;
+    QByteArray frame = int32(1 + 4 + args.size());
+    frame += char(opcode);
+    frame += int32(requestId);
+    frame += args;
+    m_socket->write(frame);
+    m_socket->flush();
+
+    // Skip job events until the reply comes.
+    forever
+    {
+        while (m_socket->bytesAvailable() < 4)
+            if (!m_socket->waitForReadyRead(5000))
+                return -1;
+        uchar header[4];
+        m_socket->peek(reinterpret_cast<char *>(header), 4);
+        const quint32 length = qFromBigEndian<quint32>(header);
+        while (m_socket->bytesAvailable() < 4 + length)
+            if (!m_socket->waitForReadyRead(5000))
+                return -1;
+        const QByteArray reply = m_socket->read(4 + length);
+        if (quint8(reply.at(4)) != replyOpcode)
+            continue;
+        const uchar *data = reinterpret_cast<const uchar *>(reply.constData());
+        if (qFromBigEndian<qint32>(data + 5) != requestId)
+            continue;
+        return length >= 9 ? qFromBigEndian<qint32>(data + 9) : 0;
+    }
+}
+
+void BenchLatency::dbusPing()
+{
+    const QDBusMessage call = kspeechCall("isSpeaking");
+    QBENCHMARK {
+        QDBusMessage reply = QDBusConnection::sessionBus().call(call);
+        QCOMPARE(reply.type(), QDBusMessage::ReplyMessage);
+    }
+}
+
+void BenchLatency::socketPing()
+{
+    if (!m_socket)
+        QSKIP("The local socket is not enabled", SkipSingle);
+    QBENCHMARK {
+        QCOMPARE(socketRequest(opPing, opPong, QByteArray()), 0);
+    }
+}
+
+void BenchLatency::dbusSay()
+{
+    if (qgetenv("JOVIE_BENCH_SAY").isEmpty())
+        QSKIP("JOVIE_BENCH_SAY is not set", SkipSingle);
+    QDBusMessage call = kspeechCall("say");
+    call << QString::fromAscii("a") << 0;
+    QBENCHMARK {
+        QDBusMessage reply = QDBusConnection::sessionBus().call(call);
+        QCOMPARE(reply.type(), QDBusMessage::ReplyMessage);
+    }
+}
+
+void BenchLatency::socketSay()
+{
+    if (qgetenv("JOVIE_BENCH_SAY").isEmpty())
+        QSKIP("JOVIE_BENCH_SAY is not set", SkipSingle);
+    if (!m_socket)
+        QSKIP("The local socket is not enabled", SkipSingle);
+    const QByteArray args = int32(0) + QByteArray("a");
+    QBENCHMARK {
+        QVERIFY(socketRequest(opSay, opSayReply, args) != -1);
+    }
+}
+
+QTEST_KDEMAIN_CORE(BenchLatency)
+#include "benchlatency.moc"
@@ -0,0 +1,32 @@
+#ifndef BENCHLATENCY_H
+#define BENCHLATENCY_H
+
+#include <QObject>
+
+class QLocalSocket;
+
+/**
+ * Compares the round trip time of a request to a running Jovie over DBUS and
+ * over the local socket (LocalSocket=true in kttsdrc).  The pings measure the
+ * transport alone.  Set JOVIE_BENCH_SAY to also measure say, which speaks.
+ */
+class BenchLatency : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void dbusPing();
+    void socketPing();
+    void dbusSay();
+    void socketSay();
+
+private:
+    // Sends a frame and waits for the reply to it.
+    qint32 socketRequest(quint8 opcode, quint8 replyOpcode, const QByteArray &args);
+
+    QLocalSocket *m_socket;
+    qint32 m_requestId;
+};
+
+#endif
@@ -0,0 +1,118 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Suppresses messages repeated within a time window.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// DuplicateFilter includes.
+#include "duplicatefilter.h"
+
+// FNV-1a, 64 bit.
+static const quint64 FnvOffset = Q_UINT64_C(14695981039346656037);
+static const quint64 FnvPrime = Q_UINT64_C(1099511628211);
+
+static inline quint64 hashChar(quint64 hash, ushort c)
+{
+    hash = (hash ^ (c & 0xff)) * FnvPrime;
+    return (hash ^ (c >> 8)) * FnvPrime;
+}
+
+DuplicateFilter::DuplicateFilter()
+{
+}
+
+quint64 DuplicateFilter::fingerprint(const QString &appId, const QString &text)
+{
+    quint64 hash = FnvOffset;
+    const QChar *c = appId.constData();
+    const QChar *end = c + appId.length();
+    for (; c != end; ++c)
+        hash = hashChar(hash, c->unicode());
+    // Separates the application from the text.
+    hash = hashChar(hash, 0);
+
+    // Case folded, with runs of white space as one space and none at either end.
+    bool space = false;
+    bool started = false;
+    c = text.constData();
+    end = c + text.length();
+    for (; c != end; ++c)
+    {
+        if (c->isSpace())
+        {
+            space = started;
+            continue;
+        }
+        if (space)
+            hash = hashChar(hash, ' ');
+        space = false;
+        started = true;
+        hash = hashChar(hash, c->toCaseFolded().unicode());
+    }
+    return hash;
+}
+
+int DuplicateFilter::repeat(quint64 fingerprint)
+{
+    QHash<quint64, Entry>::iterator it = m_entries.find(fingerprint);
+    if (it == m_entries.end())
+        return 0;
+    ++it->count;
+    return it->jobNum;
+}
+
+void DuplicateFilter::add(quint64 fingerprint, int jobNum, qint64 expires, const QString &appId, const QString &text)
+{
+    Entry entry;
+    entry.jobNum = jobNum;
+    entry.count = 0;
+    if (!text.isEmpty())
+    {
+        entry.appId = appId;
+        entry.text = text;
+    }
+    m_entries.insert(fingerprint, entry);
+    m_expiries.enqueue(qMakePair(expires, fingerprint));
+}
+
+void DuplicateFilter::expire(qint64 now, QList<Repeat> *repeats)
+{
+    // Windows may differ after a change of the configuration, so an entry
+    // can expire a little late, but never early.
+    while (!m_expiries.isEmpty() && m_expiries.head().first <= now)
+    {
+        QHash<quint64, Entry>::iterator it = m_entries.find(m_expiries.dequeue().second);
+        if (it == m_entries.end())
+            continue;
+        if (repeats && it->count > 0 && !it->text.isEmpty())
+        {
+            Repeat repeat;
+            repeat.appId = it->appId;
+            repeat.text = it->text;
+            repeat.count = it->count;
+            repeats->append(repeat);
+        }
+        m_entries.erase(it);
+    }
+}
+
+qint64 DuplicateFilter::nextExpiry() const
+{
+    return m_expiries.isEmpty() ? -1 : m_expiries.head().first;
+}
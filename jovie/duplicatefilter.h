@@ -0,0 +1,101 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Suppresses messages repeated within a time window.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef DUPLICATEFILTER_H
+#define DUPLICATEFILTER_H
+
+// Qt includes.
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QPair>
+#include <QtCore/QQueue>
+#include <QtCore/QString>
+
+/**
+ * @class DuplicateFilter
+ *
+ * Remembers the messages seen in the last few seconds by a 64 bit fingerprint
+ * of the application and the text, so a repeat is recognized by hashing it,
+ * without filtering or even copying it.  Case and runs of white space do not
+ * count, so "New mail" and "new  mail" are the same message.
+ *
+ * A message is remembered from when it is first seen until its window ends;
+ * repeats meanwhile are counted, but do not make the window longer.
+ */
+class DuplicateFilter
+{
+public:
+    /**
+     * A message repeated within its window.
+     */
+    struct Repeat
+    {
+        QString appId;
+        QString text;
+        int count;              /* repeats after the first */
+    };
+
+    DuplicateFilter();
+
+    static quint64 fingerprint(const QString &appId, const QString &text);
+
+    /**
+     * Counts a repeat of a message.
+     * @return                  Job number of the first, or 0 if the message
+     *                          was not seen within its window.
+     */
+    int repeat(quint64 fingerprint);
+
+    /**
+     * Remembers a message.
+     * @param expires           When its window ends, in ms.
+     * @param text              The text, if its repeats are to be reported.
+     */
+    void add(quint64 fingerprint, int jobNum, qint64 expires, const QString &appId, const QString &text);
+
+    /**
+     * Forgets the messages whose window ended.
+     * @param repeats           If given, appended the repeated messages forgotten
+     *                          that were added with their text.
+     */
+    void expire(qint64 now, QList<Repeat> *repeats = 0);
+
+    /**
+     * When the window of the first message remembered ends.  -1 if none.
+     */
+    qint64 nextExpiry() const;
+
+private:
+    struct Entry
+    {
+        int jobNum;
+        int count;
+        QString appId;
+        QString text;
+    };
+
+    QHash<quint64, Entry> m_entries;
+    /* Expiry and fingerprint of the entries, oldest first. */
+    QQueue<QPair<qint64, quint64> > m_expiries;
+};
+
+#endif // DUPLICATEFILTER_H
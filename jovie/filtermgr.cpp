@@ -33,9 +33,11 @@
 #include <kdebug.h>
 #include <kconfig.h>
 #include <kconfiggroup.h>
-#include <kpluginloader.h>
-#include <ksharedconfig.h>
-#include <kservicetypetrader.h>
+
+// KTTS includes.
+#include "talkercode.h"
+#include "filterplugins.h"
+#include "jovieconfig.h"
 
 /**
  * Constructor.
@@ -46,6 +48,7 @@ FilterMgr::FilterMgr( QObject *parent) :
     // kDebug() << "FilterMgr::FilterMgr: Running";
     m_state = fsIdle;
     m_talkerCode = 0;
+    m_talkerChooserPosition = -1;
 }
 
 /**
@@ -54,7 +57,9 @@ FilterMgr::FilterMgr( QObject *parent) :
 FilterMgr::~FilterMgr()
 {
     // kDebug() << "FilterMgr::~FilterMgr: Running";
-    qDeleteAll(m_filterList);
+    foreach (const FilterEntry& entry, m_entries)
+        delete entry.proc;
+    m_entries.clear();
     m_filterList.clear();
 }
 
@@ -64,53 +69,94 @@ FilterMgr::~FilterMgr()
  */
 bool FilterMgr::init()
 {
-    // Load each of the filters and initialize.
-    KSharedConfig::Ptr pConfig = KSharedConfig::openConfig( QLatin1String( "kttsdrc" ) );
-    KConfigGroup config( pConfig, "General");
-    KConfig* rawconfig = new KConfig(QLatin1String( "kttsdrc" ));
-    QStringList filterIDsList = config.readEntry("FilterIDs", QStringList());
-    kDebug() << "FilterMgr::init: FilterIDs = " << filterIDsList;
-
-    if ( !filterIDsList.isEmpty() )
+    reload();
+    return true;
+}
+
+/**
+ * Rereads the filter configuration, loading only the filters that changed.
+ * @param filterId        ID of a filter to load again even if its settings did not change.
+ * @return                Number of filters loaded or removed.
+ */
+int FilterMgr::reload(const QString& filterId)
+{
+    ConfigSnapshotPtr snapshot = JovieConfig::Instance()->snapshot();
+    kDebug() << "FilterMgr::reload: snapshot" << snapshot->generation();
+
+    QList<FilterEntry> entries;
+    int changed = 0;
+    foreach (const ConfigSnapshot::Filter& filter, snapshot->filters())
     {
-        QStringList::ConstIterator itEnd = filterIDsList.constEnd();
-        for (QStringList::ConstIterator it = filterIDsList.constBegin(); it != itEnd; ++it)
+        if (!filter.enabled && !filter.isSbd)
+            continue;
+
+        // Keep the filter if it is loaded with the same settings.
+        int loaded = 0;
+        while (loaded < m_entries.count() && m_entries.at(loaded).id != filter.id)
+            ++loaded;
+        if (loaded < m_entries.count())
         {
-            QString filterID = *it;
-            QString groupName = QLatin1String( "Filter_" ) + filterID;
-            KConfigGroup thisgroup = pConfig->group(groupName);
-            QString desktopEntryName = thisgroup.readEntry( "DesktopEntryName" );
-            // If a DesktopEntryName is not in the config file, it was configured before
-            // we started using them, when we stored translated plugin names instead.
-            // Try to convert the translated plugin name to a DesktopEntryName.
-            // DesktopEntryNames are better because user can change their desktop language
-            // and DesktopEntryName won't change.
-            if (desktopEntryName.isEmpty())
+            FilterEntry entry = m_entries.takeAt(loaded);
+            if (filter.id != filterId && entry.settings == filter.settings)
             {
-                QString filterPlugInName = thisgroup.readEntry("PlugInName", QString());
-                // See if the translated name will untranslate.  If not, well, sorry.
-                desktopEntryName = FilterNameToDesktopEntryName(filterPlugInName);
-                // Record the DesktopEntryName from now on.
-                if (!desktopEntryName.isEmpty())
-                    thisgroup.writeEntry("DesktopEntryName", desktopEntryName);
+                entries.append(entry);
+                continue;
             }
-            if (thisgroup.readEntry("Enabled",false) || thisgroup.readEntry("IsSBD",false))
+            delete entry.proc;
+        }
+
+        kDebug() << "FilterMgr::reload: loading filterID = " << filter.id;
+        ++changed;
+        KttsFilterProc* filterProc = loadFilterPlugin( filter.desktopEntryName );
+        if ( filterProc )
+        {
+            // The snapshot only has the parsed settings, so hand them to the
+            // plugin in a config of its own.
+            KConfig config( QString(), KConfig::SimpleConfig );
+            KConfigGroup group( &config, filter.groupName );
+            QMap<QString,QString>::ConstIterator it = filter.settings.constBegin();
+            for ( ; it != filter.settings.constEnd(); ++it )
+                group.writeEntry( it.key(), it.value() );
+            filterProc->init( &config, filter.groupName );
+            FilterEntry entry;
+            entry.id = filter.id;
+            entry.settings = filter.settings;
+            entry.proc = filterProc;
+            if ( filterProc->talkerChooserRule( &entry.rule ) )
             {
-                kDebug() << "FilterMgr::init: filterID = " << filterID;
-                KttsFilterProc* filterProc = loadFilterPlugin( desktopEntryName );
-                if ( filterProc )
-                {
-                    filterProc->init( rawconfig, groupName );
-                    m_filterList.append( filterProc );
-                }
-                //if (thisgroup.readEntry("DocType").contains("html") ||
-                //    thisgroup.readEntry("RootElement").contains("html"))
-                    //m_supportsHTML = true;
+                entry.proc = 0;
+                delete filterProc;
             }
+            entries.append( entry );
+        }
+    }
+
+    // What is left was removed or disabled.
+    changed += m_entries.count();
+    foreach (const FilterEntry& entry, m_entries)
+        delete entry.proc;
+    m_entries = entries;
+    rebuildFilterList();
+    return changed;
+}
+
+// Rebuilds the filter list and talker chooser rules from the entries.
+void FilterMgr::rebuildFilterList()
+{
+    m_filterList.clear();
+    m_talkerChooserRules.clear();
+    m_talkerChooserPosition = -1;
+    foreach (const FilterEntry& entry, m_entries)
+    {
+        if ( entry.proc )
+            m_filterList.append( entry.proc );
+        else
+        {
+            if ( m_talkerChooserRules.isEmpty() )
+                m_talkerChooserPosition = m_filterList.count();
+            m_talkerChooserRules.append( entry.rule );
         }
     }
-    delete rawconfig;
-    return true;
 }
 
 /**
@@ -141,6 +187,8 @@ QString FilterMgr::convert(const QString& inputText, TalkerCode* talkerCode, con
 void FilterMgr::nextFilter()
 {
     ++m_filterIndex;
+    if (m_filterIndex == m_talkerChooserPosition)
+        chooseTalker();
     if (m_filterIndex == m_filterList.count())
     {
         m_state = fsFinished;
@@ -152,69 +200,36 @@ void FilterMgr::nextFilter()
         kDebug() << "FilterMgr::nextFilter: Filter# " << m_filterIndex << " modified the text.";
 }
 
+// Applies the talker chooser rules to the text being filtered.
+void FilterMgr::chooseTalker()
+{
+    int ndx = m_talkerChooserRules.match( m_text, m_appId, &m_lastTalkerChoice );
+    if ( ndx >= 0 && m_talkerCode )
+        *m_talkerCode = m_talkerChooserRules.at(ndx).talkerCode;
+    kDebug() << "FilterMgr::chooseTalker: " << m_lastTalkerChoice;
+}
+
+/**
+ * Which talker chooser rule picked the talker in the last conversion, and why.
+ */
+QString FilterMgr::lastTalkerChoice() const
+{
+    return m_lastTalkerChoice;
+}
+
 // Loads the processing plug in for a filter plug in given its DesktopEntryName.
 KttsFilterProc* FilterMgr::loadFilterPlugin(const QString& desktopEntryName)
 {
     // kDebug() << "FilterMgr::loadFilterPlugin: Running";
-
-    // Find the plugin.
-    KService::List offers = KServiceTypeTrader::self()->query(QLatin1String( "Jovie/FilterPlugin" ),
-        QString(QLatin1String( "DesktopEntryName == '%1'" )).arg(desktopEntryName));
-
-    if (offers.count() == 1)
-    {
-        // When the entry is found, load the plug in
-        // First create a factory for the library
-        KPluginLoader loader(offers[0]->library());
-        KPluginFactory* factory = loader.factory();
-        if (!factory) {
-            // Something went wrong, returning null.
-            kDebug() << "FilterMgr::loadFilterPlugin: Unable to create Factory object for plugin "
-                << desktopEntryName << endl;
-            return NULL;
-        } else {
-            KttsFilterProc *plugIn = factory->create<KttsFilterProc>();
-            if (plugIn) {
-                return plugIn;
-            } else {
-                // Something went wrong, returning null.
-                kDebug() << "FilterMgr::loadFilterPlugin: Unable to instantiate "
-                            << "KttsFilterProc class for plugin " << desktopEntryName;
-                return NULL;
-            }
-        }
-        //KLibFactory *factory = KLibLoader::self()->factory(offers[0]->library().toLatin1());
-        //if(factory){
-        //    // If the factory is created successfully, instantiate the KttsFilterConf class for the
-        //    // specific plug in to get the plug in configuration object.
-        //    KttsFilterProc *plugIn =
-        //            KLibLoader::createInstance<KttsFilterProc>(
-        //            offers[0]->library().toLatin1(), NULL, QStringList(offers[0]->library().toLatin1()),
-        //     &errorNo);
-        //    if(plugIn){
-        //        // If everything went ok, return the plug in pointer.
-        //        // kDebug() << "FilterMgr::loadFilterPlugin: plugin " << offers[0]->library().toLatin1() << " loaded successfully.";
-        //        return plugIn;
-        //    } else {
-        //        // Something went wrong, returning null.
-        //        kDebug() << "FilterMgr::loadFilterPlugin: Unable to instantiate KttsFilterProc class for plugin " << desktopEntryName << " error: " << errorNo;
-        //        return NULL;
-        //    }
-        //} else {
-        //    // Something went wrong, returning null.
-        //    kDebug() << "FilterMgr::loadFilterPlugin: Unable to create Factory object for plugin "
-        //        << desktopEntryName << endl;
-        //    return NULL;
-        //}
-    }
-    // The plug in was not found (unexpected behaviour, returns null).
-    kDebug() << "FilterMgr::loadFilterPlugin: KTrader did not return an offer for plugin "
-         << desktopEntryName << endl;
-    return NULL;
+    KttsFilterProc *plugIn = FilterPlugins::self()->create<KttsFilterProc>(desktopEntryName);
+    if (!plugIn)
+        kDebug() << "FilterMgr::loadFilterPlugin: Unable to instantiate "
+                    << "KttsFilterProc class for plugin " << desktopEntryName;
+    return plugIn;
 }
 
 /**
- * Uses KTrader to convert a translated Filter Plugin Name to DesktopEntryName.
+ * Converts a translated Filter Plugin Name to DesktopEntryName.
  * @param name                   The translated plugin name.  From Name= line in .desktop file.
  * @return                       DesktopEntryName.  The name of the .desktop file (less .desktop).
  *                               QString() if not found.
@@ -222,12 +237,5 @@ KttsFilterProc* FilterMgr::loadFilterPlugin(const QString& desktopEntryName)
 QString FilterMgr::FilterNameToDesktopEntryName(const QString& name)
 {
     if (name.isEmpty()) return QString();
-    KService::List offers = KServiceTypeTrader::self()->query(QLatin1String( "Jovie/FilterPlugin" ),
-    QString(QLatin1String( "Name == '%1'" )).arg(name));
-
-    if (offers.count() == 1)
-        return offers[0]->desktopEntryName();
-    else
-        return QString();
+    return FilterPlugins::self()->desktopEntryName(name);
 }
-
@@ -29,9 +29,11 @@
 
 // Qt includes.
 #include <QtCore/QList>
+#include <QtCore/QMap>
 
 // KTTS includes.
 #include "filterproc.h"
+#include "talkerchooserrules.h"
 
 class TalkerCode;
 
@@ -43,6 +45,10 @@ typedef QList<KttsFilterProc*> FilterList;
  * Manager for filter objects. Loads and configures filters that have been
  * set up by the user as per the config file. Also filters text to bee spoken
  * by running it through all the configured filters.
+ *
+ * Talker Chooser filters are not run one by one.  Their rules are gathered into
+ * one table when the filters are loaded and evaluated together, at the place of
+ * the first talker chooser in the filter list.
  */
 class FilterMgr : public KttsFilterProc
 {
@@ -68,6 +74,16 @@ class FilterMgr : public KttsFilterProc
          */
         virtual bool init();
 
+        /**
+         * Rereads the filter configuration.  Filters whose settings did not change
+         * are kept as they are, so only added, removed or changed filters are loaded.
+         * @param filterId          ID of a filter to load again even if its settings
+         *                          did not change.  For example because a file it
+         *                          reads has changed.
+         * @return                  Number of filters loaded or removed.
+         */
+        int reload(const QString& filterId = QString());
+
         /** 
          * Synchronously convert text.
          * @param inputText         Input text.
@@ -80,17 +96,40 @@ class FilterMgr : public KttsFilterProc
          */
         virtual QString convert(const QString& inputText, TalkerCode* talkerCode, const QString& appId);
 
+        /**
+         * Which talker chooser rule picked the talker in the last conversion, and why.
+         */
+        QString lastTalkerChoice() const;
+
     private:
+        // A configured filter.
+        struct FilterEntry
+        {
+            // Filter ID, as in the Filter_<ID> group of the config file.
+            QString id;
+            // Settings of the Filter_<ID> group when the filter was loaded.
+            QMap<QString, QString> settings;
+            // The filter.  Null for talker choosers, which are kept as rules.
+            KttsFilterProc* proc;
+            TalkerChooserRule rule;
+        };
+
+        // Rebuilds the filter list and talker chooser rules from the entries.
+        void rebuildFilterList();
         // Loads the processing plug in for a named filter plug in.
         KttsFilterProc* loadFilterPlugin(const QString& plugInName);
         // Finishes up with current filter (if any) and goes on to the next filter.
         void nextFilter();
-        // Uses KTrader to convert a translated Filter Plugin Name to DesktopEntryName.
+        // Applies the talker chooser rules to the text being filtered.
+        void chooseTalker();
+        // Converts a translated Filter Plugin Name to DesktopEntryName.
         // @param name                   The translated plugin name.  From Name= line in .desktop file.
         // @return                       DesktopEntryName.  The name of the .desktop file (less .desktop).
         //                               QString() if not found.
         QString FilterNameToDesktopEntryName(const QString& name);
 
+        // Configured filters, in order.
+        QList<FilterEntry> m_entries;
         // List of filters.
         FilterList m_filterList;
         // Text being filtered.
@@ -105,6 +144,12 @@ class FilterMgr : public KttsFilterProc
         QString m_appId;
         // FilterMgr state.
         int m_state;
+        // Rules of the talker chooser filters.
+        TalkerChooserRules m_talkerChooserRules;
+        // Index in the list of filters at which the rules are applied.  -1 if there are none.
+        int m_talkerChooserPosition;
+        // Outcome of the rules in the last conversion.
+        QString m_lastTalkerChoice;
 };
 
 #endif      // FILTERMGR_H
@@ -0,0 +1,122 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Collects job events into batches for the subscribers.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// JobEventBatcher includes.
+#include "jobeventbatcher.h"
+#include "jobeventbatcher.moc"
+
+// Qt includes.
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusMessage>
+#include <QtDBus/QDBusServiceWatcher>
+
+// KDE includes.
+#include <kdebug.h>
+
+JobEventBatcher::JobEventBatcher(QObject *parent) :
+    QObject(parent),
+    m_watcher(new QDBusServiceWatcher(this))
+{
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(200);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(slotFlush()));
+
+    m_watcher->setConnection(QDBusConnection::sessionBus());
+    m_watcher->setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
+    connect(m_watcher, SIGNAL(serviceUnregistered(QString)), this, SLOT(unsubscribe(QString)));
+}
+
+JobEventBatcher::~JobEventBatcher()
+{
+}
+
+void JobEventBatcher::subscribe(const QString &subscriber, const QStringList &appIds)
+{
+    if (!m_subscribers.contains(subscriber))
+        m_watcher->addWatchedService(subscriber);
+    m_subscribers.insert(subscriber, appIds);
+}
+
+void JobEventBatcher::unsubscribe(const QString &subscriber)
+{
+    if (m_subscribers.remove(subscriber))
+        m_watcher->removeWatchedService(subscriber);
+    if (m_subscribers.isEmpty())
+    {
+        m_events.clear();
+        m_timer.stop();
+    }
+}
+
+void JobEventBatcher::setInterval(int msec)
+{
+    m_timer.setInterval(qMax(0, msec));
+}
+
+void JobEventBatcher::addEvent(const QString &appId, int jobNum, KSpeech::JobState state)
+{
+    if (m_subscribers.isEmpty())
+        return;
+    Event event;
+    event.appId = appId;
+    event.jobNum = jobNum;
+    event.state = state;
+    event.time = QDateTime::currentMSecsSinceEpoch();
+    m_events.append(event);
+    // The first event of a batch starts the interval; later ones just wait for it.
+    if (!m_timer.isActive())
+        m_timer.start();
+}
+
+void JobEventBatcher::slotFlush()
+{
+    const QList<Event> events = m_events;
+    m_events.clear();
+
+    QHash<QString, QStringList>::const_iterator it = m_subscribers.constBegin();
+    for (; it != m_subscribers.constEnd(); ++it)
+    {
+        const QStringList &appIds = it.value();
+        QList<const Event *> matching;
+        foreach (const Event &event, events)
+        {
+            if (appIds.isEmpty() || appIds.contains(event.appId))
+                matching.append(&event);
+        }
+        if (matching.isEmpty())
+            continue;
+
+        QByteArray batch;
+        QDataStream stream(&batch, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_4_8);
+        stream << quint32(matching.count());
+        foreach (const Event *event, matching)
+            stream << event->appId << event->jobNum << event->state << event->time;
+        // Not waited for; a subscriber that does not answer only loses its batch.
+        QDBusMessage call = QDBusMessage::createMethodCall(it.key(), QLatin1String("/JobEvents"),
+            QLatin1String("org.kde.Jovie.JobEvents"), QLatin1String("jobEvents"));
+        call << batch;
+        QDBusConnection::sessionBus().send(call);
+    }
+}
@@ -0,0 +1,99 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Collects job events into batches for the subscribers.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef JOBEVENTBATCHER_H
+#define JOBEVENTBATCHER_H
+
+// Qt includes.
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QStringList>
+#include <QtCore/QTimer>
+
+#include <kspeech.h>
+
+class QDBusServiceWatcher;
+
+/**
+ * @class JobEventBatcher
+ *
+ * Collects the job state changes for the clients that subscribed to them and
+ * hands them out in batches, at most one per subscriber per interval,
+ * however many jobs change state meanwhile.
+ *
+ * A batch is delivered to its subscriber alone, by calling the method
+ * jobEvents(ay) of interface org.kde.Jovie.JobEvents on its object
+ * /JobEvents, so no client sees the jobs of another unless it asked for them.
+ * A batch is a QDataStream (version Qt_4_8) with a quint32 count followed by
+ * the events, each a QString appId, qint32 job number, qint32
+ * KSpeech::JobState and qint64 time in ms since the epoch.
+ */
+class JobEventBatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit JobEventBatcher(QObject *parent = 0);
+    ~JobEventBatcher();
+
+    /**
+     * Subscribes a client, or changes its filter.
+     * @param subscriber        DBUS connection name of the client.
+     * @param appIds            Applications whose jobs to report.  Empty for all.
+     */
+    void subscribe(const QString &subscriber, const QStringList &appIds);
+
+    /**
+     * Sets how long events are collected before a batch is emitted.
+     * @param msec              Interval in milliseconds.
+     */
+    void setInterval(int msec);
+
+public slots:
+    /**
+     * Unsubscribes a client.  Done by itself when the client leaves the bus.
+     */
+    void unsubscribe(const QString &subscriber);
+
+    void addEvent(const QString &appId, int jobNum, KSpeech::JobState state);
+
+private slots:
+    void slotFlush();
+
+private:
+    struct Event
+    {
+        QString appId;
+        qint32 jobNum;
+        qint32 state;
+        qint64 time;
+    };
+
+    // Applications each subscriber wants events for.  Empty for all.
+    QHash<QString, QStringList> m_subscribers;
+    QList<Event> m_events;
+    QTimer m_timer;
+    QDBusServiceWatcher *m_watcher;
+};
+
+#endif // JOBEVENTBATCHER_H
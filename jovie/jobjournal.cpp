@@ -0,0 +1,329 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Journal of the accepted jobs, for recovery after a crash.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// JobJournal includes.
+#include "jobjournal.h"
+
+// System includes.
+#include <stdio.h>
+#include <string.h>
+
+// Qt includes.
+#include <QtCore/QDataStream>
+#include <QtCore/QMap>
+#include <QtCore/QPair>
+#include <QtCore/QtEndian>
+
+// KDE includes.
+#include <kdebug.h>
+
+/* Record header: quint32 payload size, quint16 checksum of type and payload,
+   quint8 type, quint8 unused.  Little endian.  A size of 0 ends the records. */
+static const int HeaderSize = 8;
+// The mapping grows by at least this much.
+static const qint64 MinMapSize = 64 * 1024;
+// Below this the journal is not worth compacting.
+static const qint64 MinCompactSize = 256 * 1024;
+// Compacted once the records are this many times the size of the live ones.
+static const int CompactRatio = 4;
+// Size of a progress record.
+static const int ProgressSize = HeaderSize + 8;
+
+static quint16 checksum(quint8 type, const char *payload, int size)
+{
+    // CRC-16 of the payload, with the type folded in.
+    return qChecksum(payload, size) ^ (quint16(type) * 0x0101);
+}
+
+static void appendRecord(QByteArray *data, quint8 type, const QByteArray &payload)
+{
+    uchar header[HeaderSize];
+    qToLittleEndian<quint32>(payload.size(), header);
+    qToLittleEndian<quint16>(checksum(type, payload.constData(), payload.size()), header + 4);
+    header[6] = type;
+    header[7] = 0;
+    data->append(reinterpret_cast<const char *>(header), HeaderSize);
+    data->append(payload);
+}
+
+static QByteArray progressPayload(int jobNum, int sentences)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_8);
+    stream << qint32(jobNum) << qint32(sentences);
+    return payload;
+}
+
+JobJournal::JobJournal() :
+    m_map(0),
+    m_mapped(0),
+    m_used(0),
+    m_liveBytes(0)
+{
+}
+
+JobJournal::~JobJournal()
+{
+    unmap();
+}
+
+bool JobJournal::open(const QString &path)
+{
+    unmap();
+    m_file.close();
+    m_path = path;
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite))
+    {
+        kWarning() << "could not open the job journal" << path;
+        return false;
+    }
+    const qint64 size = qMax(m_file.size(), MinMapSize);
+    if ((m_file.size() < size && !m_file.resize(size)) || !map(size))
+    {
+        kWarning() << "could not map the job journal" << path;
+        m_file.close();
+        return false;
+    }
+    read();
+    // Jobs recovered before, numbered below 0, are older than the jobs of the
+    // run that crashed.  All are numbered again from -1 down, oldest first.
+    QMap<QPair<bool, int>, Entry> pending;
+    foreach (const Entry &entry, m_live)
+        pending.insert(qMakePair(entry.job.jobNum >= 0, qAbs(entry.job.jobNum)), entry);
+    m_live.clear();
+    m_liveBytes = 0;
+    int jobNum = 0;
+    foreach (Entry entry, pending)
+    {
+        entry.job.jobNum = --jobNum;
+        m_live.insert(jobNum, entry);
+        m_liveBytes += entry.bytes;
+    }
+    compact();
+    return isOpen();
+}
+
+bool JobJournal::isOpen() const
+{
+    return m_map != 0;
+}
+
+QList<JobJournal::Job> JobJournal::recovered() const
+{
+    QMap<int, Job> sorted;
+    foreach (const Entry &entry, m_live)
+    {
+        if (entry.job.jobNum < 0)
+            sorted.insert(-entry.job.jobNum, entry.job);
+    }
+    return sorted.values();
+}
+
+void JobJournal::accept(const Job &job)
+{
+    if (!isOpen())
+        return;
+    const QByteArray payload = jobPayload(job);
+    Entry entry;
+    entry.job = job;
+    entry.bytes = HeaderSize + payload.size() + ProgressSize;
+    m_live.insert(job.jobNum, entry);
+    m_liveBytes += entry.bytes;
+    write(Accept, payload);
+}
+
+void JobJournal::progress(int jobNum, int sentences)
+{
+    QHash<int, Entry>::iterator it = m_live.find(jobNum);
+    if (it == m_live.end() || it->job.sentences == sentences)
+        return;
+    it->job.sentences = sentences;
+    write(Progress, progressPayload(jobNum, sentences));
+}
+
+void JobJournal::end(int jobNum)
+{
+    QHash<int, Entry>::iterator it = m_live.find(jobNum);
+    if (it == m_live.end())
+        return;
+    m_liveBytes -= it->bytes;
+    m_live.erase(it);
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_8);
+    stream << qint32(jobNum);
+    write(End, payload);
+    if (m_used > MinCompactSize && m_used > CompactRatio * m_liveBytes)
+        compact();
+}
+
+bool JobJournal::contains(int jobNum) const
+{
+    return m_live.contains(jobNum);
+}
+
+void JobJournal::discard()
+{
+    unmap();
+    m_file.close();
+    m_live.clear();
+    m_liveBytes = 0;
+    m_used = 0;
+    if (!m_path.isEmpty())
+        QFile::remove(m_path);
+}
+
+void JobJournal::read()
+{
+    m_used = 0;
+    while (m_used + HeaderSize <= m_mapped)
+    {
+        const uchar *header = m_map + m_used;
+        const qint64 size = qFromLittleEndian<quint32>(header);
+        const quint8 type = header[6];
+        if (size == 0 || m_used + HeaderSize + size > m_mapped)
+            break;
+        const char *payload = reinterpret_cast<const char *>(header + HeaderSize);
+        if (qFromLittleEndian<quint16>(header + 4) != checksum(type, payload, size))
+            break;
+
+        QDataStream stream(QByteArray::fromRawData(payload, size));
+        stream.setVersion(QDataStream::Qt_4_8);
+        qint32 jobNum;
+        stream >> jobNum;
+        if (type == Accept)
+        {
+            Job job;
+            qint32 priority, options;
+            stream >> job.appId >> priority >> options >> job.text;
+            job.jobNum = jobNum;
+            job.priority = priority;
+            job.options = options;
+            Entry entry;
+            entry.job = job;
+            entry.bytes = HeaderSize + size + ProgressSize;
+            m_live.insert(jobNum, entry);
+        }
+        else if (type == Progress && m_live.contains(jobNum))
+        {
+            qint32 sentences;
+            stream >> sentences;
+            m_live[jobNum].job.sentences = sentences;
+        }
+        else if (type == End)
+            m_live.remove(jobNum);
+        m_used += HeaderSize + size;
+    }
+    // Clear what is left of a torn record, so nothing after it is mistaken for one.
+    memset(m_map + m_used, 0, m_mapped - m_used);
+}
+
+void JobJournal::write(RecordType type, const QByteArray &payload)
+{
+    if (!isOpen() || !reserve(HeaderSize + payload.size()))
+        return;
+    uchar *header = m_map + m_used;
+    // The size goes last, so a record torn by a crash reads as the end.
+    memcpy(header + HeaderSize, payload.constData(), payload.size());
+    qToLittleEndian<quint16>(checksum(type, payload.constData(), payload.size()), header + 4);
+    header[6] = type;
+    header[7] = 0;
+    qToLittleEndian<quint32>(payload.size(), header);
+    m_used += HeaderSize + payload.size();
+}
+
+bool JobJournal::reserve(qint64 size)
+{
+    // Room for the record and for the size 0 that ends the records.
+    if (m_used + size + HeaderSize <= m_mapped)
+        return true;
+    const qint64 newSize = qMax(m_mapped * 2, m_used + size + HeaderSize + MinMapSize);
+    unmap();
+    if (!m_file.resize(newSize) || !map(newSize))
+    {
+        kWarning() << "could not grow the job journal" << m_path;
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+void JobJournal::compact()
+{
+    QByteArray data;
+    foreach (const Entry &entry, m_live)
+    {
+        appendRecord(&data, Accept, jobPayload(entry.job));
+        if (entry.job.sentences)
+            appendRecord(&data, Progress, progressPayload(entry.job.jobNum, entry.job.sentences));
+    }
+
+    // Written aside and renamed over, so a crash meanwhile leaves one whole journal.
+    const QString newPath = m_path + QLatin1String(".new");
+    QFile newFile(newPath);
+    const qint64 size = qMax(MinMapSize, qint64(data.size()) * 2 + HeaderSize);
+    if (!newFile.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+        newFile.write(data) != data.size() || !newFile.resize(size))
+    {
+        kWarning() << "could not compact the job journal" << m_path;
+        newFile.remove();
+        return;
+    }
+    newFile.close();
+    unmap();
+    m_file.close();
+    if (::rename(QFile::encodeName(newPath).constData(), QFile::encodeName(m_path).constData()) != 0)
+        kWarning() << "could not replace the job journal" << m_path;
+    if (!m_file.open(QIODevice::ReadWrite) || !map(m_file.size()))
+    {
+        kWarning() << "could not reopen the job journal" << m_path;
+        m_file.close();
+        return;
+    }
+    m_used = data.size();
+}
+
+bool JobJournal::map(qint64 size)
+{
+    m_map = m_file.map(0, size);
+    m_mapped = m_map ? size : 0;
+    return m_map != 0;
+}
+
+void JobJournal::unmap()
+{
+    if (m_map)
+        m_file.unmap(m_map);
+    m_map = 0;
+    m_mapped = 0;
+}
+
+QByteArray JobJournal::jobPayload(const Job &job)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_8);
+    stream << qint32(job.jobNum) << job.appId << qint32(job.priority) << qint32(job.options) << job.text;
+    return payload;
+}
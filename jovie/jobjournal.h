@@ -0,0 +1,136 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Journal of the accepted jobs, for recovery after a crash.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef JOBJOURNAL_H
+#define JOBJOURNAL_H
+
+// Qt includes.
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QString>
+
+/**
+ * @class JobJournal
+ *
+ * An append-only file of the jobs accepted, how far they got and when they
+ * ended, so the jobs still pending when Jovie crashed can be queued again
+ * when KCrash restarts it.
+ *
+ * The file is memory mapped and records are copied into the mapping, so
+ * writing one is a memcpy.  The pages belong to the kernel, and survive a
+ * crash of the process; they are not synced, so they do not survive one of
+ * the machine.  Each record carries its length and a checksum, and reading
+ * stops at the first that does not check out, such as one torn by the crash.
+ *
+ * The records of ended jobs are dead weight.  Once the file is mostly dead
+ * weight it is compacted, by writing the live jobs to a new file, so each
+ * byte of a live job is rewritten only after several times its size has been
+ * appended.
+ */
+class JobJournal
+{
+public:
+    struct Job
+    {
+        Job() : jobNum(0), priority(0), options(0), sentences(0) {}
+
+        int jobNum;
+        QString appId;
+        int priority;           /* KSpeech::JobPriority */
+        int options;            /* KSpeech::SayOptions */
+        QString text;
+        int sentences;          /* sentences spoken */
+    };
+
+    JobJournal();
+    ~JobJournal();
+
+    /**
+     * Opens the journal, reading the jobs left pending by the previous run.
+     * @return                  False if it could not be opened.
+     */
+    bool open(const QString &path);
+
+    bool isOpen() const;
+
+    /**
+     * The jobs left pending by the previous run, oldest first.  They are
+     * numbered from -1 down, so they cannot be mistaken for jobs of this run,
+     * and are kept until @ref end is called for them.  If Jovie crashes
+     * before they are queued again, they are recovered again.
+     * @see open
+     */
+    QList<Job> recovered() const;
+
+    /**
+     * Records a job accepted.
+     */
+    void accept(const Job &job);
+
+    /**
+     * Records how many sentences of a job have been spoken.
+     */
+    void progress(int jobNum, int sentences);
+
+    /**
+     * Records that a job ended.
+     */
+    void end(int jobNum);
+
+    /**
+     * Whether a job is recorded and has not ended.
+     */
+    bool contains(int jobNum) const;
+
+    /**
+     * Forgets all jobs and closes the journal, as when Jovie exits cleanly.
+     */
+    void discard();
+
+private:
+    enum RecordType { Accept = 1, Progress = 2, End = 3 };
+
+    void read();
+    void write(RecordType type, const QByteArray &payload);
+    bool reserve(qint64 size);
+    void compact();
+    bool map(qint64 size);
+    void unmap();
+    static QByteArray jobPayload(const Job &job);
+
+    QString m_path;
+    QFile m_file;
+    uchar *m_map;
+    qint64 m_mapped;        /* size of the mapping */
+    qint64 m_used;          /* bytes of records */
+    struct Entry
+    {
+        Job job;
+        qint64 bytes;           /* bytes its records take once compacted */
+    };
+
+    QHash<int, Entry> m_live;
+    qint64 m_liveBytes;     /* bytes of the records of live jobs */
+};
+
+#endif // JOBJOURNAL_H
@@ -0,0 +1,313 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Keeps the metadata of the speech jobs for bulk inspection.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// JobRegistry includes.
+#include "jobregistry.h"
+
+// Qt includes.
+#include <QtCore/QDataStream>
+
+static bool isEnded(int state)
+{
+    return state == KSpeech::jsFinished || state == KSpeech::jsDeleted;
+}
+
+int JobRegistry::StringTable::intern(const QString &string)
+{
+    QHash<QString, int>::const_iterator it = m_ids.constFind(string);
+    if (it != m_ids.constEnd())
+    {
+        ++m_refs[it.value()];
+        return it.value();
+    }
+    int id;
+    if (m_free.isEmpty())
+    {
+        id = m_strings.count();
+        m_strings.append(string);
+        m_refs.append(1);
+    }
+    else
+    {
+        id = m_free.last();
+        m_free.pop_back();
+        m_strings[id] = string;
+        m_refs[id] = 1;
+    }
+    m_ids.insert(string, id);
+    return id;
+}
+
+void JobRegistry::StringTable::release(int id)
+{
+    if (id < 0 || --m_refs[id] > 0)
+        return;
+    m_ids.remove(m_strings.at(id));
+    m_strings[id].clear();
+    m_free.append(id);
+}
+
+int JobRegistry::StringTable::find(const QString &string) const
+{
+    return m_ids.value(string, -1);
+}
+
+QString JobRegistry::StringTable::value(int id) const
+{
+    return id < 0 ? QString() : m_strings.at(id);
+}
+
+int JobRegistry::StringTable::count() const
+{
+    return m_ids.count();
+}
+
+qint64 JobRegistry::StringTable::memoryUsage() const
+{
+    qint64 bytes = m_strings.capacity() * sizeof(QString) + m_refs.capacity() * sizeof(int)
+        + m_free.capacity() * sizeof(int);
+    // The hash shares the strings; count their characters once.
+    QHash<QString, int>::const_iterator it;
+    for (it = m_ids.constBegin(); it != m_ids.constEnd(); ++it)
+        bytes += it.key().capacity() * sizeof(QChar) + 2 * sizeof(void *) + sizeof(int);
+    return bytes;
+}
+
+JobRegistry::JobRegistry() :
+    m_live(0),
+    m_seq(0),
+    m_forgottenSeq(0)
+{
+}
+
+void JobRegistry::add(int jobNum, const QString &appId, KSpeech::JobPriority priority, const QString &talker)
+{
+    // Numbers are only given out again once they wrap around.
+    Job &job = m_jobs[jobNum];
+    if (job.jobNum)
+    {
+        countLive(job, -1);
+        m_appIds.release(job.app);
+        m_talkers.release(job.talker);
+    }
+    job.jobNum = jobNum;
+    job.priority = priority;
+    job.state = KSpeech::jsQueued;
+    job.app = m_appIds.intern(appId);
+    job.talker = m_talkers.intern(talker);
+    job.sentenceNum = 0;
+    job.sentenceCount = 0;
+    countLive(job, 1);
+    touch(&job);
+}
+
+QString JobRegistry::setState(int jobNum, KSpeech::JobState state)
+{
+    QHash<int, Job>::iterator it = m_jobs.find(jobNum);
+    if (it == m_jobs.end())
+        return QString();
+    Job &job = it.value();
+    const QString appId = m_appIds.value(job.app);
+    if (job.state == state)
+        return appId;
+    const bool wasEnded = isEnded(job.state);
+    countLive(job, -1);
+    job.state = state;
+    countLive(job, 1);
+    touch(&job);
+
+    if (isEnded(state) && !wasEnded)
+    {
+        m_ended.enqueue(jobNum);
+        while (m_ended.count() > maxEnded)
+        {
+            QHash<int, Job>::iterator old = m_jobs.find(m_ended.dequeue());
+            // Forget only jobs that did not come back under the same number.
+            if (old == m_jobs.end() || !isEnded(old->state))
+                continue;
+            forget(old);
+        }
+    }
+    return appId;
+}
+
+void JobRegistry::setSentenceCount(int jobNum, int sentenceCount)
+{
+    QHash<int, Job>::iterator it = m_jobs.find(jobNum);
+    if (it == m_jobs.end() || it->sentenceCount == sentenceCount)
+        return;
+    it->sentenceCount = sentenceCount;
+    touch(&it.value());
+}
+
+void JobRegistry::setSentenceNum(int jobNum, int sentenceNum)
+{
+    QHash<int, Job>::iterator it = m_jobs.find(jobNum);
+    if (it == m_jobs.end() || it->sentenceNum == sentenceNum)
+        return;
+    it->sentenceNum = sentenceNum;
+    touch(&it.value());
+}
+
+const JobRegistry::Job *JobRegistry::job(int jobNum) const
+{
+    QHash<int, Job>::const_iterator it = m_jobs.constFind(jobNum);
+    return it == m_jobs.constEnd() ? 0 : &it.value();
+}
+
+QList<JobRegistry::Job> JobRegistry::jobs(const Filter &filter) const
+{
+    // Resolve the requested application IDs once; unknown ones match nothing.
+    QVector<int> apps;
+    foreach (const QString &appId, filter.appIds)
+        apps.append(m_appIds.find(appId));
+    QMap<int, Job> sorted;
+    foreach (const Job &job, m_jobs)
+    {
+        if (matches(filter, apps, job))
+            sorted.insert(job.jobNum, job);
+    }
+    return sorted.values();
+}
+
+QString JobRegistry::appId(const Job &job) const
+{
+    return m_appIds.value(job.app);
+}
+
+QString JobRegistry::talker(const Job &job) const
+{
+    return m_talkers.value(job.talker);
+}
+
+int JobRegistry::count() const
+{
+    return m_jobs.count();
+}
+
+int JobRegistry::liveCount() const
+{
+    return m_live;
+}
+
+int JobRegistry::liveCount(const QString &appId) const
+{
+    const int app = m_appIds.find(appId);
+    return app < 0 || app >= m_liveByApp.count() ? 0 : m_liveByApp.at(app);
+}
+
+int JobRegistry::appIdCount() const
+{
+    return m_appIds.count();
+}
+
+qint64 JobRegistry::memoryUsage() const
+{
+    // A QHash node holds the key, the value and the next pointer and hash.
+    const qint64 jobBytes = sizeof(Job) + sizeof(int) + sizeof(void *) + sizeof(uint);
+    const qint64 seqBytes = sizeof(quint64) + sizeof(int) + 3 * sizeof(void *);
+    return m_jobs.count() * jobBytes + m_bySeq.count() * seqBytes
+        + m_ended.count() * sizeof(int) + m_liveByApp.capacity() * sizeof(int)
+        + m_appIds.memoryUsage() + m_talkers.memoryUsage();
+}
+
+quint64 JobRegistry::seq() const
+{
+    return m_seq;
+}
+
+QByteArray JobRegistry::snapshot(const Filter &filter) const
+{
+    const QList<Job> matching = jobs(filter);
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_8);
+    stream << m_seq << quint32(matching.count());
+    foreach (const Job &job, matching)
+        writeJob(stream, job);
+    return data;
+}
+
+QByteArray JobRegistry::changesSince(quint64 seq, const Filter &filter) const
+{
+    QVector<int> apps;
+    foreach (const QString &appId, filter.appIds)
+        apps.append(m_appIds.find(appId));
+    QList<Job> changed;
+    QMap<quint64, int>::const_iterator it = m_bySeq.upperBound(seq);
+    for (; it != m_bySeq.constEnd(); ++it)
+    {
+        const Job job = m_jobs.value(it.value());
+        if (matches(filter, apps, job))
+            changed.append(job);
+    }
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_8);
+    stream << m_seq << bool(seq >= m_forgottenSeq) << quint32(changed.count());
+    foreach (const Job &job, changed)
+        writeJob(stream, job);
+    return data;
+}
+
+void JobRegistry::writeJob(QDataStream &stream, const Job &job) const
+{
+    stream << job.jobNum << job.priority << job.state << appId(job) << talker(job)
+        << job.sentenceNum << job.sentenceCount;
+}
+
+void JobRegistry::touch(Job *job)
+{
+    if (job->seq)
+        m_bySeq.remove(job->seq);
+    job->seq = ++m_seq;
+    m_bySeq.insert(job->seq, job->jobNum);
+}
+
+void JobRegistry::forget(QHash<int, Job>::iterator it)
+{
+    countLive(it.value(), -1);
+    m_appIds.release(it->app);
+    m_talkers.release(it->talker);
+    m_bySeq.remove(it->seq);
+    m_forgottenSeq = qMax(m_forgottenSeq, it->seq);
+    m_jobs.erase(it);
+}
+
+bool JobRegistry::matches(const Filter &filter, const QVector<int> &apps, const Job &job) const
+{
+    if (filter.priorities && !(filter.priorities & (1 << job.priority)))
+        return false;
+    if (filter.states && !(filter.states & (1 << job.state)))
+        return false;
+    return filter.appIds.isEmpty() || apps.contains(job.app);
+}
+
+void JobRegistry::countLive(const Job &job, int delta)
+{
+    if (isEnded(job.state))
+        return;
+    m_live += delta;
+    if (job.app >= m_liveByApp.count())
+        m_liveByApp.resize(job.app + 1);
+    m_liveByApp[job.app] += delta;
+}
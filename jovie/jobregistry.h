@@ -0,0 +1,220 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Keeps the metadata of the speech jobs for bulk inspection.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef JOBREGISTRY_H
+#define JOBREGISTRY_H
+
+// Qt includes.
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QQueue>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+#include <kspeech.h>
+
+/**
+ * @class JobRegistry
+ *
+ * Metadata of the jobs Jovie has queued, so a client can list them all in
+ * one call and then poll for what changed.
+ *
+ * Every change of a job takes the next number of a sequence.  The jobs are
+ * indexed by the sequence number of their latest change, so the changes since
+ * a sequence number are found without looking at the jobs that did not change.
+ * Finished and deleted jobs are kept until @ref maxEnded newer jobs have
+ * ended, so that pollers see them end.
+ *
+ * Application IDs and talkers are interned: a job holds small integer ids,
+ * which are reused once no job refers to them, so a job is a few ints
+ * whatever the strings.
+ */
+class JobRegistry
+{
+public:
+    struct Job
+    {
+        Job() : jobNum(0), priority(0), state(0), app(-1), talker(-1), sentenceNum(0), sentenceCount(0), seq(0) {}
+
+        qint32 jobNum;
+        qint32 priority;        /* KSpeech::JobPriority */
+        qint32 state;           /* KSpeech::JobState */
+        qint32 app;             /* interned application ID, see appId() */
+        qint32 talker;          /* interned talker, see talker() */
+        qint32 sentenceNum;
+        qint32 sentenceCount;
+        quint64 seq;            /* sequence number of the latest change */
+    };
+
+    /**
+     * Selects jobs.  Masks have bit (1 << value) set for each wanted
+     * KSpeech::JobPriority or KSpeech::JobState.  Empty or 0 selects all.
+     */
+    struct Filter
+    {
+        Filter() : priorities(0), states(0) {}
+
+        QStringList appIds;
+        int priorities;
+        int states;
+    };
+
+    enum { maxEnded = 256 };
+
+    JobRegistry();
+
+    /**
+     * Records a job just queued.
+     */
+    void add(int jobNum, const QString &appId, KSpeech::JobPriority priority, const QString &talker);
+
+    /**
+     * Records a new state of a job.
+     * @return                  The application of the job.  Empty if not known.
+     */
+    QString setState(int jobNum, KSpeech::JobState state);
+
+    /**
+     * Records the number of sentences of a job.
+     */
+    void setSentenceCount(int jobNum, int sentenceCount);
+
+    /**
+     * Records the sentence a job is speaking, counting from 1.
+     */
+    void setSentenceNum(int jobNum, int sentenceNum);
+
+    /**
+     * The job, or 0 if not known.
+     */
+    const Job *job(int jobNum) const;
+
+    /**
+     * The jobs matching the filter, in order of job number.
+     */
+    QList<Job> jobs(const Filter &filter = Filter()) const;
+
+    /**
+     * The application ID and the talker of a job.
+     */
+    QString appId(const Job &job) const;
+    QString talker(const Job &job) const;
+
+    /**
+     * Number of jobs known, and of those not ended.
+     */
+    int count() const;
+    int liveCount() const;
+
+    /**
+     * Number of jobs of an application that have not ended.
+     */
+    int liveCount(const QString &appId) const;
+
+    /**
+     * Number of application IDs interned.
+     */
+    int appIdCount() const;
+
+    /**
+     * Approximate bytes of memory used.
+     */
+    qint64 memoryUsage() const;
+
+    /**
+     * Sequence number of the latest change.  0 before any change.
+     */
+    quint64 seq() const;
+
+    /**
+     * The jobs matching the filter, as a QDataStream (version Qt_4_8):
+     *   - quint64 seq          Sequence number to poll @ref changesSince with.
+     *   - quint32 count
+     *   - count jobs, each written by @ref writeJob.
+     */
+    QByteArray snapshot(const Filter &filter) const;
+
+    /**
+     * The jobs that changed after sequence number @p seq, as a QDataStream
+     * (version Qt_4_8):
+     *   - quint64 seq          Sequence number to poll with next time.
+     *   - bool complete        False if ended jobs that changed meanwhile were
+     *                          already forgotten.  Take a new snapshot then.
+     *   - quint32 count
+     *   - count jobs, oldest change first, each written by @ref writeJob.
+     * Only the jobs matching @p filter are written.
+     */
+    QByteArray changesSince(quint64 seq, const Filter &filter = Filter()) const;
+
+    /**
+     * Writes a job as qint32 jobNum, qint32 priority, qint32 state,
+     * QString appId, QString talker, qint32 sentenceNum and
+     * qint32 sentenceCount.  All but jobNum are as in SpeechJob::serialize.
+     */
+    void writeJob(QDataStream &stream, const Job &job) const;
+
+private:
+    /**
+     * Strings by id.  Ids are counted references, and reused once released
+     * by every job.
+     */
+    class StringTable
+    {
+    public:
+        int intern(const QString &string);
+        void release(int id);
+        int find(const QString &string) const;
+        QString value(int id) const;
+        int count() const;
+        qint64 memoryUsage() const;
+
+    private:
+        QHash<QString, int> m_ids;
+        QVector<QString> m_strings;
+        QVector<int> m_refs;
+        QVector<int> m_free;
+    };
+
+    void touch(Job *job);
+    void forget(QHash<int, Job>::iterator it);
+    bool matches(const Filter &filter, const QVector<int> &apps, const Job &job) const;
+    void countLive(const Job &job, int delta);
+
+    StringTable m_appIds;
+    StringTable m_talkers;
+    // Jobs not ended, in all and by interned application ID.
+    int m_live;
+    QVector<int> m_liveByApp;
+
+    QHash<int, Job> m_jobs;
+    // Job number of each job by the sequence number of its latest change.
+    QMap<quint64, int> m_bySeq;
+    // Ended jobs, the first to end first.
+    QQueue<int> m_ended;
+    quint64 m_seq;
+    // Latest change of a job already forgotten.
+    quint64 m_forgottenSeq;
+};
+
+#endif // JOBREGISTRY_H
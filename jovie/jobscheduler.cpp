@@ -0,0 +1,150 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Orders queued jobs by priority, fairly across applications.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// JobScheduler includes.
+#include "jobscheduler.h"
+
+// Each job costs a little more than its text, so empty ones are not free.
+static const int JobOverhead = 64;
+// Scale of the costs, so dividing by the weight keeps some precision.
+static const quint64 CostScale = 1024;
+
+JobScheduler::JobScheduler() :
+    m_count(0),
+    m_seq(0)
+{
+}
+
+void JobScheduler::enqueue(const Job &job, int weight)
+{
+    Entry entry;
+    entry.job = job;
+    if (entry.job.priority < KSpeech::jpScreenReaderOutput || entry.job.priority > KSpeech::jpProgress)
+        entry.job.priority = KSpeech::jpText;
+    entry.seq = ++m_seq;
+
+    PriorityClass &priorityClass = m_classes[entry.job.priority];
+    QHash<QString, AppQueue>::iterator it = priorityClass.queues.find(job.appId);
+    // An application without queued jobs starts from the virtual time; one with
+    // queued jobs after its latest.  Queues are dropped when they run empty,
+    // since by then the virtual time has caught up with their tags.
+    quint64 start = priorityClass.virtualTime;
+    if (it == priorityClass.queues.end())
+        it = priorityClass.queues.insert(job.appId, AppQueue());
+    else
+        start = qMax(start, it->lastFinish);
+    const quint64 cost = quint64(job.text.length() + JobOverhead) * CostScale;
+    entry.finish = start + cost / quint64(qMax(1, weight));
+    it->lastFinish = entry.finish;
+    it->entries.enqueue(entry);
+    ++m_count;
+}
+
+bool JobScheduler::isEmpty() const
+{
+    return m_count == 0;
+}
+
+int JobScheduler::count() const
+{
+    return m_count;
+}
+
+KSpeech::JobPriority JobScheduler::nextPriority() const
+{
+    return KSpeech::JobPriority(nextClass());
+}
+
+JobScheduler::Job JobScheduler::takeNext()
+{
+    PriorityClass &priorityClass = m_classes[nextClass()];
+    QHash<QString, AppQueue>::iterator it = priorityClass.queues.find(nextQueue(priorityClass).key());
+    const Entry entry = it->entries.dequeue();
+    priorityClass.virtualTime = qMax(priorityClass.virtualTime, entry.finish);
+    if (it->entries.isEmpty())
+        priorityClass.queues.erase(it);
+    --m_count;
+    return entry.job;
+}
+
+bool JobScheduler::remove(int jobNum)
+{
+    for (int priority = KSpeech::jpScreenReaderOutput; priority < PriorityCount; ++priority)
+    {
+        QHash<QString, AppQueue> &queues = m_classes[priority].queues;
+        for (QHash<QString, AppQueue>::iterator it = queues.begin(); it != queues.end(); ++it)
+        {
+            QQueue<Entry> &entries = it->entries;
+            for (int i = 0; i < entries.count(); ++i)
+            {
+                if (entries.at(i).job.jobNum != jobNum)
+                    continue;
+                entries.removeAt(i);
+                if (entries.isEmpty())
+                    queues.erase(it);
+                --m_count;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+QList<int> JobScheduler::clear()
+{
+    QList<int> jobNums;
+    for (int priority = KSpeech::jpScreenReaderOutput; priority < PriorityCount; ++priority)
+    {
+        foreach (const AppQueue &queue, m_classes[priority].queues)
+        {
+            foreach (const Entry &entry, queue.entries)
+                jobNums.append(entry.job.jobNum);
+        }
+        m_classes[priority].queues.clear();
+    }
+    m_count = 0;
+    return jobNums;
+}
+
+int JobScheduler::nextClass() const
+{
+    for (int priority = KSpeech::jpScreenReaderOutput; priority < PriorityCount; ++priority)
+    {
+        if (!m_classes[priority].queues.isEmpty())
+            return priority;
+    }
+    return KSpeech::jpText;
+}
+
+QHash<QString, JobScheduler::AppQueue>::const_iterator JobScheduler::nextQueue(const PriorityClass &priorityClass)
+{
+    QHash<QString, AppQueue>::const_iterator best = priorityClass.queues.constBegin();
+    QHash<QString, AppQueue>::const_iterator it = best;
+    for (++it; it != priorityClass.queues.constEnd(); ++it)
+    {
+        const Entry &head = it->entries.head();
+        const Entry &bestHead = best->entries.head();
+        if (head.finish < bestHead.finish || (head.finish == bestHead.finish && head.seq < bestHead.seq))
+            best = it;
+    }
+    return best;
+}
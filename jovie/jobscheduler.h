@@ -0,0 +1,132 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Orders queued jobs by priority, fairly across applications.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+// Qt includes.
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QQueue>
+#include <QtCore/QString>
+
+#include <kspeech.h>
+
+/**
+ * @class JobScheduler
+ *
+ * Holds jobs before they are handed to speech-dispatcher and decides which
+ * goes next.
+ *
+ * Priorities are strict: a job of a higher priority always goes before one
+ * of a lower priority.  Within a priority every application has its own
+ * queue, and the queues are served by weighted fair queuing.  Each job gets a
+ * finish tag, its cost (the length of its text) divided by the weight of its
+ * application, counted from the later of the virtual time and the tag of the
+ * previous job of that application.  The job with the lowest tag goes next,
+ * so an application flooding the queue only delays itself, and an application
+ * with twice the weight gets twice the text through.
+ */
+class JobScheduler
+{
+public:
+    struct Job
+    {
+        Job() : jobNum(0), priority(KSpeech::jpText), options(0) {}
+
+        int jobNum;
+        QString appId;
+        KSpeech::JobPriority priority;
+        int options;            /* KSpeech::SayOptions */
+        QString text;
+    };
+
+    JobScheduler();
+
+    /**
+     * Queues a job.
+     * @param weight            Weight of the application.  At least 1.
+     */
+    void enqueue(const Job &job, int weight);
+
+    bool isEmpty() const;
+
+    /**
+     * Number of jobs queued.
+     */
+    int count() const;
+
+    /**
+     * Priority of the job @ref takeNext would return.  Queue must not be empty.
+     */
+    KSpeech::JobPriority nextPriority() const;
+
+    /**
+     * Removes and returns the job to go next.  Queue must not be empty.
+     */
+    Job takeNext();
+
+    /**
+     * Removes a job.
+     * @return                  False if no such job is queued.
+     */
+    bool remove(int jobNum);
+
+    /**
+     * Removes all jobs.
+     * @return                  Their job numbers.
+     */
+    QList<int> clear();
+
+private:
+    struct Entry
+    {
+        Job job;
+        quint64 finish;         /* finish tag */
+        quint64 seq;            /* order of arrival, for ties */
+    };
+
+    struct AppQueue
+    {
+        QQueue<Entry> entries;
+        quint64 lastFinish;     /* finish tag of the latest job queued */
+    };
+
+    struct PriorityClass
+    {
+        PriorityClass() : virtualTime(0) {}
+
+        quint64 virtualTime;
+        QHash<QString, AppQueue> queues;
+    };
+
+    enum { PriorityCount = KSpeech::jpProgress + 1 };
+
+    int nextClass() const;
+    static QHash<QString, AppQueue>::const_iterator nextQueue(const PriorityClass &priorityClass);
+
+    PriorityClass m_classes[PriorityCount];
+    int m_count;
+    quint64 m_seq;
+};
+
+#endif // JOBSCHEDULER_H
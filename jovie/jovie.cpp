@@ -28,12 +28,21 @@
 
 #include <kspeech.h>
 
+// System includes.
+#include <unistd.h>
+
 // Qt includes.
 #include <QtGui/QApplication>
 #include <QtGui/QClipboard>
 #include <QtCore/QTextStream>
+#include <QtCore/QDataStream>
 #include <QtCore/QTextCodec>
 #include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QtConcurrentRun>
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusMessage>
 
 // KDE includes.
 #include <kdebug.h>
@@ -53,8 +62,58 @@
 #define spd_debug spd_debug2
 #include "speaker.h"
 #include "jovietrayicon.h"
+#include "voicecatalog.h"
+#include "startuptimeline.h"
+#include "jovieconfig.h"
+#include "textstreamreader.h"
+#include "socketserver.h"
+#include "jobeventbatcher.h"
 
 #include "kspeechadaptor.h"
+#include "jovieadaptor.h"
+
+/* JovieCall ============================================================ */
+
+/*
+* A call being handled.  It carries its sender, so a call whose reply is
+* delayed does not depend on the calls that came in after it.
+*/
+struct JovieCall
+{
+    /* DBUS connection name of the caller.  Empty for calls from within Jovie. */
+    QString appId;
+    /* The DBUS call, if its reply was delayed. */
+    QDBusMessage message;
+};
+
+/*
+* A job waiting for its text to be read.
+*/
+struct PendingSay
+{
+    JovieCall call;
+    QString appId;          /* as passed to Speaker::say */
+    int options;
+    QStringList jobNums;    /* jobs of the pieces of a sayFd text queued so far */
+};
+
+/*
+* Reads a text file for sayFile.  Runs in a worker thread.
+* Returns a null string if the file cannot be read.
+*/
+static QString readTextFile(const QString &filename, QTextCodec *codec)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+        return QString();
+    QTextStream stream(&file);
+    if (codec)
+        stream.setCodec(codec);
+    QString text = stream.readAll();
+    if (text.isNull())
+        text = QLatin1String("");
+    return text;
+}
 
 /* JoviePrivate Class ================================================== */
 
@@ -63,10 +122,16 @@ class JoviePrivate
     JoviePrivate()
     {
         trayIcon = new JovieTrayIcon();
+        socketServer = 0;
     }
 
     ~JoviePrivate()
     {
+        foreach (QFutureWatcher<QString> *watcher, fileReads.keys())
+        {
+            watcher->waitForFinished();
+            delete watcher;
+        }
         delete trayIcon;
     }
 
@@ -74,10 +139,35 @@ class JoviePrivate
 
 protected:
     /*
-    * The DBUS sender ID of last application to call KTTSD.
+    * The application calls from within Jovie are made for.
     */
     QString callingAppId;
 
+    /*
+    * Files being read for sayFile.
+    */
+    QHash<QFutureWatcher<QString> *, PendingSay> fileReads;
+
+    /*
+    * Texts being read for sayFd.  The call is answered with all their jobs.
+    */
+    QHash<TextStreamReader *, PendingSay> streams;
+
+    /*
+    * getPossibleTalkers calls waiting for the voices to be read.
+    */
+    QList<JovieCall> talkerQueries;
+
+    /*
+    * The local socket endpoint, if enabled.
+    */
+    SocketServer *socketServer;
+
+    /*
+    * Batches job events for the clients that subscribed to them.
+    */
+    JobEventBatcher eventBatcher;
+
     /*
     * The tray icon.
     */
@@ -234,27 +324,68 @@ void Jovie::setIsSystemManager(bool isSystemManager)
 
 int Jovie::say(const QString &text, int options) {
     // kDebug() << "Jovie::say: Adding '" << text << "' to queue.";
-    Speaker * speaker = Speaker::Instance();
-    return speaker->say(speaker->getAppData(callingAppId())->applicationName(), text, options);
+    // Queued right away, so that calls made after it, such as stop, come after it.
+    return Speaker::Instance()->say(callingAppId(), text, options);
 }
 
 int Jovie::sayFile(const QString &filename, const QString &encoding)
 {
     // kDebug() << "Jovie::setFile: Running";
-    QFile file(filename);
-    int jobNum = 0;
-    if ( file.open(QIODevice::ReadOnly) )
+    QTextCodec* codec = 0;
+    if (!encoding.isEmpty())
+        codec = QTextCodec::codecForName(encoding.toLatin1());
+
+    JovieCall call = currentCall(true);
+    if (call.message.type() != QDBusMessage::MethodCallMessage)
     {
-        QTextStream stream(&file);
-        if (!encoding.isEmpty())
-        {
-            QTextCodec* codec = QTextCodec::codecForName(encoding.toLatin1());
-            if (codec) stream.setCodec(codec);
-        }
-        jobNum = Speaker::Instance()->say(callingAppId(), stream.readAll(), 0);
-        file.close();
+        const QString text = readTextFile(filename, codec);
+        return text.isNull() ? 0 : Speaker::Instance()->say(call.appId, text, 0);
     }
-    return jobNum;
+
+    PendingSay request;
+    request.call = call;
+    request.appId = call.appId;
+    request.options = 0;
+    QFutureWatcher<QString> *watcher = new QFutureWatcher<QString>();
+    connect(watcher, SIGNAL(finished()), this, SLOT(slotFileRead()));
+    d->fileReads.insert(watcher, request);
+    watcher->setFuture(QtConcurrent::run(readTextFile, filename, codec));
+    return 0;
+}
+
+QStringList Jovie::sayFd(const QDBusUnixFileDescriptor &fd, const QString &encoding, int options)
+{
+    JovieCall call = currentCall(true);
+    // The descriptor is closed when the call is done, so keep a duplicate.
+    int readFd = fd.isValid() ? ::dup(fd.fileDescriptor()) : -1;
+    if (readFd < 0)
+    {
+        kDebug() << "Jovie::sayFd: no valid file descriptor";
+        sendReply(call, QStringList());
+        return QStringList();
+    }
+    QTextCodec* codec = 0;
+    if (!encoding.isEmpty())
+        codec = QTextCodec::codecForName(encoding.toLatin1());
+    // Speaker autodetects SSML in texts without options, so those are not split if they are.
+    TextStreamReader::Splitting splitting = TextStreamReader::Split;
+    if (options == KSpeech::soHtml || options == KSpeech::soSsml)
+        splitting = TextStreamReader::KeepWhole;
+    else if (options == KSpeech::soNone)
+        splitting = TextStreamReader::SplitUnlessSsml;
+
+    PendingSay request;
+    request.call = call;
+    request.appId = call.appId;
+    request.options = options;
+    // Markup longer than the budget for pending text would be refused anyway.
+    TextStreamReader *reader = new TextStreamReader(readFd, codec, splitting,
+        JovieConfig::Instance()->snapshot()->maxPendingBytes(), this);
+    connect(reader, SIGNAL(pieceRead(QString)), this, SLOT(slotPieceRead(QString)));
+    connect(reader, SIGNAL(finished(bool)), this, SLOT(slotStreamFinished(bool)));
+    d->streams.insert(reader, request);
+    reader->start();
+    return QStringList();
 }
 
 int Jovie::sayClipboard()
@@ -286,6 +417,12 @@ QStringList Jovie::languagesByModule(const QString & module)
 
 QStringList Jovie::getPossibleTalkers()
 {
+    VoiceCatalog *catalog = VoiceCatalog::Instance();
+    if (!catalog->isLoaded() && catalog->isScanning() && calledFromDBus())
+    {
+        d->talkerQueries.append(currentCall(true));
+        return QStringList();
+    }
     return Speaker::Instance()->getPossibleTalkers();
 }
 
@@ -391,8 +528,8 @@ void Jovie::removeAllJobs()
 
 int Jovie::getSentenceCount(int jobNum)
 {
-    kDebug() << "not implemented in speech-dispatcher yet";
-    return 0;
+    const JobRegistry::Job *job = Speaker::Instance()->jobRegistry()->job(applyDefaultJobNum(jobNum));
+    return job ? job->sentenceCount : 0;
 }
 
 int Jovie::getCurrentJob()
@@ -403,32 +540,76 @@ int Jovie::getCurrentJob()
 
 int Jovie::getJobCount(int priority)
 {
-    kDebug() << "not implemented in speech-dispatcher yet";
-    return 0;
+    return getJobNumbers(priority).count();
 }
 
 QStringList Jovie::getJobNumbers(int priority)
 {
-    kDebug() << "not implemented in speech-dispatcher yet";
-    return QStringList();
+    JobRegistry::Filter filter;
+    if (!isSystemManager())
+        filter.appIds.append(callingAppId());
+    if (priority != KSpeech::jpAll)
+        filter.priorities = 1 << priority;
+    // Only jobs still in the queue.
+    filter.states = ~((1 << KSpeech::jsFinished) | (1 << KSpeech::jsDeleted));
+    QStringList jobNums;
+    foreach (const JobRegistry::Job &job, Speaker::Instance()->jobRegistry()->jobs(filter))
+        jobNums.append(QString::number(job.jobNum));
+    return jobNums;
 }
 
 int Jovie::getJobState(int jobNum)
 {
-    kDebug() << "not implemented in speech-dispatcher yet";
-    return 0;
+    const JobRegistry::Job *job = Speaker::Instance()->jobRegistry()->job(applyDefaultJobNum(jobNum));
+    return job ? job->state : 0;
 }
 
 QByteArray Jovie::getJobInfo(int jobNum)
 {
-    kDebug() << "not implemented in speech-dispatcher yet";
-    return QByteArray();
+    const JobRegistry::Job *job = Speaker::Instance()->jobRegistry()->job(applyDefaultJobNum(jobNum));
+    if (!job)
+        return QByteArray();
+    QByteArray jobInfo;
+    QDataStream stream(&jobInfo, QIODevice::WriteOnly);
+    const JobRegistry *registry = Speaker::Instance()->jobRegistry();
+    const QString appId = registry->appId(*job);
+    // The data of an application gone may have been collected already.
+    AppData *appData = Speaker::Instance()->findAppData(appId);
+    stream << job->priority << job->state << appId << registry->talker(*job)
+        << job->sentenceNum << job->sentenceCount
+        << (appData ? appData->applicationName() : appId);
+    return jobInfo;
 }
 
 QString Jovie::getJobSentence(int jobNum, int sentenceNum)
 {
-    kDebug() << "not implemented in speech-dispatcher yet";
-    return QString();
+    // Sentences are kept for plain text jobs until they end.
+    const SentenceBuffer *sentences = Speaker::Instance()->jobSentences(applyDefaultJobNum(jobNum));
+    return sentences ? sentences->sentence(sentenceNum - 1).toString() : QString();
+}
+
+QByteArray Jovie::getJobSnapshot(const QStringList &appIds, int priorities, int states)
+{
+    JobRegistry::Filter filter;
+    filter.appIds = appIds;
+    if (!isSystemManager())
+        filter.appIds = QStringList() << callingAppId();
+    filter.priorities = priorities;
+    filter.states = states;
+    return Speaker::Instance()->jobRegistry()->snapshot(filter);
+}
+
+QByteArray Jovie::getJobChangesSince(qulonglong seq)
+{
+    JobRegistry::Filter filter;
+    if (!isSystemManager())
+        filter.appIds.append(callingAppId());
+    return Speaker::Instance()->jobRegistry()->changesSince(seq, filter);
+}
+
+QVariantMap Jovie::getStats()
+{
+    return Speaker::Instance()->stats();
 }
 
 QStringList Jovie::getTalkerCodes()
@@ -441,25 +622,49 @@ QString Jovie::talkerToTalkerId(const QString &talker)
     return TalkerMgr::Instance()->talkerCodeToTalkerId(talker);
 }
 
+/**
+ * The voices of the catalog that can speak for a talker.
+ * @param talker         Talker code, or just a language code.
+ */
+static QList<CatalogVoice> talkerVoices(const QString &talker)
+{
+    QString module;
+    QString language = talker.trimmed();
+    if (language.startsWith(QLatin1Char('<')))
+    {
+        TalkerCode code(language);
+        module = code.outputModule();
+        language = code.language();
+    }
+    return VoiceCatalog::Instance()->voices(module, language);
+}
+
 int Jovie::getTalkerCapabilities1(const QString &talker)
 {
-    // TODO:
-    Q_UNUSED(talker);
-    return 0;
+    if (talkerVoices(talker).isEmpty())
+        return 0;
+    // The catalog only tells which voices a module has.  speech-dispatcher
+    // does not report what else a module supports, so nothing more is claimed.
+    return KSpeech::tcCanListVoices;
 }
 
 int Jovie::getTalkerCapabilities2(const QString &talker)
 {
-    // TODO:
     Q_UNUSED(talker);
+    // Only Jovie's own sentence marks are handled; the custom marks of SSML
+    // jobs are not passed on to applications, so nothing is claimed.
     return 0;
 }
 
 QStringList Jovie::getTalkerVoices(const QString &talker)
 {
-    // TODO:
-    Q_UNUSED(talker);
-    return QStringList();
+    QStringList voiceNames;
+    foreach (const CatalogVoice &voice, talkerVoices(talker))
+    {
+        if (!voiceNames.contains(voice.name))
+            voiceNames.append(voice.name);
+    }
+    return voiceNames;
 }
 
 void Jovie::changeJobTalker(int jobNum, const QString &talker)
@@ -475,8 +680,7 @@ void Jovie::moveJobLater(int jobNum)
 
 int Jovie::moveRelSentence(int jobNum, int n)
 {
-    kDebug() << "not implemented in speech-dispatcher yet";
-    return 0;
+    return Speaker::Instance()->moveRelSentence(applyDefaultJobNum(jobNum), n);
 }
 
 void Jovie::showManagerDialog()
@@ -490,32 +694,100 @@ void Jovie::kttsdExit()
 {
     announceEvent(QLatin1String( "kttsdExit" ), QLatin1String( "kttsdExiting" ));
     emit kttsdExiting();
+    Speaker::Instance()->requestExit();
     qApp->quit();
 }
 
 void Jovie::init()
 {
     new KSpeechAdaptor(this);
-    if (ready()) {
-        QDBusConnection::sessionBus().registerObject(QLatin1String( "/KSpeech" ), this, QDBusConnection::ExportAdaptors);
+    new JovieAdaptor(this);
+    connect(VoiceCatalog::Instance(), SIGNAL(scanFinished()), this, SLOT(slotVoicesScanned()));
+    connect(Speaker::Instance(), SIGNAL(jobStateChanged(QString,int,KSpeech::JobState)),
+        this, SLOT(slotJobStateChanged(QString,int,KSpeech::JobState)));
+    connect(Speaker::Instance(), SIGNAL(jobStateChanged(QString,int,KSpeech::JobState)),
+        &d->eventBatcher, SLOT(addEvent(QString,int,KSpeech::JobState)));
+    connect(Speaker::Instance(), SIGNAL(backpressure(QString,bool)),
+        this, SIGNAL(backpressure(QString,bool)));
+    d->eventBatcher.setInterval(JovieConfig::Instance()->snapshot()->jobEventInterval());
+    // Pick up kttsdrc edited by hand as well as through the KCM.
+    connect(JovieConfig::Instance(), SIGNAL(configChanged()), this, SLOT(reloadConfig()));
+    // Register first, so clients started at login do not wait for speech-dispatcher.
+    // Calls that need it wait for the connection, which is opened in the background.
+    QDBusConnection::sessionBus().registerObject(QLatin1String( "/KSpeech" ), this, QDBusConnection::ExportAdaptors);
+    StartupTimeline::reached(StartupTimeline::DBusRegistered);
+    if (!ready()) {
+        QDBusConnection::sessionBus().unregisterObject(QLatin1String( "/KSpeech" ));
+        return;
     }
+    updateSocketServer();
 }
 
 void Jovie::reinit()
 {
-    // Reload ourself.
-    kDebug() << "Jovie::reinit: Running";
-    //if (Speaker::Instance()->isSpeaking())
-    //    Speaker::Instance()->pause();
-    Speaker::Instance()->init();
-    QDBusConnection::sessionBus().unregisterObject(QLatin1String( "/KSpeech" ));
-    if (ready()) {
-        QDBusConnection::sessionBus().registerObject(QLatin1String( "/KSpeech" ), this, QDBusConnection::ExportAdaptors);
-    }
+    reloadConfig();
+}
+
+void Jovie::reloadConfig()
+{
+    kDebug() << "Jovie::reloadConfig: Running";
+    JovieConfig::Instance()->refresh();
+    reloadTalkers();
+    Speaker::Instance()->reloadFilters();
+    updateSocketServer();
+    d->eventBatcher.setInterval(JovieConfig::Instance()->snapshot()->jobEventInterval());
+    // The user may have installed or configured voices.
+    VoiceCatalog::Instance()->refresh();
+}
+
+void Jovie::reloadFilter(const QString &filterId)
+{
+    kDebug() << "Jovie::reloadFilter: " << filterId;
+    Speaker::Instance()->reloadFilter(filterId);
+}
 
+void Jovie::reloadTalkers()
+{
+    JovieConfig::Instance()->refresh();
+    TalkerMgr::Instance()->loadTalkers(JovieConfig::Instance()->snapshot());
+    Speaker::Instance()->reloadTalkers();
     d->trayIcon->slotUpdateTalkersMenu();
 }
 
+void Jovie::subscribeJobEvents(const QStringList &appIds)
+{
+    d->eventBatcher.subscribe(callingAppId(), appIds);
+}
+
+void Jovie::unsubscribeJobEvents()
+{
+    d->eventBatcher.unsubscribe(callingAppId());
+}
+
+void Jovie::setRateLimit(int jobsPerSecond, int burst)
+{
+    Speaker::Instance()->getAppData(callingAppId())->setRateLimit(jobsPerSecond, burst);
+}
+
+void Jovie::updateSocketServer()
+{
+    const bool enabled = JovieConfig::Instance()->snapshot()->localSocket();
+    if (enabled && !d->socketServer)
+    {
+        d->socketServer = new SocketServer(this);
+        if (!d->socketServer->listen())
+        {
+            delete d->socketServer;
+            d->socketServer = 0;
+        }
+    }
+    else if (!enabled && d->socketServer)
+    {
+        delete d->socketServer;
+        d->socketServer = 0;
+    }
+}
+
 void Jovie::setCallingAppId(const QString& appId)
 {
     d->callingAppId = appId;
@@ -551,7 +823,7 @@ bool Jovie::initializeSpeechData()
 
 bool Jovie::initializeTalkerMgr()
 {
-    TalkerMgr::Instance()->loadTalkers(KGlobal::config().data());
+    TalkerMgr::Instance()->loadTalkers(JovieConfig::Instance()->snapshot());
     return true;
 }
 
@@ -587,12 +859,89 @@ void Jovie::slotFilteringFinished()
 
 QString Jovie::callingAppId()
 {
-    // TODO: What would be nice is if there were a way to get the
-    // last DBUS sender() without having to add DBusMessage to every
-    // slot.  Then it would not be necessary to hand-edit the adaptor.
+    if (calledFromDBus())
+        return message().service();
     return d->callingAppId;
 }
 
+JovieCall Jovie::currentCall(bool delayReply)
+{
+    JovieCall call;
+    call.appId = callingAppId();
+    if (delayReply && calledFromDBus())
+    {
+        setDelayedReply(true);
+        call.message = message();
+    }
+    return call;
+}
+
+void Jovie::sendReply(const JovieCall &call, const QVariant &result)
+{
+    if (call.message.type() != QDBusMessage::MethodCallMessage)
+        return;
+    QDBusConnection::sessionBus().send(call.message.createReply(result));
+}
+
+void Jovie::slotFileRead()
+{
+    QFutureWatcher<QString> *watcher = static_cast<QFutureWatcher<QString> *>(sender());
+    PendingSay request = d->fileReads.take(watcher);
+    const QString text = watcher->result();
+    watcher->deleteLater();
+    if (text.isNull())
+    {
+        kDebug() << "Jovie::slotFileRead: could not read the file";
+        sendReply(request.call, 0);
+        return;
+    }
+    sendReply(request.call, Speaker::Instance()->say(request.appId, text, request.options));
+}
+
+void Jovie::slotPieceRead(const QString &text)
+{
+    TextStreamReader *reader = static_cast<TextStreamReader *>(sender());
+    QHash<TextStreamReader *, PendingSay>::iterator it = d->streams.find(reader);
+    if (it == d->streams.end())
+        return;
+    const int jobNum = Speaker::Instance()->say(it->appId, text, it->options);
+    if (jobNum == -1)
+    {
+        // The rest would be spoken with a gap, so it is not read.
+        kDebug() << "Jovie::slotPieceRead: a piece was refused, reading no further";
+        PendingSay request = d->streams.take(reader);
+        sendReply(request.call, request.jobNums);
+        reader->deleteLater();
+        return;
+    }
+    it->jobNums.append(QString::number(jobNum));
+    reader->pieceDone();
+}
+
+void Jovie::slotStreamFinished(bool ok)
+{
+    TextStreamReader *reader = static_cast<TextStreamReader *>(sender());
+    QHash<TextStreamReader *, PendingSay>::iterator it = d->streams.find(reader);
+    if (it == d->streams.end())
+        return;
+    PendingSay request = *it;
+    d->streams.erase(it);
+    if (!ok)
+        kDebug() << "Jovie::slotStreamFinished: could not read the text";
+    sendReply(request.call, request.jobNums);
+    reader->deleteLater();
+}
+
+void Jovie::slotVoicesScanned()
+{
+    if (d->talkerQueries.isEmpty())
+        return;
+    const QStringList talkers = Speaker::Instance()->getPossibleTalkers();
+    foreach (const JovieCall &call, d->talkerQueries)
+        sendReply(call, talkers);
+    d->talkerQueries.clear();
+}
+
 int Jovie::applyDefaultJobNum(int jobNum)
 {
     int jNum = jobNum;
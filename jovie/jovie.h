@@ -32,18 +32,22 @@
 #include <QtCore/QString>
 #include <QtCore/QStringList>
 #include <QtCore/QByteArray>
+#include <QtCore/QVariantMap>
+#include <QtDBus/QDBusContext>
+#include <QtDBus/QDBusUnixFileDescriptor>
 
 #include <kspeech.h>
 
 class JoviePrivate;
 class TalkerCode;
+struct JovieCall;
 
 /**
 * Jovie -- the KDE Text-to-Speech API.
 *
 * Note: Applications do not use this class directly.
 */
-class Jovie : public QObject
+class Jovie : public QObject, protected QDBusContext
 {
 Q_OBJECT
 public:
@@ -255,9 +259,30 @@ public Q_SLOTS: // METHODS
     * The text may contain speech mark language, such as SMML,
     * provided that the speech plugin/engine support it.  In this case,
     * sentence parsing follows the semantics of the markup language.
+    *
+    * Over DBUS the file is read in the background and the reply is delayed
+    * until the job has been queued.
     */
     int sayFile(const QString &filename, const QString &encoding);
 
+    /**
+    * Creates and starts speech jobs from text read from a file descriptor,
+    * such as a pipe or memfd.  Clients that do not share a filesystem with
+    * Jovie can send large texts this way without marshalling them.
+    * @param fd                 The file descriptor to read until its end.
+    * @param encoding           The encoding of the text.  Default UTF-8.
+    * @param options            Speech options.  @see SayOptions
+    * @return                   Job Numbers of the jobs, in the order they are spoken.
+    *
+    * The text is read in the background and queued as it arrives, in pieces
+    * that end at a paragraph or sentence, each piece a job of its own.  Markup
+    * (soHtml, soSsml, or SSML sent with no options) is read to its end, up to
+    * MaxPendingBytes, and queued as one job.  If a piece is refused, the text
+    * after it is not read.  Over DBUS the reply is sent once the last piece is
+    * queued; calls from within Jovie always get an empty list.
+    */
+    QStringList sayFd(const QDBusUnixFileDescriptor &fd, const QString &encoding, int options);
+
     /**
     * Submits a speech job from the contents of the clipboard.
     * The job is spoken using application's default talker.
@@ -290,6 +315,9 @@ public Q_SLOTS: // METHODS
      * Get all possible talkers supported by speech-dispatcher configuration
      *
      * @returns QStringList of talkercodes
+     *
+     * Over DBUS, while the voices are still being read, the reply is delayed
+     * until they are known.
      */
     QStringList getPossibleTalkers();
 
@@ -429,6 +457,54 @@ public Q_SLOTS: // METHODS
     */
     QString getJobSentence(int jobNum, int sentenceNum);
 
+    /**
+    * Returns the metadata of every matching job in one call, so a job list
+    * does not need a call per job.  Finished and deleted jobs are included
+    * until newer jobs push them out.
+    * @param appIds             DBUS connection names of the applications whose
+    *                           jobs to return.  Empty for all.  Ignored unless
+    *                           called from a System Manager; other applications
+    *                           get only their own jobs.
+    * @param priorities         Bit (1 << priority) set for each wanted
+    *                           JobPriority.  0 for all.
+    * @param states             Bit (1 << state) set for each wanted JobState.
+    *                           0 for all.
+    * @return                   A QDataStream (version Qt_4_8) containing a
+    *                           quint64 sequence number, a quint32 count and the
+    *                           jobs, each a qint32 jobNum, qint32 priority,
+    *                           qint32 state, QString appId, QString talker,
+    *                           qint32 sentenceNum and qint32 sentenceCount.
+    *
+    * Pass the sequence number to @ref getJobChangesSince to get the changes
+    * made after the snapshot.
+    */
+    QByteArray getJobSnapshot(const QStringList &appIds, int priorities, int states);
+
+    /**
+    * Returns the jobs that changed after a snapshot or an earlier call.
+    * @param seq                Sequence number returned by the previous call.
+    * @return                   A QDataStream (version Qt_4_8) containing the
+    *                           quint64 sequence number to pass next time, a bool
+    *                           that is false if some changes were already
+    *                           forgotten, a quint32 count and the changed jobs,
+    *                           as in @ref getJobSnapshot.
+    *
+    * If the bool is false, take a new snapshot.
+    *
+    * As with @ref getJobSnapshot, only a System Manager gets the jobs of
+    * other applications.
+    */
+    QByteArray getJobChangesSince(qulonglong seq);
+
+    /**
+    * Returns how much Jovie keeps about applications and jobs.
+    * @return                   "applications" and "unregistered" (applications
+    *                           gone whose jobs have not all ended), "jobs" and
+    *                           "liveJobs" (not yet ended), "appIds" interned and
+    *                           "bytes", the approximate memory of it all.
+    */
+    QVariantMap getStats();
+
     /**
     * Return a list of full Talker Codes for configured talkers.
     * @return               List of Talker codes.
@@ -509,6 +585,8 @@ public Q_SLOTS: // METHODS
     *
     * If no such job, does nothing and returns 0.
     * If n is zero, returns the current sentence number of the job.
+    * While other jobs are queued with speech-dispatcher, the job is not
+    * moved and its current sentence number is returned.
     * Does not affect the current speaking/not-speaking state of the job.
     *
     * Since ScreenReaderOutput jobs are not split into sentences, this method
@@ -534,12 +612,54 @@ public Q_SLOTS: // METHODS
 
     /**
     * Cause KTTSD to re-read its configuration.
+    * Same as @ref reloadConfig.
     */
     void reinit();
 
-    /** Called by DBusAdaptor so that KTTSD knows the application that
-    * called it.
-    * @param appId              DBUS connection name that called KSpeech.
+    /**
+    * Rereads kttsdrc.  Only the filters and talkers whose settings changed
+    * are loaded again, and /KSpeech stays registered, so speech goes on.
+    */
+    void reloadConfig();
+
+    /**
+    * Loads a filter again, even if its settings in kttsdrc did not change.
+    * @param filterId           ID of the filter, as in the Filter_<ID> group of kttsdrc.
+    */
+    void reloadFilter(const QString &filterId);
+
+    /**
+    * Rereads the talkers.
+    */
+    void reloadTalkers();
+
+    /**
+    * Starts sending the calling application batched job events, or changes
+    * which applications it wants them for.  Events are collected for
+    * JobEventInterval ms (General group of kttsdrc) and sent in one call to
+    * the caller's jobEvents method, however many jobs changed state meanwhile.
+    * @see JobEventBatcher
+    * @param appIds             DBUS connection names of the applications whose
+    *                           jobs to report.  Empty for all.
+    */
+    void subscribeJobEvents(const QStringList &appIds);
+
+    /**
+    * Stops sending the calling application batched job events.
+    */
+    void unsubscribeJobEvents();
+
+    /**
+    * Sets how many jobs a second the calling application may queue.  Jobs over
+    * the limit are refused, with a backpressure signal.
+    * @param jobsPerSecond      0 for the RateLimit of kttsdrc.
+    * @param burst              Jobs it may queue at once.  0 for the RateBurst of kttsdrc.
+    */
+    void setRateLimit(int jobsPerSecond, int burst);
+
+    /** Sets the application calls from within Jovie are made for.
+    * Calls over DBUS are made for their sender.
+    * @param appId              DBUS connection name.
     */
     void setCallingAppId(const QString& appId);
 
@@ -576,17 +696,41 @@ Q_SIGNALS: // SIGNALS
     */
     void marker(const QString &appId, int jobNum, int markerType, const QString &markerData);
 
+    /**
+    * Clients should slow down, or may speed up again.
+    * @param appId              DBUS connection name of the application over its
+    *                           rate limit, or empty for all applications when the
+    *                           text pending nears MaxPendingBytes.
+    * @param active             True to slow down.
+    */
+    void backpressure(const QString &appId, bool active);
+
 private slots:
     void slotJobStateChanged(const QString& appId, int jobNum, KSpeech::JobState state);
     void slotMarker(const QString& appId, int jobNum, KSpeech::MarkerType markerType, const QString& markerData);
     void slotFilteringFinished();
+    void slotFileRead();
+    void slotPieceRead(const QString &text);
+    void slotStreamFinished(bool ok);
+    void slotVoicesScanned();
 
 private:
     /**
-    * The DBUS connection name of the last application that called KTTSD.
+    * The DBUS connection name of the application making the current call.
     */
     QString callingAppId();
 
+    /*
+    * The current call.  If it came over DBUS and @p delayReply is true, the
+    * reply is delayed and must be sent with @ref sendReply.
+    */
+    JovieCall currentCall(bool delayReply = false);
+
+    /*
+    * Sends the delayed reply to a call.  Does nothing for calls from within Jovie.
+    */
+    void sendReply(const JovieCall &call, const QVariant &result);
+
     /*
     * Checks if KTTSD is ready to speak and at least one talker is configured.
     * If not, user is prompted to display the configuration dialog.
@@ -614,6 +758,11 @@ private:
     */
     bool initializeSpeaker();
 
+    /*
+    * Starts or stops the local socket endpoint, as configured.
+    */
+    void updateSocketServer();
+
     /*
     * If a job number is 0, returns the default job number for a command.
     * Returns the job number of the last job queued by the application, or if
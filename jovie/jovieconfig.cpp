@@ -0,0 +1,300 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Parsed kttsdrc shared by the parts of the daemon.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// JovieConfig includes.
+#include "jovieconfig.h"
+#include "jovieconfig.moc"
+
+// Qt includes.
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QTimer>
+
+// KDE includes.
+#include <kconfig.h>
+#include <kconfiggroup.h>
+#include <kdebug.h>
+#include <kdirwatch.h>
+#include <kspeech.h>
+#include <kstandarddirs.h>
+
+// KTTS includes.
+#include "filterplugins.h"
+
+/* ConfigSnapshot ========================================================= */
+
+ConfigSnapshot::ConfigSnapshot() :
+    m_generation(0),
+    m_localSocket(false),
+    m_jobEventInterval(200),
+    m_nativeSsip(false),
+    m_scheduler(false),
+    m_schedulerLookahead(2),
+    m_rateLimit(0),
+    m_rateBurst(10),
+    m_maxPendingBytes(16 * 1024 * 1024),
+    m_supersedeMask(0),
+    m_duplicateWindow(5000),
+    m_duplicateMask(0),
+    m_duplicateCounter(false),
+    m_journal(false)
+{
+}
+
+ConfigSnapshot::~ConfigSnapshot()
+{
+}
+
+quint64 ConfigSnapshot::generation() const
+{
+    return m_generation;
+}
+
+QStringList ConfigSnapshot::talkerIds() const
+{
+    return m_talkerIds;
+}
+
+TalkerCode::TalkerCodeList ConfigSnapshot::talkers() const
+{
+    return m_talkers;
+}
+
+TalkerCode ConfigSnapshot::defaultTalker() const
+{
+    return m_talkers.isEmpty() ? TalkerCode() : m_talkers.first();
+}
+
+QList<ConfigSnapshot::Filter> ConfigSnapshot::filters() const
+{
+    return m_filters;
+}
+
+bool ConfigSnapshot::localSocket() const
+{
+    return m_localSocket;
+}
+
+int ConfigSnapshot::jobEventInterval() const
+{
+    return m_jobEventInterval;
+}
+
+bool ConfigSnapshot::nativeSsip() const
+{
+    return m_nativeSsip;
+}
+
+bool ConfigSnapshot::scheduler() const
+{
+    return m_scheduler;
+}
+
+int ConfigSnapshot::schedulerLookahead() const
+{
+    return m_schedulerLookahead;
+}
+
+int ConfigSnapshot::schedulerWeight(const QString &applicationName) const
+{
+    return m_schedulerWeights.value(applicationName, 1);
+}
+
+int ConfigSnapshot::rateLimit() const
+{
+    return m_rateLimit;
+}
+
+int ConfigSnapshot::rateBurst() const
+{
+    return m_rateBurst;
+}
+
+qint64 ConfigSnapshot::maxPendingBytes() const
+{
+    return m_maxPendingBytes;
+}
+
+QString ConfigSnapshot::overflowPolicy() const
+{
+    return m_overflowPolicy;
+}
+
+bool ConfigSnapshot::supersedes(int priority) const
+{
+    return priority >= 0 && priority < 32 && (m_supersedeMask & (1 << priority));
+}
+
+int ConfigSnapshot::duplicateWindow() const
+{
+    return m_duplicateWindow;
+}
+
+bool ConfigSnapshot::suppressesDuplicates(int priority) const
+{
+    return priority >= 0 && priority < 32 && (m_duplicateMask & (1 << priority));
+}
+
+bool ConfigSnapshot::duplicateCounter() const
+{
+    return m_duplicateCounter;
+}
+
+bool ConfigSnapshot::journal() const
+{
+    return m_journal;
+}
+
+/* JovieConfig ============================================================ */
+
+JovieConfig * JovieConfig::m_instance = NULL;
+
+JovieConfig * JovieConfig::Instance()
+{
+    if (m_instance == NULL)
+    {
+        m_instance = new JovieConfig();
+    }
+    return m_instance;
+}
+
+JovieConfig::JovieConfig() :
+    m_generation(0),
+    m_size(-1),
+    m_watch(new KDirWatch(this)),
+    m_rebuildTimer(new QTimer(this))
+{
+    m_path = KStandardDirs::locateLocal("config", QLatin1String("kttsdrc"));
+    m_watch->addFile(m_path);
+    connect(m_watch, SIGNAL(dirty(QString)), this, SLOT(slotFileChanged()));
+    connect(m_watch, SIGNAL(created(QString)), this, SLOT(slotFileChanged()));
+    connect(m_watch, SIGNAL(deleted(QString)), this, SLOT(slotFileChanged()));
+
+    m_rebuildTimer->setSingleShot(true);
+    m_rebuildTimer->setInterval(200);
+    connect(m_rebuildTimer, SIGNAL(timeout()), this, SLOT(slotRebuild()));
+
+    rebuild();
+}
+
+JovieConfig::~JovieConfig()
+{
+}
+
+ConfigSnapshotPtr JovieConfig::snapshot() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_snapshot;
+}
+
+bool JovieConfig::refresh()
+{
+    QFileInfo info(m_path);
+    if (info.lastModified() == m_stamp && info.size() == m_size)
+        return false;
+    m_rebuildTimer->stop();
+    rebuild();
+    return true;
+}
+
+void JovieConfig::slotFileChanged()
+{
+    m_rebuildTimer->start();
+}
+
+void JovieConfig::slotRebuild()
+{
+    if (refresh())
+        emit configChanged();
+}
+
+void JovieConfig::rebuild()
+{
+    QFileInfo info(m_path);
+    m_stamp = info.lastModified();
+    m_size = info.exists() ? info.size() : -1;
+
+    ConfigSnapshot *snapshot = new ConfigSnapshot;
+    snapshot->m_generation = ++m_generation;
+    KConfig file(QLatin1String("kttsdrc"));
+    KConfig *config = &file;
+
+    KConfigGroup generalConfig(config, "General");
+    KConfigGroup talkerConfig(config, "Talkers");
+    snapshot->m_localSocket = generalConfig.readEntry("LocalSocket", false);
+    snapshot->m_jobEventInterval = generalConfig.readEntry("JobEventInterval", 200);
+    snapshot->m_nativeSsip = generalConfig.readEntry("NativeSsip", false);
+    snapshot->m_scheduler = generalConfig.readEntry("Scheduler", false);
+    snapshot->m_schedulerLookahead = qMax(1, generalConfig.readEntry("SchedulerLookahead", 2));
+    KConfigGroup weightsConfig(config, "SchedulerWeights");
+    foreach (const QString &applicationName, weightsConfig.keyList())
+        snapshot->m_schedulerWeights.insert(applicationName, qMax(1, weightsConfig.readEntry(applicationName, 1)));
+    snapshot->m_rateLimit = qMax(0, generalConfig.readEntry("RateLimit", 0));
+    snapshot->m_rateBurst = qMax(1, generalConfig.readEntry("RateBurst", 10));
+    snapshot->m_maxPendingBytes = qMax(qint64(0), generalConfig.readEntry("MaxPendingBytes", qint64(16 * 1024 * 1024)));
+    snapshot->m_overflowPolicy = generalConfig.readEntry("OverflowPolicy", QString::fromLatin1("reject"));
+    const QList<int> supersedePriorities = generalConfig.readEntry("SupersedePriorities",
+        QList<int>() << KSpeech::jpScreenReaderOutput << KSpeech::jpProgress);
+    foreach (int priority, supersedePriorities)
+    {
+        if (priority > 0 && priority < 32)
+            snapshot->m_supersedeMask |= 1 << priority;
+    }
+    snapshot->m_duplicateWindow = qMax(0, generalConfig.readEntry("DuplicateWindow", 5000));
+    const QList<int> duplicatePriorities = generalConfig.readEntry("DuplicatePriorities",
+        QList<int>() << KSpeech::jpWarning << KSpeech::jpMessage);
+    foreach (int priority, duplicatePriorities)
+    {
+        if (priority > 0 && priority < 32)
+            snapshot->m_duplicateMask |= 1 << priority;
+    }
+    snapshot->m_duplicateCounter = generalConfig.readEntry("DuplicateCounter", false);
+    snapshot->m_journal = generalConfig.readEntry("Journal", false);
+    snapshot->m_talkerIds = generalConfig.readEntry("TalkerIDs", QStringList());
+    foreach (const QString &talkerId, snapshot->m_talkerIds)
+        snapshot->m_talkers.append(TalkerCode(talkerConfig.readEntry(talkerId), true));
+
+    const QStringList filterIds = generalConfig.readEntry("FilterIDs", QStringList());
+    foreach (const QString &filterId, filterIds)
+    {
+        ConfigSnapshot::Filter filter;
+        filter.id = filterId;
+        filter.groupName = QLatin1String("Filter_") + filterId;
+        KConfigGroup filterConfig(config, filter.groupName);
+        filter.desktopEntryName = filterConfig.readEntry("DesktopEntryName");
+        // Filters configured before DesktopEntryNames were used only have the
+        // translated plugin name.
+        if (filter.desktopEntryName.isEmpty())
+            filter.desktopEntryName = FilterPlugins::self()->desktopEntryName(
+                filterConfig.readEntry("PlugInName", QString()));
+        filter.enabled = filterConfig.readEntry("Enabled", false);
+        filter.isSbd = filterConfig.readEntry("IsSBD", false);
+        filter.settings = filterConfig.entryMap();
+        snapshot->m_filters.append(filter);
+    }
+
+    kDebug() << "JovieConfig: snapshot" << snapshot->m_generation << "with"
+        << snapshot->m_talkers.count() << "talkers and" << snapshot->m_filters.count() << "filters";
+
+    QMutexLocker locker(&m_mutex);
+    m_snapshot = ConfigSnapshotPtr(snapshot);
+}
@@ -0,0 +1,261 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Parsed kttsdrc shared by the parts of the daemon.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef JOVIECONFIG_H
+#define JOVIECONFIG_H
+
+// Qt includes.
+#include <QtCore/QObject>
+#include <QtCore/QDateTime>
+#include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QStringList>
+
+// KTTS includes.
+#include "talkercode.h"
+
+class KDirWatch;
+class QTimer;
+
+/**
+ * @class ConfigSnapshot
+ *
+ * The contents of kttsdrc at one point in time.  A snapshot never changes once
+ * built, so it may be read from any thread.  A change of the file gives a new
+ * snapshot; see @ref JovieConfig.
+ */
+class ConfigSnapshot
+{
+public:
+    /**
+     * A filter listed in FilterIDs.
+     */
+    struct Filter
+    {
+        QString id;                         /* filter ID */
+        QString groupName;                  /* "Filter_" + id */
+        QString desktopEntryName;           /* plugin */
+        bool enabled;
+        bool isSbd;
+        QMap<QString, QString> settings;    /* entries of the Filter_<ID> group */
+    };
+
+    ~ConfigSnapshot();
+
+    /**
+     * Increases with every snapshot built.
+     */
+    quint64 generation() const;
+
+    /**
+     * The talker IDs and talkers, in order.  The first is the default talker.
+     */
+    QStringList talkerIds() const;
+    TalkerCode::TalkerCodeList talkers() const;
+    TalkerCode defaultTalker() const;
+
+    /**
+     * The filters, in the order of FilterIDs.
+     */
+    QList<Filter> filters() const;
+
+    /**
+     * Whether the local socket endpoint is enabled (LocalSocket in General).
+     */
+    bool localSocket() const;
+
+    /**
+     * Milliseconds job events are collected before a batch is sent
+     * (JobEventInterval in General).
+     */
+    int jobEventInterval() const;
+
+    /**
+     * Whether jobs are sent with Jovie's own SSIP client rather than
+     * libspeechd (NativeSsip in General).
+     */
+    bool nativeSsip() const;
+
+    /**
+     * Whether jobs wait in Jovie's scheduler, rather than all going to
+     * speech-dispatcher at once (Scheduler in General).
+     */
+    bool scheduler() const;
+
+    /**
+     * Number of scheduled jobs handed to speech-dispatcher at a time
+     * (SchedulerLookahead in General).
+     */
+    int schedulerLookahead() const;
+
+    /**
+     * Scheduling weight of an application, from the SchedulerWeights group.
+     * 1 for applications not listed.
+     * @param applicationName   D-Bus service name of the application.
+     */
+    int schedulerWeight(const QString &applicationName) const;
+
+    /**
+     * Jobs a second an application may queue, 0 for no limit (RateLimit in
+     * General), and how many it may queue at once (RateBurst in General).
+     * Applications may set their own through AppData.
+     */
+    int rateLimit() const;
+    int rateBurst() const;
+
+    /**
+     * Size of the text of the jobs queued and not ended, above which new jobs
+     * overflow.  0 for no limit (MaxPendingBytes in General).
+     */
+    qint64 maxPendingBytes() const;
+
+    /**
+     * What is done with a job that overflows: "reject", "drop-oldest" or
+     * "drop-lowest-priority" (OverflowPolicy in General).
+     */
+    QString overflowPolicy() const;
+
+    /**
+     * Whether a new job of the priority replaces the job of the same
+     * application and priority queued before it (SupersedePriorities in
+     * General, by default screen reader output and progress reports).
+     * @param priority          A KSpeech::JobPriority.
+     */
+    bool supersedes(int priority) const;
+
+    /**
+     * Milliseconds within which a message repeated by an application is not
+     * spoken again, 0 to speak every repeat (DuplicateWindow in General).
+     */
+    int duplicateWindow() const;
+
+    /**
+     * Whether repeats of jobs of the priority are suppressed
+     * (DuplicatePriorities in General, by default warnings and messages).
+     * @param priority          A KSpeech::JobPriority.
+     */
+    bool suppressesDuplicates(int priority) const;
+
+    /**
+     * Whether the number of repeats suppressed is told once the window ends
+     * (DuplicateCounter in General).
+     */
+    bool duplicateCounter() const;
+
+    /**
+     * Whether text jobs are journaled, to be queued again after a crash
+     * (Journal in General).  Off unless set, as their text goes to disk.
+     */
+    bool journal() const;
+
+private:
+    ConfigSnapshot();
+    Q_DISABLE_COPY(ConfigSnapshot)
+
+    quint64 m_generation;
+    QStringList m_talkerIds;
+    TalkerCode::TalkerCodeList m_talkers;
+    QList<Filter> m_filters;
+    bool m_localSocket;
+    int m_jobEventInterval;
+    bool m_nativeSsip;
+    bool m_scheduler;
+    int m_schedulerLookahead;
+    QMap<QString, int> m_schedulerWeights;
+    int m_rateLimit;
+    int m_rateBurst;
+    qint64 m_maxPendingBytes;
+    QString m_overflowPolicy;
+    int m_supersedeMask;    /* bit (1 << priority) */
+    int m_duplicateWindow;
+    int m_duplicateMask;    /* bit (1 << priority) */
+    bool m_duplicateCounter;
+    bool m_journal;
+
+    friend class JovieConfig;
+};
+
+typedef QSharedPointer<const ConfigSnapshot> ConfigSnapshotPtr;
+
+/**
+ * @class JovieConfig
+ *
+ * Holds the current snapshot of kttsdrc.  The file is parsed once per change:
+ * it is watched, and when it changes a new snapshot is built and replaces the
+ * current one.  Users keep the snapshot they got for as long as they need a
+ * consistent view.
+ */
+class JovieConfig : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * singleton accessor
+     */
+    static JovieConfig * Instance();
+
+    ~JovieConfig();
+
+    /**
+     * The current snapshot.  Thread safe.
+     */
+    ConfigSnapshotPtr snapshot() const;
+
+    /**
+     * Builds a new snapshot if kttsdrc changed since the current one was built.
+     * @return                  True if there is a new snapshot.
+     */
+    bool refresh();
+
+signals:
+    /**
+     * Emitted when a change of kttsdrc on disk gave a new snapshot.
+     */
+    void configChanged();
+
+private slots:
+    void slotFileChanged();
+    void slotRebuild();
+
+private:
+    JovieConfig();
+
+    void rebuild();
+
+    mutable QMutex m_mutex;
+    ConfigSnapshotPtr m_snapshot;
+    quint64 m_generation;
+    QString m_path;
+    // Modification time and size of kttsdrc when the snapshot was built.
+    QDateTime m_stamp;
+    qint64 m_size;
+    KDirWatch *m_watch;
+    // Collects the notifications of one save into one rebuild.
+    QTimer *m_rebuildTimer;
+
+    static JovieConfig * m_instance;
+};
+
+#endif // JOVIECONFIG_H
@@ -23,6 +23,7 @@
 // Jovie includes.
 #include "jovietrayicon.h"
 #include "jovie.h"
+#include "jovieconfig.h"
 
 // Qt includes.
 #include <QtGui/QImage>
@@ -40,7 +41,6 @@
 #include <kaboutdata.h>
 #include <kaction.h>
 #include <kcmdlineargs.h>
-#include <kconfig.h>
 #include <kdebug.h>
 #include <kicon.h>
 #include <klocale.h>
@@ -133,11 +133,8 @@ JovieTrayIcon::~JovieTrayIcon()
 void JovieTrayIcon::slotUpdateTalkersMenu(){
     talkersMenu->clear();
     
-    // Object for the KTTSD configuration.
-    KConfig config(QLatin1String( "kttsdrc" ));
-
     // Load existing Talkers into Talker List.
-    TalkerCode::TalkerCodeList list = TalkerCode::loadTalkerCodesFromConfig(&config);
+    TalkerCode::TalkerCodeList list = JovieConfig::Instance()->snapshot()->talkers();
 
     for (int i=0;i<list.size();i++) {
        TalkerCode talkerCode=list.at(i);
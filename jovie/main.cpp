@@ -35,8 +35,10 @@
 
 // KTTSD includes.
 #include "jovie.h"
+#include "startuptimeline.h"
 
 int main (int argc, char *argv[]){
+    StartupTimeline::start();
     KAboutData aboutdata("jovie", 0, ki18n("Jovie"),
          "0.6.0", ki18n("Text-to-speech synthesis daemon"),
          KAboutData::License_GPL, ki18n("(C) 2002, José Pablo Ezequiel Fernández"));
@@ -0,0 +1,498 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  A speech-dispatcher stand-in for tests and benchmarks.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// MockSpeechd includes.
+#include "mockspeechd.h"
+#include "mockspeechd.moc"
+
+// Qt includes.
+#include <QtCore/QFile>
+#include <QtCore/QRegExp>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
+
+static QByteArray notificationName(int code)
+{
+    switch (code)
+    {
+        case 700: return "index_marks";
+        case 701: return "begin";
+        case 702: return "end";
+        case 703: return "cancel";
+        case 704: return "pause";
+        case 705: return "resume";
+    }
+    return QByteArray();
+}
+
+static QByteArray eventText(int code)
+{
+    switch (code)
+    {
+        case 700: return "INDEX MARK";
+        case 701: return "BEGIN";
+        case 702: return "END";
+        case 703: return "CANCELED";
+        case 704: return "PAUSED";
+        case 705: return "RESUMED";
+    }
+    return QByteArray();
+}
+
+MockSpeechd::MockSpeechd(QObject *parent) :
+    QObject(parent),
+    m_server(new QLocalServer(this)),
+    m_speaking(false),
+    m_paused(false),
+    m_baseMsec(0),
+    m_perCharMsec(0),
+    m_replyDelay(0),
+    m_holding(false),
+    m_disconnectAfter(0),
+    m_lastClientId(0),
+    m_lastMsgId(0),
+    m_spoken(0)
+{
+    m_stepTimer.setSingleShot(true);
+    connect(&m_stepTimer, SIGNAL(timeout()), this, SLOT(slotStep()));
+    connect(m_server, SIGNAL(newConnection()), this, SLOT(slotNewConnection()));
+}
+
+MockSpeechd::~MockSpeechd()
+{
+    while (!m_clients.isEmpty())
+        dropClient(m_clients.first());
+    m_server->close();
+    QLocalServer::removeServer(m_path);
+}
+
+bool MockSpeechd::listen(const QString &path)
+{
+    QLocalServer::removeServer(path);
+    m_path = path;
+    return m_server->listen(path);
+}
+
+QByteArray MockSpeechd::address() const
+{
+    return "unix_socket:" + QFile::encodeName(m_path);
+}
+
+void MockSpeechd::setSpeakingDuration(int baseMsec, int perCharMsec)
+{
+    m_baseMsec = baseMsec;
+    m_perCharMsec = perCharMsec;
+}
+
+void MockSpeechd::setReplyDelay(int msec)
+{
+    m_replyDelay = msec;
+}
+
+void MockSpeechd::setHolding(bool holding)
+{
+    m_holding = holding;
+    if (holding)
+        return;
+    const QList<Reply> held = m_held;
+    m_held.clear();
+    foreach (const Reply &r, held)
+        send(r);
+}
+
+void MockSpeechd::setError(const QByteArray &prefix, const QByteArray &reply)
+{
+    m_errorPrefix = reply.isEmpty() ? QByteArray() : prefix;
+    m_errorReply = reply;
+}
+
+void MockSpeechd::disconnectAfter(int commands)
+{
+    m_disconnectAfter = commands;
+    if (commands == 0)
+        disconnectClients();
+}
+
+void MockSpeechd::disconnectClients(const QByteArray &component)
+{
+    const QList<Client *> clients = m_clients;
+    foreach (Client *client, clients)
+    {
+        if (component.isEmpty() || client->name.endsWith(':' + component))
+            dropClient(client);
+    }
+}
+
+void MockSpeechd::sendRaw(const QByteArray &data)
+{
+    if (m_clients.isEmpty())
+        return;
+    m_clients.last()->socket->write(data);
+    m_clients.last()->socket->flush();
+}
+
+QList<QByteArray> MockSpeechd::commands() const
+{
+    return m_commands;
+}
+
+QList<QByteArray> MockSpeechd::messages() const
+{
+    return m_messages;
+}
+
+int MockSpeechd::spokenCount() const
+{
+    return m_spoken;
+}
+
+int MockSpeechd::queuedCount() const
+{
+    return m_queue.count() + (m_speaking ? 1 : 0);
+}
+
+void MockSpeechd::slotNewConnection()
+{
+    while (m_server->hasPendingConnections())
+    {
+        Client *client = new Client;
+        client->socket = m_server->nextPendingConnection();
+        client->clientId = ++m_lastClientId;
+        client->inData = false;
+        m_clients.append(client);
+        connect(client->socket, SIGNAL(readyRead()), this, SLOT(slotReadyRead()));
+        connect(client->socket, SIGNAL(disconnected()), this, SLOT(slotDisconnected()));
+    }
+}
+
+void MockSpeechd::slotReadyRead()
+{
+    Client *client = clientOf(qobject_cast<QLocalSocket *>(sender()));
+    while (client && client->socket->canReadLine())
+    {
+        QByteArray line = client->socket->readLine();
+        while (line.endsWith('\n') || line.endsWith('\r'))
+            line.chop(1);
+        if (client->inData)
+        {
+            if (line == ".")
+            {
+                client->inData = false;
+                QByteArray text;
+                for (int i = 0; i < client->data.count(); ++i)
+                    text += (i ? "\r\n" : "") + client->data.at(i);
+                client->data.clear();
+                queueMessage(client, text);
+                continue;
+            }
+            if (line.startsWith(".."))
+                line.remove(0, 1);
+            client->data.append(line);
+            continue;
+        }
+        handleCommand(client, line);
+        // The command may have dropped the connection.
+        client = clientOf(qobject_cast<QLocalSocket *>(sender()));
+    }
+}
+
+void MockSpeechd::slotDisconnected()
+{
+    Client *client = clientOf(qobject_cast<QLocalSocket *>(sender()));
+    if (client)
+        dropClient(client);
+}
+
+void MockSpeechd::slotSendDelayed()
+{
+    if (!m_delayed.isEmpty())
+        send(m_delayed.takeFirst());
+}
+
+void MockSpeechd::slotStep()
+{
+    if (m_steps.isEmpty())
+        return;
+    const Step step = m_steps.takeFirst();
+    if (step.code == 702)
+    {
+        endCurrent(702);
+        return;
+    }
+    sendEvent(m_current, step.code, step.mark);
+    if (!m_steps.isEmpty())
+        m_stepTimer.start(m_steps.first().delay);
+}
+
+MockSpeechd::Client *MockSpeechd::clientOf(QLocalSocket *socket)
+{
+    foreach (Client *client, m_clients)
+    {
+        if (client->socket == socket)
+            return client;
+    }
+    return 0;
+}
+
+void MockSpeechd::dropClient(Client *client)
+{
+    m_clients.removeAll(client);
+    for (int i = m_queue.count() - 1; i >= 0; --i)
+    {
+        if (m_queue.at(i).clientId == client->clientId)
+            m_queue.removeAt(i);
+    }
+    client->socket->disconnect(this);
+    client->socket->abort();
+    client->socket->deleteLater();
+    delete client;
+}
+
+bool MockSpeechd::targets(const Message &message, const Client *client, const QByteArray &target)
+{
+    if (target == "all")
+        return true;
+    if (target == "self")
+        return message.clientId == client->clientId;
+    return message.clientId == target.toInt();
+}
+
+void MockSpeechd::handleCommand(Client *client, const QByteArray &line)
+{
+    m_commands.append(line);
+    if (m_disconnectAfter > 0 && --m_disconnectAfter == 0)
+    {
+        disconnectClients();
+        return;
+    }
+    if (!m_errorPrefix.isEmpty() && line.startsWith(m_errorPrefix))
+    {
+        reply(client, m_errorReply);
+        return;
+    }
+
+    const QByteArray upper = line.toUpper();
+    const QList<QByteArray> words = line.split(' ');
+    // Target of STOP, CANCEL, PAUSE and RESUME: all, self or a client id.
+    const QByteArray target = words.value(1).toLower();
+    if (upper == "SPEAK")
+    {
+        client->inData = true;
+        reply(client, "230 OK RECEIVING DATA\r\n");
+    }
+    else if (upper.startsWith("KEY ") || upper.startsWith("CHAR ") || upper.startsWith("SOUND_ICON "))
+        queueMessage(client, line.mid(line.indexOf(' ') + 1));
+    else if (upper == "BLOCK BEGIN")
+        reply(client, "260 OK INSIDE BLOCK\r\n");
+    else if (upper == "BLOCK END")
+        reply(client, "261 OK OUTSIDE BLOCK\r\n");
+    else if (upper.startsWith("SET SELF CLIENT_NAME "))
+    {
+        client->name = words.value(3);
+        reply(client, "208 OK CLIENT NAME SET\r\n");
+    }
+    else if (upper.startsWith("SET SELF NOTIFICATION "))
+    {
+        const QByteArray type = words.value(3).toLower();
+        const bool on = words.value(4).toLower() == "on";
+        QList<QByteArray> types;
+        if (type == "all")
+        {
+            for (int code = 700; code <= 705; ++code)
+                types.append(notificationName(code));
+        }
+        else
+            types.append(type);
+        foreach (const QByteArray &t, types)
+        {
+            if (on)
+                client->notifications.insert(t);
+            else
+                client->notifications.remove(t);
+        }
+        reply(client, "218 OK NOTIFICATION SET\r\n");
+    }
+    else if (upper.startsWith("SET "))
+        reply(client, "200 OK SET\r\n");
+    else if (upper == "LIST OUTPUT_MODULES")
+        reply(client, "250-mock\r\n250 OK MODULE LIST SENT\r\n");
+    else if (upper == "LIST SYNTHESIS_VOICES")
+        reply(client, "249-Mock\ten\tnone\r\n249 OK VOICE LIST SENT\r\n");
+    else if (upper == "HISTORY GET CLIENT_ID")
+        reply(client, "245-" + QByteArray::number(client->clientId) + "\r\n245 OK CLIENT ID SENT\r\n");
+    else if (upper.startsWith("STOP"))
+    {
+        if (m_speaking && targets(m_current, client, target))
+            endCurrent(703);
+        reply(client, "210 OK STOPPED\r\n");
+    }
+    else if (upper.startsWith("CANCEL"))
+    {
+        for (int i = 0; i < m_queue.count(); )
+        {
+            if (targets(m_queue.at(i), client, target))
+                sendEvent(m_queue.takeAt(i), 703);
+            else
+                ++i;
+        }
+        if (m_speaking && targets(m_current, client, target))
+            endCurrent(703);
+        reply(client, "213 OK CANCELED\r\n");
+    }
+    else if (upper.startsWith("PAUSE"))
+    {
+        if (m_speaking && !m_paused && targets(m_current, client, target))
+        {
+            m_paused = true;
+            m_stepTimer.stop();
+            sendEvent(m_current, 704);
+        }
+        reply(client, "211 OK PAUSED\r\n");
+    }
+    else if (upper.startsWith("RESUME"))
+    {
+        if (m_paused && targets(m_current, client, target))
+        {
+            // The interrupted step starts over.
+            m_paused = false;
+            sendEvent(m_current, 705);
+            if (!m_steps.isEmpty())
+                m_stepTimer.start(m_steps.first().delay);
+        }
+        reply(client, "212 OK RESUMED\r\n");
+    }
+    else if (upper == "QUIT")
+    {
+        reply(client, "231 HAPPY HACKING\r\n");
+        client->socket->disconnectFromServer();
+    }
+    else
+        reply(client, "200 OK\r\n");
+}
+
+void MockSpeechd::queueMessage(Client *client, const QByteArray &text)
+{
+    Message message;
+    message.msgId = ++m_lastMsgId;
+    message.clientId = client->clientId;
+    message.text = text;
+    QRegExp markExp(QLatin1String("<mark\\s+name=\"([^\"]*)\""));
+    const QString str = QString::fromUtf8(text);
+    for (int pos = 0; (pos = markExp.indexIn(str, pos)) >= 0; pos += markExp.matchedLength())
+        message.marks.append(markExp.cap(1).toUtf8());
+    m_messages.append(text);
+    reply(client, "225-" + QByteArray::number(message.msgId) + "\r\n225 OK MESSAGE QUEUED\r\n", message);
+}
+
+void MockSpeechd::reply(Client *client, const QByteArray &data, const Message &message)
+{
+    Reply r;
+    r.socket = client->socket;
+    r.data = data;
+    r.message = message;
+    if (m_holding)
+        m_held.append(r);
+    else if (m_replyDelay > 0)
+    {
+        m_delayed.append(r);
+        QTimer::singleShot(m_replyDelay, this, SLOT(slotSendDelayed()));
+    }
+    else
+        send(r);
+}
+
+void MockSpeechd::send(const Reply &r)
+{
+    if (!r.socket)
+        return;
+    r.socket->write(r.data);
+    // A message is spoken only once the client knows its id, as with speech-dispatcher.
+    if (r.message.msgId)
+    {
+        m_queue.append(r.message);
+        startNext();
+    }
+}
+
+void MockSpeechd::startNext()
+{
+    if (m_speaking || m_queue.isEmpty())
+        return;
+    m_current = m_queue.takeFirst();
+    m_speaking = true;
+    m_paused = false;
+    sendEvent(m_current, 701);
+
+    // Index marks are spread evenly over the time the message takes.
+    const int duration = m_baseMsec + m_perCharMsec * m_current.text.length();
+    const int parts = m_current.marks.count() + 1;
+    m_steps.clear();
+    foreach (const QByteArray &mark, m_current.marks)
+    {
+        Step step;
+        step.delay = duration / parts;
+        step.code = 700;
+        step.mark = mark;
+        m_steps.append(step);
+    }
+    Step end;
+    end.delay = duration - (parts - 1) * (duration / parts);
+    end.code = 702;
+    m_steps.append(end);
+    m_stepTimer.start(m_steps.first().delay);
+}
+
+void MockSpeechd::endCurrent(int code)
+{
+    m_stepTimer.stop();
+    m_steps.clear();
+    m_speaking = false;
+    m_paused = false;
+    const Message message = m_current;
+    m_current = Message();
+    sendEvent(message, code);
+    if (code == 702)
+    {
+        ++m_spoken;
+        emit messageSpoken(message.msgId);
+    }
+    startNext();
+}
+
+void MockSpeechd::sendEvent(const Message &message, int code, const QByteArray &mark)
+{
+    Client *client = 0;
+    foreach (Client *c, m_clients)
+    {
+        if (c->clientId == message.clientId)
+            client = c;
+    }
+    if (!client || !client->notifications.contains(notificationName(code)))
+        return;
+    const QByteArray prefix = QByteArray::number(code);
+    QByteArray data = prefix + '-' + QByteArray::number(message.msgId) + "\r\n"
+        + prefix + '-' + QByteArray::number(message.clientId) + "\r\n";
+    if (code == 700)
+        data += prefix + '-' + mark + "\r\n";
+    data += prefix + ' ' + eventText(code) + "\r\n";
+    client->socket->write(data);
+}
@@ -0,0 +1,221 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  A speech-dispatcher stand-in for tests and benchmarks.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef MOCKSPEECHD_H
+#define MOCKSPEECHD_H
+
+// Qt includes.
+#include <QtCore/QObject>
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QPointer>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+#include <QtCore/QTimer>
+
+class QLocalServer;
+class QLocalSocket;
+
+/**
+ * @class MockSpeechd
+ *
+ * Answers SSIP on a local socket the way speech-dispatcher does, without
+ * any audio, so Speaker and SsipClient can be tested and measured on
+ * machines that have neither speech-dispatcher nor a sound card.
+ *
+ * Point libspeechd and SsipClient at it by setting SPEECHD_ADDRESS to
+ * @ref address before they connect.
+ *
+ * Messages are "spoken" one after the other, each for a set time, and the
+ * BEGIN, INDEX_MARK and END events are sent to the clients that asked for
+ * them.  STOP, CANCEL, PAUSE and RESUME work on all messages, the messages
+ * of the client, or those of another client, by its id.
+ * Every command and message is recorded.
+ *
+ * Failures can be injected: error replies to chosen commands, slow or held
+ * replies, and dropped connections.
+ */
+class MockSpeechd : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MockSpeechd(QObject *parent = 0);
+    ~MockSpeechd();
+
+    /**
+     * Starts listening.  A stale socket at @p path is removed.
+     */
+    bool listen(const QString &path);
+
+    /**
+     * The value of SPEECHD_ADDRESS for this server.
+     */
+    QByteArray address() const;
+
+    /**
+     * Sets how long a message is spoken: @p baseMsec plus @p perCharMsec per
+     * character.  Default 0, which still ends messages in a later event loop pass.
+     */
+    void setSpeakingDuration(int baseMsec, int perCharMsec = 0);
+
+    /**
+     * Delays every reply by @p msec, as a busy speech-dispatcher does.
+     */
+    void setReplyDelay(int msec);
+
+    /**
+     * While holding, replies are kept back.  They are sent when released.
+     */
+    void setHolding(bool holding);
+
+    /**
+     * Answers commands starting with @p prefix with @p reply, a complete
+     * reply with line ends.  An empty reply removes the error.
+     */
+    void setError(const QByteArray &prefix, const QByteArray &reply);
+
+    /**
+     * Drops the connections after @p commands more commands.
+     */
+    void disconnectAfter(int commands);
+
+    /**
+     * Drops the connections of the clients whose CLIENT_NAME ends with
+     * ":" @p component, or all connections if @p component is empty.
+     */
+    void disconnectClients(const QByteArray &component = QByteArray());
+
+    /**
+     * Writes @p data to the newest connection as it is.
+     */
+    void sendRaw(const QByteArray &data);
+
+    /**
+     * The commands received, without line ends and without SPEAK data.
+     */
+    QList<QByteArray> commands() const;
+
+    /**
+     * The messages received, unescaped.
+     */
+    QList<QByteArray> messages() const;
+
+    /**
+     * Number of messages spoken to their end.
+     */
+    int spokenCount() const;
+
+    /**
+     * Number of messages queued or being spoken.
+     */
+    int queuedCount() const;
+
+signals:
+    /**
+     * A message was spoken to its end.
+     */
+    void messageSpoken(int msgId);
+
+private slots:
+    void slotNewConnection();
+    void slotReadyRead();
+    void slotDisconnected();
+    void slotSendDelayed();
+    void slotStep();
+
+private:
+    struct Client
+    {
+        QLocalSocket *socket;
+        int clientId;
+        QByteArray name;
+        bool inData;
+        QList<QByteArray> data;
+        QSet<QByteArray> notifications;
+    };
+
+    struct Message
+    {
+        Message() : msgId(0), clientId(0) {}
+
+        int msgId;
+        int clientId;
+        QByteArray text;
+        QList<QByteArray> marks;
+    };
+
+    // A reply on its way, and the message to queue once it has been sent.
+    struct Reply
+    {
+        QPointer<QLocalSocket> socket;
+        QByteArray data;
+        Message message;
+    };
+
+    // An event of the message being spoken, due after the previous one.
+    struct Step
+    {
+        int delay;
+        int code;
+        QByteArray mark;
+    };
+
+    Client *clientOf(QLocalSocket *socket);
+    void dropClient(Client *client);
+    void handleCommand(Client *client, const QByteArray &line);
+    // Whether a STOP, CANCEL, PAUSE or RESUME of @p target, which is all,
+    // self or a client id, applies to a message.
+    static bool targets(const Message &message, const Client *client, const QByteArray &target);
+    void queueMessage(Client *client, const QByteArray &text);
+    void reply(Client *client, const QByteArray &data, const Message &message = Message());
+    void send(const Reply &reply);
+    void startNext();
+    void endCurrent(int code);
+    void sendEvent(const Message &message, int code, const QByteArray &mark = QByteArray());
+
+    QLocalServer *m_server;
+    QString m_path;
+    QList<Client *> m_clients;
+    QList<QByteArray> m_commands;
+    QList<QByteArray> m_messages;
+    QList<Message> m_queue;
+    Message m_current;
+    bool m_speaking;
+    bool m_paused;
+    QList<Step> m_steps;
+    QTimer m_stepTimer;
+    QList<Reply> m_delayed;
+    QList<Reply> m_held;
+    QByteArray m_errorPrefix;
+    QByteArray m_errorReply;
+    int m_baseMsec;
+    int m_perCharMsec;
+    int m_replyDelay;
+    bool m_holding;
+    int m_disconnectAfter;
+    int m_lastClientId;
+    int m_lastMsgId;
+    int m_spoken;
+};
+
+#endif // MOCKSPEECHD_H
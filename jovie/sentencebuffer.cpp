@@ -0,0 +1,148 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Sentences of a speech job in one contiguous buffer.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// SentenceBuffer includes.
+#include "sentencebuffer.h"
+
+// Qt includes.
+#include <QtCore/QRegExp>
+
+static bool isBlank(QChar c)
+{
+    const ushort u = c.unicode();
+    return u == ' ' || u == '\t' || u == '\f' || u == '\n' || u == '\r';
+}
+
+SentenceBuffer::SentenceBuffer()
+{
+}
+
+SentenceBuffer::SentenceBuffer(const QString &text, const QRegExp &delimiter)
+{
+    // Runs of spaces, tabs and formfeeds become one space first, as the
+    // delimiter may look at them; newlines are kept for "\n *\n".
+    QString collapsed;
+    collapsed.reserve(text.length());
+    const QChar *in = text.constData();
+    const QChar *end = in + text.length();
+    for (; in != end; ++in)
+    {
+        const ushort u = in->unicode();
+        if (u == ' ' || u == '\t' || u == '\f')
+        {
+            if (collapsed.isEmpty() || collapsed.at(collapsed.length() - 1) != QLatin1Char(' '))
+                collapsed += QLatin1Char(' ');
+        }
+        else
+            collapsed += *in;
+    }
+
+    // Each sentence is copied once, with its newlines made spaces and the
+    // spaces around it trimmed, and blank sentences are left out.
+    m_text.reserve(collapsed.length());
+    QRegExp rx(delimiter);
+    int from = 0;
+    int searchFrom = 0;
+    for (;;)
+    {
+        const int pos = rx.indexIn(collapsed, searchFrom);
+        if (pos >= 0 && rx.matchedLength() == 0)
+        {
+            // An empty match ends nothing; look further on.
+            searchFrom = pos + 1;
+            if (searchFrom <= collapsed.length())
+                continue;
+        }
+        const bool found = pos >= 0 && rx.matchedLength() > 0;
+        const int sentenceEnd = found ? pos + rx.cap(1).length() : collapsed.length();
+        int first = from;
+        int last = sentenceEnd;
+        while (first < last && isBlank(collapsed.at(first)))
+            ++first;
+        while (last > first && isBlank(collapsed.at(last - 1)))
+            --last;
+        if (first < last)
+        {
+            if (!m_ends.isEmpty())
+                m_text += QLatin1Char(' ');
+            for (int i = first; i < last; ++i)
+            {
+                const QChar c = collapsed.at(i);
+                m_text += (c == QLatin1Char('\n') || c == QLatin1Char('\r')) ? QChar(QLatin1Char(' ')) : c;
+            }
+            m_ends.append(m_text.length());
+        }
+        if (!found)
+            break;
+        from = searchFrom = pos + rx.matchedLength();
+        if (from >= collapsed.length())
+            break;
+    }
+    m_text.squeeze();
+    m_ends.squeeze();
+}
+
+SentenceBuffer::SentenceBuffer(const QString &text) :
+    m_text(text)
+{
+    if (!text.isEmpty())
+        m_ends.append(text.length());
+}
+
+int SentenceBuffer::count() const
+{
+    return m_ends.count();
+}
+
+bool SentenceBuffer::isEmpty() const
+{
+    return m_ends.isEmpty();
+}
+
+QStringRef SentenceBuffer::sentence(int n) const
+{
+    if (n < 0 || n >= m_ends.count())
+        return QStringRef();
+    const int first = start(n);
+    return QStringRef(&m_text, first, m_ends.at(n) - first);
+}
+
+QString SentenceBuffer::text(int first) const
+{
+    if (first <= 0)
+        return m_text;
+    if (first >= m_ends.count())
+        return QString();
+    return m_text.mid(start(first));
+}
+
+qint64 SentenceBuffer::memoryUsage() const
+{
+    return sizeof(SentenceBuffer) + qint64(m_text.capacity()) * sizeof(QChar) +
+        qint64(m_ends.capacity()) * sizeof(int);
+}
+
+int SentenceBuffer::start(int n) const
+{
+    // Sentences are one space apart.
+    return n ? m_ends.at(n - 1) + 1 : 0;
+}
@@ -0,0 +1,90 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Sentences of a speech job in one contiguous buffer.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef SENTENCEBUFFER_H
+#define SENTENCEBUFFER_H
+
+// Qt includes.
+#include <QtCore/QString>
+#include <QtCore/QStringRef>
+#include <QtCore/QVector>
+
+class QRegExp;
+
+/**
+ * @class SentenceBuffer
+ *
+ * The sentences of a job, held as one UTF-16 string with the sentences one
+ * space apart and the end offset of each sentence.  Sentences are handed out
+ * as views into the string, and the whole job is freed in one go.
+ *
+ * A sentence costs its characters, 2 bytes each, one more for the space and
+ * 4 bytes of offset, so a queued megabyte of plain text takes a little over
+ * 2 MB.  As a QStringList each sentence was a heap block of its own with a
+ * header of 20 to 40 bytes, and splitting made several copies of the text;
+ * for a book of 100000 sentences that was 100000 allocations and some 4 MB
+ * more.  See TestSentenceBuffer::benchmarkSplit.
+ */
+class SentenceBuffer
+{
+public:
+    SentenceBuffer();
+
+    /**
+     * Splits text into sentences, in one pass.  Runs of white space become
+     * one space, lines are joined, and each sentence ends after the first
+     * capture of a match of @p delimiter; the rest of the match is dropped.
+     */
+    SentenceBuffer(const QString &text, const QRegExp &delimiter);
+
+    /**
+     * Holds text as a single sentence, such as an SSML document.
+     */
+    explicit SentenceBuffer(const QString &text);
+
+    int count() const;
+    bool isEmpty() const;
+
+    /**
+     * Sentence @p n, counting from 0.  The view is valid as long as the buffer.
+     */
+    QStringRef sentence(int n) const;
+
+    /**
+     * The sentences from @p first on, one space apart.
+     */
+    QString text(int first = 0) const;
+
+    /**
+     * Approximate bytes of memory used.
+     */
+    qint64 memoryUsage() const;
+
+private:
+    int start(int n) const;
+
+    QString m_text;
+    /* End of each sentence in m_text. */
+    QVector<int> m_ends;
+};
+
+#endif // SENTENCEBUFFER_H
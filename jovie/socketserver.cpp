@@ -0,0 +1,196 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Local socket endpoint for clients that speak at a high rate.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// SocketServer includes.
+#include "socketserver.h"
+#include "socketserver.moc"
+
+// Qt includes.
+#include <QtCore/QtEndian>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
+
+// KDE includes.
+#include <kdebug.h>
+#include <kstandarddirs.h>
+
+// Jovie includes.
+#include "speaker.h"
+
+SocketServer::SocketServer(QObject *parent) :
+    QObject(parent),
+    m_server(new QLocalServer(this)),
+    m_nextClient(1)
+{
+    connect(m_server, SIGNAL(newConnection()), this, SLOT(slotNewConnection()));
+    connect(Speaker::Instance(), SIGNAL(jobStateChanged(QString,int,KSpeech::JobState)),
+        this, SLOT(slotJobStateChanged(QString,int,KSpeech::JobState)));
+}
+
+SocketServer::~SocketServer()
+{
+    foreach (const QString &appId, m_sockets.keys())
+        Speaker::Instance()->releaseAppData(appId);
+}
+
+QString SocketServer::socketPath()
+{
+    return KStandardDirs::locateLocal("socket", QLatin1String("jovie"));
+}
+
+bool SocketServer::listen()
+{
+    const QString path = socketPath();
+    // A socket left behind by a daemon that crashed.
+    QLocalServer::removeServer(path);
+    if (!m_server->listen(path))
+    {
+        kDebug() << "SocketServer::listen: cannot listen on " << path << ": " << m_server->errorString();
+        return false;
+    }
+    kDebug() << "SocketServer::listen: listening on " << path;
+    return true;
+}
+
+void SocketServer::slotNewConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection())
+    {
+        Client client;
+        // Not a valid DBUS name, so it cannot clash with a DBUS client.
+        client.appId = QLatin1String(":local.") + QString::number(m_nextClient++);
+        m_clients.insert(socket, client);
+        m_sockets.insert(client.appId, socket);
+        connect(socket, SIGNAL(readyRead()), this, SLOT(slotReadyRead()));
+        // Queued, as a failed write may report the disconnection while a frame is handled.
+        connect(socket, SIGNAL(disconnected()), this, SLOT(slotDisconnected()), Qt::QueuedConnection);
+    }
+}
+
+void SocketServer::slotReadyRead()
+{
+    QLocalSocket *socket = static_cast<QLocalSocket *>(sender());
+    QHash<QLocalSocket *, Client>::iterator it = m_clients.find(socket);
+    if (it == m_clients.end())
+        return;
+    Client &client = it.value();
+    client.buffer += socket->readAll();
+
+    // Handle every complete frame, then drop them from the buffer at once.
+    int pos = 0;
+    const int size = client.buffer.size();
+    while (size - pos >= 4)
+    {
+        const char *data = client.buffer.constData() + pos;
+        const quint32 length = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(data));
+        if (length < 1 || length > MaxFrameLength)
+        {
+            kDebug() << "SocketServer: bad frame length " << length << " from " << client.appId;
+            socket->disconnectFromServer();
+            return;
+        }
+        if (quint32(size - pos - 4) < length)
+            break;
+        if (!handleFrame(socket, client, data + 4, length))
+        {
+            kDebug() << "SocketServer: malformed frame from " << client.appId;
+            socket->disconnectFromServer();
+            return;
+        }
+        pos += 4 + length;
+    }
+    client.buffer.remove(0, pos);
+}
+
+bool SocketServer::handleFrame(QLocalSocket *socket, Client &client, const char *frame, quint32 length)
+{
+    const quint8 opcode = quint8(frame[0]);
+    const uchar *args = reinterpret_cast<const uchar *>(frame + 1);
+    const quint32 argsLength = length - 1;
+    Speaker *speaker = Speaker::Instance();
+
+    switch (opcode)
+    {
+        case opSay:
+        {
+            if (argsLength < 8)
+                return false;
+            const qint32 requestId = qFromBigEndian<qint32>(args);
+            const qint32 options = qFromBigEndian<qint32>(args + 4);
+            const QString text = QString::fromUtf8(frame + 9, argsLength - 8);
+            const int jobNum = speaker->say(client.appId, text, options);
+            send(socket, opSayReply, requestId, jobNum, true);
+            return true;
+        }
+        case opStop:
+            speaker->stop();
+            return true;
+        case opCancel:
+            speaker->cancel();
+            return true;
+        case opPause:
+            speaker->pause();
+            return true;
+        case opResume:
+            speaker->resume();
+            return true;
+        case opSetApplicationName:
+            speaker->getAppData(client.appId)->setApplicationName(QString::fromUtf8(frame + 1, argsLength));
+            return true;
+        case opPing:
+            if (argsLength < 4)
+                return false;
+            send(socket, opPong, qFromBigEndian<qint32>(args), 0, false);
+            return true;
+    }
+    return false;
+}
+
+void SocketServer::send(QLocalSocket *socket, quint8 opcode, qint32 arg1, qint32 arg2, bool twoArgs)
+{
+    uchar frame[13];
+    const quint32 length = twoArgs ? 9 : 5;
+    qToBigEndian<quint32>(length, frame);
+    frame[4] = opcode;
+    qToBigEndian<qint32>(arg1, frame + 5);
+    if (twoArgs)
+        qToBigEndian<qint32>(arg2, frame + 9);
+    socket->write(reinterpret_cast<const char *>(frame), 4 + length);
+    // Do not wait for the event loop, the client is waiting.
+    socket->flush();
+}
+
+void SocketServer::slotDisconnected()
+{
+    QLocalSocket *socket = static_cast<QLocalSocket *>(sender());
+    const Client client = m_clients.take(socket);
+    m_sockets.remove(client.appId);
+    Speaker::Instance()->releaseAppData(client.appId);
+    socket->deleteLater();
+}
+
+void SocketServer::slotJobStateChanged(const QString &appId, int jobNum, KSpeech::JobState state)
+{
+    QLocalSocket *socket = m_sockets.value(appId);
+    if (socket)
+        send(socket, opJobState, jobNum, state, true);
+}
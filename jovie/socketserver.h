@@ -0,0 +1,126 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Local socket endpoint for clients that speak at a high rate.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef SOCKETSERVER_H
+#define SOCKETSERVER_H
+
+// Qt includes.
+#include <QtCore/QObject>
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+
+#include <kspeech.h>
+
+class QLocalServer;
+class QLocalSocket;
+
+/**
+ * @class SocketServer
+ *
+ * A local socket for clients that send many short utterances, such as screen
+ * readers.  It skips the hop through the bus daemon and the marshalling of
+ * DBUS.  It is enabled with LocalSocket=true in the General group of kttsdrc.
+ * The socket is "jovie" in the KDE socket directory, which only the user can
+ * access.
+ *
+ * Each connection is an application of its own to the Speaker, just like a
+ * DBUS client, and its jobs are queued by the same Speaker.
+ *
+ * Protocol.  Every message is a frame: the length of the rest of the frame
+ * as a 32 bit unsigned integer, a one byte opcode, then the arguments.
+ * Integers are 32 bit, big endian.  Text is UTF-8 up to the end of the frame.
+ *
+ * Requests:
+ * @li Say (1): request id, options, text.  Answered with SayReply.
+ * @li Stop (2), Cancel (3), Pause (4), Resume (5): no arguments.
+ * @li SetApplicationName (6): name.
+ * @li Ping (7): request id.  Answered with Pong.
+ *
+ * Replies and events:
+ * @li SayReply (0x81): request id, job number.  -1 if the job failed.
+ * @li Pong (0x87): request id.
+ * @li JobState (0x90): job number, KSpeech::JobState.  Sent for the
+ *     client's own jobs only.
+ */
+class SocketServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Opcode
+    {
+        opSay = 1,
+        opStop = 2,
+        opCancel = 3,
+        opPause = 4,
+        opResume = 5,
+        opSetApplicationName = 6,
+        opPing = 7,
+        opSayReply = 0x81,
+        opPong = 0x87,
+        opJobState = 0x90
+    };
+
+    /**
+     * Frames longer than this close the connection.
+     */
+    static const quint32 MaxFrameLength = 1024 * 1024;
+
+    explicit SocketServer(QObject *parent = 0);
+    ~SocketServer();
+
+    /**
+     * The path of the socket.
+     */
+    static QString socketPath();
+
+    /**
+     * Starts listening.
+     * @return                  False if the socket could not be created.
+     */
+    bool listen();
+
+private slots:
+    void slotNewConnection();
+    void slotReadyRead();
+    void slotDisconnected();
+    void slotJobStateChanged(const QString &appId, int jobNum, KSpeech::JobState state);
+
+private:
+    struct Client
+    {
+        QString appId;
+        QByteArray buffer;
+    };
+
+    // Handles one frame.  False if it is malformed.
+    bool handleFrame(QLocalSocket *socket, Client &client, const char *frame, quint32 length);
+    void send(QLocalSocket *socket, quint8 opcode, qint32 arg1, qint32 arg2, bool twoArgs);
+
+    QLocalServer *m_server;
+    QHash<QLocalSocket *, Client> m_clients;
+    // Connection of each client application.
+    QHash<QString, QLocalSocket *> m_sockets;
+    int m_nextClient;
+};
+
+#endif // SOCKETSERVER_H
@@ -34,6 +34,13 @@
 // Qt includes.
 #include <QtCore/QFile>
 #include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QPair>
+#include <QtCore/QSet>
+#include <QtCore/QTimer>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QtConcurrentRun>
 #include <QtGui/QApplication>
 #include <QtDBus/QtDBus>
 #include <QtXml/QDomDocument>
@@ -54,6 +61,14 @@
 // KTTSD includes.
 //#include "talkermgr.h"
 #include "ssmlconvert.h"
+#include "voicecatalog.h"
+#include "jovieconfig.h"
+#include "startuptimeline.h"
+#include "ssipclient.h"
+#include "jobscheduler.h"
+#include "admissioncontrol.h"
+#include "duplicatefilter.h"
+#include "jobjournal.h"
 
 
 /**
@@ -96,20 +111,60 @@
 *   or finished.
 */
 
+/* Application the jobs recovered from the journal are queued for.  Their
+   own applications are gone with the run that crashed. */
+static const char recoveredAppId[] = ":jovie.recovered";
+
+/* Index marks before each sentence are named this and the sentence number. */
+static const char sentenceMark[] = "jovie.s";
+
+/**
+ * The sentences from @p first on as SSML, with an index mark before each,
+ * so speech-dispatcher reports the sentence it has reached.
+ */
+static QByteArray markedSsml(const SentenceBuffer &sentences, int first)
+{
+    QByteArray ssml("<speak>");
+    for (int n = first; n < sentences.count(); ++n)
+    {
+        ssml += "<mark name=\"";
+        ssml += sentenceMark;
+        ssml += QByteArray::number(n + 1);
+        ssml += "\"/>";
+        QByteArray sentence = sentences.sentence(n).toUtf8();
+        sentence.replace('&', "&amp;");
+        sentence.replace('<', "&lt;");
+        sentence.replace('>', "&gt;");
+        ssml += sentence;
+        ssml += ' ';
+    }
+    ssml += "</speak>";
+    return ssml;
+}
+
 
 class SpeakerPrivate
 {
     SpeakerPrivate(Speaker *parent) :
         connection(NULL),
-        filterMgr(new FilterMgr()),
-        config(new KConfig(QLatin1String( "kttsdrc" ))),
+        connecting(false),
+        talkerApplied(false),
+        ssip(NULL),
+        lastJobNum(0),
+        dispatching(false),
+        budgetPressure(false),
+        recoveryPending(false),
+        filterMgr(NULL),
         q(parent)
     {
-        filterMgr->init();
+        clock.start();
     }
 
     ~SpeakerPrivate()
     {
+        connectWatcher.waitForFinished();
+        if (connecting)
+            connection = connectWatcher.result();
         spd_close(connection);
         connection = NULL;
 
@@ -121,7 +176,9 @@ class SpeakerPrivate
         //allJobs.clear();
 
         delete filterMgr;
-        delete config;
+
+        // Destroyed only when Jovie exits cleanly.
+        journal.discard();
 
         foreach (AppData* applicationData, appData)
             delete applicationData;
@@ -132,22 +189,79 @@ class SpeakerPrivate
 
 protected:
 
+    static SPDConnection *openConnection()
+    {
+        return spd_open("jovie", "main", NULL, SPD_MODE_THREADED);
+    }
+
     bool ConnectToSpeechd()
+    {
+        return setUpConnection(openConnection());
+    }
+
+    // Opens the connection in a worker thread.  slotConnected finishes the job.
+    void connectToSpeechdAsync()
+    {
+        connecting = true;
+        connectWatcher.setFuture(QtConcurrent::run(openConnection));
+    }
+
+    // Takes the connection opened by connectToSpeechdAsync, if not done yet.
+    void finishConnecting()
+    {
+        if (!connecting)
+            return;
+        connecting = false;
+        if (!setUpConnection(connectWatcher.result()))
+            kError() << "could not get a connection to speech-dispatcher"<< endl;
+        else
+            openSsip();
+        StartupTimeline::reached(StartupTimeline::SpeechdReady);
+    }
+
+    // Returns whether there is a connection, waiting for it if it is still being opened.
+    bool connected()
+    {
+        if (connecting)
+        {
+            connectWatcher.waitForFinished();
+            finishConnecting();
+        }
+        return connection != NULL;
+    }
+
+    // Returns the filter manager, loading the filters if that has not been done yet.
+    FilterMgr *filters()
+    {
+        if (!filterMgr)
+        {
+            filterMgr = new FilterMgr();
+            filterMgr->init();
+            StartupTimeline::reached(StartupTimeline::FiltersLoaded);
+        }
+        return filterMgr;
+    }
+
+    bool setUpConnection(SPDConnection *newConnection)
     {
         bool retval = false;
-        connection = spd_open("jovie", "main", NULL, SPD_MODE_THREADED);
+        connection = newConnection;
         if (connection != NULL)
         {
             kDebug() << "successfully opened connection to speech dispatcher";
             connection->callback_begin = connection->callback_end =
                 connection->callback_cancel = connection->callback_pause =
                 connection->callback_resume = Speaker::speechdCallback;
+            connection->callback_im = Speaker::speechdIndexMarkCallback;
 
             spd_set_notification_on(connection, SPD_BEGIN);
             spd_set_notification_on(connection, SPD_END);
             spd_set_notification_on(connection, SPD_CANCEL);
             spd_set_notification_on(connection, SPD_PAUSE);
             spd_set_notification_on(connection, SPD_RESUME);
+            spd_set_notification_on(connection, SPD_INDEX_MARKS);
+            outputModules.clear();
+            talkerApplied = false;
             char ** modulenames = spd_list_modules(connection);
             while (modulenames != NULL && modulenames[0] != NULL)
             {
@@ -163,6 +277,75 @@ protected:
         return retval;
     }
 
+    // Returns whether jobs go through the SSIP client.
+    bool native() const
+    {
+        return ssip != NULL && ssip->isOpen();
+    }
+
+    // Opens the SSIP client if NativeSsip is set.  speech-dispatcher has been
+    // started by libspeechd by now, which also keeps listing the modules.
+    void openSsip()
+    {
+        const QString address = SsipClient::defaultAddress();
+        if (ssip != NULL || !JovieConfig::Instance()->snapshot()->nativeSsip() || address.isEmpty())
+            return;
+        ssip = new SsipClient(q);
+        QObject::connect(ssip, SIGNAL(messageQueued(int,int)), q, SLOT(slotSsipMessageQueued(int,int)));
+        QObject::connect(ssip, SIGNAL(requestFinished(int,bool)), q, SLOT(slotSsipRequestFinished(int,bool)));
+        QObject::connect(ssip, SIGNAL(event(int,int,QString)), q, SLOT(slotSsipEvent(int,int,QString)));
+        QObject::connect(ssip, SIGNAL(disconnected()), q, SLOT(slotSsipDisconnected()));
+        ssip->connectToServer(address);
+        QByteArray user = qgetenv("USER");
+        if (user.isEmpty())
+            user = "unknown";
+        ssip->set("CLIENT_NAME", user + ":jovie:native");
+        ssip->set("NOTIFICATION", "all on");
+        // The settings of the talker now go to the new connection.
+        talkerApplied = false;
+        applyTalker(TalkerCode(currentTalker));
+    }
+
+    // Records a job sent through the SSIP client.
+    void startSsipJob(int jobNum, int requestId, int firstSentence = 0)
+    {
+        SsipJob job;
+        job.requestDone = false;
+        job.ok = true;
+        job.cancelled = false;
+        job.queued = 0;
+        job.ended = 0;
+        job.firstSentence = firstSentence;
+        ssipJobs.insert(jobNum, job);
+        ssipRequests.insert(requestId, jobNum);
+    }
+
+    // Returns whether the job has all the messages in flight on the connection
+    // it went through.  speech-dispatcher cancels by connection, not by
+    // message, so only then can the job be cancelled alone.
+    bool ownsConnection(int jobNum)
+    {
+        if (ssipJobs.contains(jobNum))
+            return ssipJobs.count() == 1;
+        if (!connected() || speechdJobs.key(jobNum) == 0)
+            return false;
+        foreach (int other, speechdJobs)
+        {
+            if (other != jobNum)
+                return false;
+        }
+        return true;
+    }
+
+    // Says the sentences from first on through libspeechd, with index marks.
+    int sayMarked(SPDPriority priority, const SentenceBuffer &sentences, int first)
+    {
+        spd_set_data_mode(connection, SPD_DATA_SSML);
+        const int msgId = spd_say(connection, priority, markedSsml(sentences, first).constData());
+        spd_set_data_mode(connection, SPD_DATA_TEXT);
+        return msgId;
+    }
+
     // try to reconnect to speech-dispatcher, return true on success
     bool reconnect()
     {
@@ -172,39 +355,41 @@ protected:
 
     void readTalkerData()
     {
-        config->reparseConfiguration();
-        // Iterate through list of the TalkerCode IDs.
-        KConfigGroup ttsconfig(config, "General");
-        QStringList talkerIDsList = ttsconfig.readEntry("TalkerIDs", QStringList());
-        // kDebug() << "TalkerListModel::loadTalkerCodesFromConfig: talkerIDsList = " << talkerIDsList;
-        if (!talkerIDsList.isEmpty())
+        // The first of the configured talkers is the default talker.
+        ConfigSnapshotPtr snapshot = JovieConfig::Instance()->snapshot();
+        if (!snapshot->talkers().isEmpty())
         {
-            QStringList::ConstIterator itEnd = talkerIDsList.constEnd();
-            for (QStringList::ConstIterator it = talkerIDsList.constBegin(); it != itEnd; ++it)
-            {
-                QString talkerID = *it;
-                kDebug() << "TalkerListWidget::loadTalkerCodes: talkerID = " << talkerID;
-                KConfigGroup talkGroup(config, "Talkers");
-                QString talkerCode = talkGroup.readEntry(talkerID);
-                TalkerCode tc = TalkerCode(talkerCode, true);
-                if (defaultTalker.name().isEmpty())
-                    defaultTalker = tc;
-                kDebug() << "TalkerCodeWidget::loadTalkerCodes: talkerCode = " << talkerCode;
-                //tc.setId(talkerID);
-                // do something with the talker codes read in
-            }
-            currentTalker = defaultTalker;
-
-            q->setOutputModule(defaultTalker.outputModule());
-            q->setLanguage(defaultTalker.language());
-            q->setVoiceType(defaultTalker.voiceType());
-            q->setVolume(defaultTalker.volume());
-            q->setPitch(defaultTalker.pitch());
-            q->setSpeed(defaultTalker.rate());
-	    q->setPunctuationType(defaultTalker.punctuation());
+            defaultTalker = snapshot->defaultTalker();
+            kDebug() << "SpeakerPrivate::readTalkerData: default talkerCode = " << defaultTalker.getTalkerCode();
+            applyTalker(defaultTalker);
         }
     }
 
+    // Sends speech-dispatcher the settings of a talker that differ from the
+    // current ones.  A new output module starts from its own defaults, so
+    // after changing the module every setting is sent.
+    void applyTalker(const TalkerCode &talker)
+    {
+        const bool all = !talkerApplied || talker.outputModule() != currentTalker.outputModule();
+        talkerApplied = (connection != NULL);
+
+        if (all)
+            q->setOutputModule(talker.outputModule());
+        if (all || talker.language() != currentTalker.language())
+            q->setLanguage(talker.language());
+        if (all || talker.voiceType() != currentTalker.voiceType())
+            q->setVoiceType(talker.voiceType());
+        if (all || talker.volume() != currentTalker.volume())
+            q->setVolume(talker.volume());
+        if (all || talker.pitch() != currentTalker.pitch())
+            q->setPitch(talker.pitch());
+        if (all || talker.rate() != currentTalker.rate())
+            q->setSpeed(talker.rate());
+        if (all || talker.punctuation() != currentTalker.punctuation())
+            q->setPunctuationType(talker.punctuation());
+        currentTalker.setName(talker.name());
+    }
+
     /**
     * list of output modules speech-dispatcher has
     */
@@ -212,20 +397,124 @@ protected:
 
     SPDConnection * connection;
 
+    /**
+    * Set while the connection is being opened in the background.
+    */
+    bool connecting;
+    QFutureWatcher<SPDConnection *> connectWatcher;
+
+    /**
+    * Set once the settings of a talker have been sent on this connection.
+    */
+    bool talkerApplied;
+
+    /**
+    * Jovie's own SSIP client, if NativeSsip is set.
+    */
+    SsipClient *ssip;
+
+    /**
+    * The last job number given out.  Jobs are numbered by Jovie whichever way
+    * they are sent, so numbers stay unique when the way changes.
+    */
+    int lastJobNum;
+
+    struct SsipJob
+    {
+        bool requestDone;       /* all replies to the request have come */
+        bool ok;                /* no command of the request failed */
+        bool cancelled;         /* a message was cancelled */
+        int queued;             /* messages queued */
+        int ended;              /* messages ended or cancelled */
+        int firstSentence;      /* sentence of the first message, from 0 */
+    };
+
+    /**
+    * Jobs sent through the SSIP client that have not ended, the job of each
+    * request still waiting for replies and the job of each message.
+    */
+    QHash<int, SsipJob> ssipJobs;
+    QHash<int, int> ssipRequests;
+    QHash<int, int> ssipMessages;
+
+    /**
+    * Jobs waiting in Jovie's scheduler, if Scheduler is set, and the scheduled
+    * jobs handed to speech-dispatcher that have not ended.
+    */
+    JobScheduler scheduler;
+    QSet<int> inFlight;
+    bool dispatching;
+
+    /**
+    * Job of each libspeechd message.
+    */
+    QHash<int, int> speechdJobs;
+
+    /**
+    * Rate limits and pending text of the jobs accepted.  Backpressure is on
+    * for the applications in throttled, and for all if budgetPressure is set.
+    */
+    AdmissionControl admission;
+    QElapsedTimer clock;
+    QSet<QString> throttled;
+    bool budgetPressure;
+
+    /**
+    * The latest job of each application and priority that supersedes, and the
+    * jobs replaced after they went to speech-dispatcher, which are stopped
+    * when they begin.
+    */
+    QHash<QPair<QString, int>, int> latestJobs;
+    QSet<int> superseded;
+
+    /**
+    * Messages seen within their DuplicateWindow, and the timer that forgets
+    * them when the first window ends.  The repeat counters of the messages
+    * forgotten wait for the timer to be said.
+    */
+    DuplicateFilter duplicates;
+    QTimer duplicateTimer;
+    QList<DuplicateFilter::Repeat> repeats;
+
+    /**
+    * Text jobs accepted and how far they got, for recovery after a crash.
+    * recoveryPending is set while jobs recovered wait for speech-dispatcher.
+    */
+    JobJournal journal;
+    bool recoveryPending;
+
     /**
     * Application data.
     */
     mutable QMap<QString, AppData*> appData;
 
     /**
-    * the filter manager
+    * Applications gone whose data is deleted once their jobs have ended.
+    * Collected from the event loop, so no caller is left holding the data.
     */
-    FilterMgr * filterMgr;
+    QSet<QString> departed;
+    QTimer collectTimer;
+
+    /**
+    * Metadata of the jobs, for the job events and for inspection.
+    */
+    JobRegistry jobs;
+
+    /**
+    * Filtered sentences of the plain text jobs not ended.
+    */
+    QHash<int, SentenceBuffer> sentences;
+
+    /**
+    * Jobs cancelled to be sent again, and the sentence to go on from,
+    * counting from 1.
+    */
+    QHash<int, int> seeks;
 
     /**
-    * Object holding all the configuration
+    * the filter manager, created when first needed
     */
-    KConfig *config;
+    FilterMgr * filterMgr;
 
     Speaker *q;
 
@@ -258,40 +547,222 @@ Speaker * Speaker::Instance()
 void Speaker::speechdCallback(size_t msg_id, size_t /*client_id*/, SPDNotificationType type)
 {
     kDebug() << "speechdCallback called with messageid: " << msg_id << " and type: " << type;
-    //KSpeech::JobState state(KSpeech::jsQueued);
-    //switch (type) {
-    //    case SPD_EVENT_BEGIN:
-    //        state = KSpeech::jsSpeaking;
-    //        break;
-    //    case SPD_EVENT_END:
-    //        state = KSpeech::jsFinished;
-    //        break;
-    //    case SPD_EVENT_INDEX_MARK:
-    //        break;
-    //    case SPD_EVENT_CANCEL:
-    //        state = KSpeech::jsDeleted;
-    //        break;
-    //    case SPD_EVENT_PAUSE:
-    //        state = KSpeech::jsPaused;
-    //        break;
-    //    case SPD_EVENT_RESUME:
-    //        state = KSpeech::jsSpeaking;
-    //        break;
-    //}
+    // Called in a thread of libspeechd.  Hand the event to the main thread.
+    QMetaObject::invokeMethod(Speaker::Instance(), "slotSpeechdEvent", Qt::QueuedConnection,
+        Q_ARG(int, int(msg_id)), Q_ARG(int, int(type)));
 }
 
-Speaker::Speaker() :
-    d(new SpeakerPrivate(this))
+void Speaker::speechdIndexMarkCallback(size_t msg_id, size_t /*client_id*/, SPDNotificationType type,
+                                       char *index_mark)
+{
+    if (type != SPD_EVENT_INDEX_MARK || !index_mark)
+        return;
+    // The mark is freed by libspeechd once this returns.
+    QMetaObject::invokeMethod(Speaker::Instance(), "slotSpeechdIndexMark", Qt::QueuedConnection,
+        Q_ARG(int, int(msg_id)), Q_ARG(QString, QString::fromUtf8(index_mark)));
+}
+
+void Speaker::slotSpeechdIndexMark(int msgId, const QString &mark)
+{
+    const int jobNum = d->speechdJobs.value(msgId);
+    if (jobNum)
+        markReached(jobNum, mark);
+}
+
+void Speaker::slotSpeechdEvent(int msgId, int type)
+{
+    KSpeech::JobState state;
+    switch (type) {
+        case SPD_EVENT_BEGIN:
+            state = KSpeech::jsSpeaking;
+            break;
+        case SPD_EVENT_END:
+            state = KSpeech::jsFinished;
+            break;
+        case SPD_EVENT_CANCEL:
+            state = KSpeech::jsDeleted;
+            break;
+        case SPD_EVENT_PAUSE:
+            state = KSpeech::jsPaused;
+            break;
+        case SPD_EVENT_RESUME:
+            state = KSpeech::jsSpeaking;
+            break;
+        default:
+            return;
+    }
+    const int jobNum = d->speechdJobs.value(msgId);
+    if (!jobNum)
+        return;
+    if (state == KSpeech::jsFinished || state == KSpeech::jsDeleted)
+        d->speechdJobs.remove(msgId);
+    if (state == KSpeech::jsDeleted && d->seeks.contains(jobNum))
+    {
+        resubmit(jobNum, d->seeks.take(jobNum) - 1);
+        return;
+    }
+    setJobState(jobNum, state);
+}
+
+void Speaker::setJobState(int jobNum, KSpeech::JobState state)
+{
+    const JobRegistry::Job *job = d->jobs.job(jobNum);
+    if (job && job->state == state)
+        return;
+    const int priority = job ? int(job->priority) : 0;
+    const QString appId = d->jobs.setState(jobNum, state);
+    emit jobStateChanged(appId, jobNum, state);
+    if (state == KSpeech::jsSpeaking && d->superseded.contains(jobNum))
+    {
+        stopJob(jobNum);
+        return;
+    }
+    if (state != KSpeech::jsFinished && state != KSpeech::jsDeleted)
+        return;
+    d->superseded.remove(jobNum);
+    d->sentences.remove(jobNum);
+    d->seeks.remove(jobNum);
+    d->journal.end(jobNum);
+    const QPair<QString, int> latest(appId, priority);
+    if (d->latestJobs.value(latest) == jobNum)
+        d->latestJobs.remove(latest);
+    d->admission.remove(jobNum);
+    updateBackpressure();
+    AppData *appData = d->appData.value(appId);
+    if (appData && appData->unregistered())
+    {
+        d->departed.insert(appId);
+        d->collectTimer.start();
+    }
+    // An ended job makes room for the next scheduled one.
+    if (d->inFlight.remove(jobNum))
+        dispatchJobs();
+}
+
+void Speaker::slotSsipMessageQueued(int requestId, int msgId)
+{
+    const int jobNum = d->ssipRequests.value(requestId);
+    if (!jobNum)
+        return;
+    d->ssipJobs[jobNum].queued++;
+    d->ssipMessages.insert(msgId, jobNum);
+    // Queued after the job was stopped or moved to another sentence, while
+    // it still has the connection.  Otherwise the message is stopped when it
+    // begins.
+    if ((d->superseded.contains(jobNum) && d->jobs.job(jobNum)->state == KSpeech::jsSpeaking) ||
+        d->seeks.contains(jobNum))
+        cancelJob(jobNum);
+}
+
+void Speaker::slotSsipRequestFinished(int requestId, bool ok)
+{
+    const int jobNum = d->ssipRequests.take(requestId);
+    if (!jobNum)
+        return;
+    SpeakerPrivate::SsipJob &job = d->ssipJobs[jobNum];
+    job.requestDone = true;
+    job.ok = ok;
+    checkSsipJobEnded(jobNum);
+}
+
+void Speaker::slotSsipEvent(int msgId, int type, const QString &mark)
+{
+    const int jobNum = d->ssipMessages.value(msgId);
+    if (!jobNum)
+        return;
+    switch (type)
+    {
+        case SsipClient::IndexMark:
+            markReached(jobNum, mark);
+            break;
+        case SsipClient::Begin:
+            // Each sentence is a message, and they are spoken in order.
+            if (d->sentences.contains(jobNum))
+            {
+                const SpeakerPrivate::SsipJob job = d->ssipJobs.value(jobNum);
+                d->jobs.setSentenceNum(jobNum, job.firstSentence + job.ended + 1);
+            }
+            // Only the first message of a job changes its state.
+            if ((d->superseded.contains(jobNum) || d->seeks.contains(jobNum)) &&
+                d->jobs.job(jobNum)->state == KSpeech::jsSpeaking)
+                stopJob(jobNum);
+            else
+                setJobState(jobNum, KSpeech::jsSpeaking);
+            break;
+        case SsipClient::Resume:
+            setJobState(jobNum, KSpeech::jsSpeaking);
+            break;
+        case SsipClient::Pause:
+            setJobState(jobNum, KSpeech::jsPaused);
+            break;
+        case SsipClient::End:
+        case SsipClient::Cancel:
+        {
+            d->ssipMessages.remove(msgId);
+            SpeakerPrivate::SsipJob &job = d->ssipJobs[jobNum];
+            job.ended++;
+            if (type == SsipClient::Cancel)
+                job.cancelled = true;
+            else
+                d->journal.progress(jobNum, job.firstSentence + job.ended);
+            checkSsipJobEnded(jobNum);
+            break;
+        }
+    }
+}
+
+void Speaker::checkSsipJobEnded(int jobNum)
 {
-    if (!d->ConnectToSpeechd())
+    // The messages of a block end one by one; the job ends with the last.
+    const SpeakerPrivate::SsipJob job = d->ssipJobs.value(jobNum);
+    if (!job.requestDone || job.ended < job.queued)
+        return;
+    d->ssipJobs.remove(jobNum);
+    if (job.cancelled && d->seeks.contains(jobNum))
     {
-        kDebug() << "connection: " << d->connection;
-        kError() << "could not get a connection to speech-dispatcher"<< endl;
+        resubmit(jobNum, d->seeks.take(jobNum) - 1);
+        return;
     }
+    setJobState(jobNum, (job.cancelled || !job.ok) ? KSpeech::jsDeleted : KSpeech::jsFinished);
+}
+
+void Speaker::slotSsipDisconnected()
+{
+    kWarning() << "lost the SSIP connection to speech-dispatcher, going on with libspeechd";
+    d->ssip->deleteLater();
+    d->ssip = NULL;
+    const QList<int> jobNums = d->ssipJobs.keys();
+    d->ssipJobs.clear();
+    d->ssipRequests.clear();
+    d->ssipMessages.clear();
+    foreach (int jobNum, jobNums)
+        setJobState(jobNum, KSpeech::jsDeleted);
+    // The libspeechd connection still has the settings it had.
+    d->talkerApplied = false;
+    d->applyTalker(TalkerCode(d->currentTalker));
+}
+
+Speaker::Speaker() :
+    d(new SpeakerPrivate(this))
+{
+    // Opening the connection blocks until speech-dispatcher has started, so
+    // do it in the background and let the D-Bus interface come up meanwhile.
+    connect(&d->connectWatcher, SIGNAL(finished()), this, SLOT(slotConnected()));
+    d->duplicateTimer.setSingleShot(true);
+    connect(&d->duplicateTimer, SIGNAL(timeout()), this, SLOT(slotExpireDuplicates()));
+    d->collectTimer.setSingleShot(true);
+    d->collectTimer.setInterval(0);
+    connect(&d->collectTimer, SIGNAL(timeout()), this, SLOT(slotCollectAppData()));
+    // The jobs recovered are queued once speech-dispatcher is there.
+    if (JovieConfig::Instance()->snapshot()->journal())
+        d->journal.open(KStandardDirs::locateLocal("data", QLatin1String("jovie/journal")));
+    d->connectToSpeechdAsync();
     // kDebug() << "Running: Speaker::Speaker()";
     // Connect ServiceUnregistered signal from DBUS so we know when apps have exited.
     connect (QDBusConnection::sessionBus().interface(), SIGNAL(serviceUnregistered(QString)),
         this, SLOT(slotServiceUnregistered(QString)));
+    // Start reading the voices, so they are ready when asked for.
+    VoiceCatalog::Instance();
 }
 
 Speaker::~Speaker(){
@@ -301,15 +772,85 @@ Speaker::~Speaker(){
 
 void Speaker::init()
 {
-    // from speechdata
-    // Create an initial FilterMgr for the pool to save time later.
     kDebug() << "Running: Speaker::init()";
+    // Load the filters once startup is done, or when the first job needs them.
     delete d->filterMgr;
-    d->filterMgr = new FilterMgr();
-    d->filterMgr->init();
+    d->filterMgr = NULL;
+    QTimer::singleShot(0, this, SLOT(slotLoadFilters()));
+
+    // Reread config setting the top voice if there is one.  If the connection
+    // is still being opened, this is done when it is ready.
+    if (!d->connecting)
+        d->readTalkerData();
+}
+
+void Speaker::reloadFilters()
+{
+    // Filters not loaded yet will read the new configuration anyway.
+    if (d->filterMgr)
+        d->filterMgr->reload();
+}
 
-    // Reread config setting the top voice if there is one.
-    d->readTalkerData();
+void Speaker::reloadFilter(const QString &filterId)
+{
+    if (d->filterMgr)
+        d->filterMgr->reload(filterId);
+    else
+        d->filters();
+}
+
+void Speaker::reloadTalkers()
+{
+    // Sends speech-dispatcher only what differs from the talker in use.
+    if (!d->connecting)
+        d->readTalkerData();
+}
+
+void Speaker::slotConnected()
+{
+    d->finishConnecting();
+    slotRecoverJobs();
+    emit connectionReady();
+}
+
+void Speaker::slotRecoverJobs()
+{
+    // Without speech-dispatcher the jobs stay in the journal, and are queued
+    // once a job could be sent.
+    d->recoveryPending = !d->connected();
+    if (d->recoveryPending)
+        return;
+    const QString appId = QLatin1String(recoveredAppId);
+    foreach (const JobJournal::Job &job, d->journal.recovered())
+    {
+        // Plain text goes on from the first sentence not spoken.  Markup
+        // cannot be cut at a sentence, so it is spoken again from the start.
+        QString text = job.text;
+        if (job.sentences > 0 && (job.options == KSpeech::soNone || job.options == KSpeech::soPlainText))
+            text = parseText(job.text, appId).text(job.sentences);
+        if (!text.isEmpty())
+        {
+            const int jobNum = say(appId, text, job.options, KSpeech::JobPriority(job.priority));
+            if (jobNum == -1 && !d->connected())
+            {
+                d->recoveryPending = true;
+                return;
+            }
+            kDebug() << "recovered job" << job.jobNum << "of" << job.appId << "as job" << jobNum;
+        }
+        // Queued again, or refused for good.
+        d->journal.end(job.jobNum);
+    }
+}
+
+bool Speaker::isConnecting() const
+{
+    return d->connecting;
+}
+
+void Speaker::slotLoadFilters()
+{
+    d->filters();
 }
 
 AppData* Speaker::getAppData(const QString& appId) const
@@ -319,6 +860,11 @@ AppData* Speaker::getAppData(const QString& appId) const
     return d->appData[appId];
 }
 
+AppData* Speaker::findAppData(const QString& appId) const
+{
+    return d->appData.value(appId);
+}
+
 bool Speaker::isSsml(const QString &text)
 {
     /// This checks to see if the root tag of the text is a <speak> tag.
@@ -329,73 +875,308 @@ bool Speaker::isSsml(const QString &text)
     return (root.tagName() == QLatin1String( "speak" ));
 }
 
-QStringList Speaker::parseText(const QString &text, const QString &appId /*=NULL*/)
+SentenceBuffer Speaker::parseText(const QString &text, const QString &appId /*=NULL*/)
 {
-    // There has to be a better way
     // kDebug() << "I'm getting: "<< text << " from application " << appId;
-    if (isSsml(text)) {
-        QStringList tempList(text);
-        return tempList;
-    }
+    if (isSsml(text))
+        return SentenceBuffer(text);
     // See if app has specified a custom sentence delimiter and use it, otherwise use default.
-    QRegExp sentenceDelimiter(getAppData(appId)->sentenceDelimiter());
-    QString temp = text;
-    // Replace spaces, tabs, and formfeeds with a single space.
-    temp.replace(QRegExp(QLatin1String( "[ \\t\\f]+") ), QLatin1String( " " ));
-    // Replace sentence delimiters with tab.
-    temp.replace(sentenceDelimiter, QLatin1String( "\\1\t" ));
-    // Replace remaining newlines with spaces.
-    temp.replace(QLatin1Char( '\n' ),QLatin1Char( ' ' ));
-    temp.replace(QLatin1Char( '\r' ),QLatin1Char( ' ' ));
-    // Remove leading spaces.
-    temp.replace(QRegExp(QLatin1String( "\\t +" )), QLatin1String( "\t" ));
-    // Remove trailing spaces.
-    temp.replace(QRegExp(QLatin1String( " +\\t" )), QLatin1String( "\t" ));
-    // Remove blank lines.
-    temp.replace(QRegExp(QLatin1String( "\t\t+" )),QLatin1String( "\t" ));
-    // Split into sentences.
-    QStringList tempList = temp.split( QLatin1Char( '\t' ), QString::SkipEmptyParts);
-
-//    for ( QStringList::Iterator it = tempList.begin(); it != tempList.end(); ++it ) {
-//        kDebug() << "'" << *it << "'";
-//    }
-    return tempList;
+    return SentenceBuffer(text, QRegExp(getAppData(appId)->sentenceDelimiter()));
+}
+
+static QByteArray ssipPriority(SPDPriority priority)
+{
+    switch (priority)
+    {
+        case SPD_IMPORTANT:
+            return "important";
+        case SPD_MESSAGE:
+            return "message";
+        case SPD_TEXT:
+            return "text";
+        case SPD_NOTIFICATION:
+            return "notification";
+        case SPD_PROGRESS:
+            return "progress";
+    }
+    return "text";
+}
+
+static SPDPriority spdPriority(KSpeech::JobPriority priority)
+{
+    switch (priority)
+    {
+        case KSpeech::jpScreenReaderOutput: /**< Screen Reader job. SPD_IMPORTANT */
+            return SPD_IMPORTANT;
+        case KSpeech::jpWarning: /**< Warning job. SPD_NOTIFICATION */
+            return SPD_NOTIFICATION;
+        case KSpeech::jpMessage: /**< Message job.SPD_MESSAGE */
+            return SPD_MESSAGE;
+        case KSpeech::jpText: /**< Text job. SPD_TEXT */
+            return SPD_TEXT;
+        case KSpeech::jpProgress: /**< Progress report. SPD_PROGRESS added KDE 4.4 */
+        default:
+            return SPD_PROGRESS; // default to least priority
+    }
 }
 
 int Speaker::say(const QString& appId, const QString& text, int sayOptions)
+{
+    return say(appId, text, sayOptions, getAppData(appId)->defaultPriority());
+}
+
+int Speaker::say(const QString &appId, const QString &text, int sayOptions, KSpeech::JobPriority priority)
+{
+    AppData* appData = getAppData(appId);
+    ConfigSnapshotPtr snapshot = JovieConfig::Instance()->snapshot();
+
+    // A repeat costs a hash of the text, and is answered with the first job.
+    // Keys and characters are often typed twice on purpose.
+    const int window = snapshot->duplicateWindow();
+    const bool dedup = window > 0 && snapshot->suppressesDuplicates(priority) &&
+                       sayOptions != KSpeech::soKey && sayOptions != KSpeech::soChar;
+    quint64 fingerprint = 0;
+    if (dedup)
+    {
+        expireDuplicates();
+        fingerprint = DuplicateFilter::fingerprint(appId, text);
+        const int firstJobNum = d->duplicates.repeat(fingerprint);
+        if (firstJobNum)
+        {
+            kDebug() << "suppressing a repeat of job" << firstJobNum;
+            return firstJobNum;
+        }
+    }
+
+    // The text is held as UTF-16 until the job ends.
+    const qint64 bytes = qint64(text.length()) * sizeof(QChar);
+    if (!admit(appId, appData, priority, bytes, *snapshot))
+        return -1;
+    const bool latestWins = snapshot->supersedes(priority);
+    if (latestWins)
+        supersede(appId, priority);
+
+    int jobNum;
+    if (!snapshot->scheduler())
+    {
+        jobNum = submit(appId, text, sayOptions, priority, 0);
+        if (jobNum != -1)
+        {
+            d->admission.add(jobNum, appId, priority, bytes, true);
+            updateBackpressure();
+            if (latestWins)
+                d->latestJobs.insert(qMakePair(appId, int(priority)), jobNum);
+        }
+        //// Note: Set state last so job is fully populated when jobStateChanged signal is emitted.
+        appData->jobList()->append(jobNum);
+    }
+    else
+    {
+        // The job waits in the scheduler, and is filtered when it is dispatched.
+        JobScheduler::Job job;
+        job.jobNum = jobNum = ++d->lastJobNum;
+        job.appId = appId;
+        job.priority = priority;
+        job.options = sayOptions;
+        job.text = text;
+        d->scheduler.enqueue(job, snapshot->schedulerWeight(appData->applicationName()));
+        d->jobs.add(jobNum, appId, priority, d->currentTalker.getTalkerCode());
+        d->admission.add(jobNum, appId, priority, bytes, false);
+        updateBackpressure();
+        if (latestWins)
+            d->latestJobs.insert(qMakePair(appId, int(priority)), jobNum);
+        appData->jobList()->append(jobNum);
+        emit jobStateChanged(appId, jobNum, KSpeech::jsQueued);
+        dispatchJobs();
+    }
+
+    // Long reading is worth going on with after a crash; notifications are stale by then.
+    const JobRegistry::Job *registered = d->jobs.job(jobNum);
+    if (priority == KSpeech::jpText && d->journal.isOpen() && registered &&
+        registered->state != KSpeech::jsFinished && registered->state != KSpeech::jsDeleted)
+    {
+        JobJournal::Job journalJob;
+        journalJob.jobNum = jobNum;
+        journalJob.appId = appId;
+        journalJob.priority = priority;
+        journalJob.options = sayOptions;
+        journalJob.text = text;
+        d->journal.accept(journalJob);
+    }
+
+    if (dedup && jobNum != -1)
+    {
+        d->duplicates.add(fingerprint, jobNum, d->clock.elapsed() + window, appId,
+                          snapshot->duplicateCounter() ? text : QString());
+        if (!d->duplicateTimer.isActive())
+            d->duplicateTimer.start(window);
+    }
+    return jobNum;
+}
+
+void Speaker::expireDuplicates()
+{
+    d->duplicates.expire(d->clock.elapsed(), &d->repeats);
+    const qint64 next = d->duplicates.nextExpiry();
+    if (!d->repeats.isEmpty())
+        d->duplicateTimer.start(0);
+    else if (next >= 0)
+        d->duplicateTimer.start(int(qMax(qint64(0), next - d->clock.elapsed())));
+    else
+        d->duplicateTimer.stop();
+}
+
+void Speaker::slotExpireDuplicates()
+{
+    expireDuplicates();
+    const QList<DuplicateFilter::Repeat> repeats = d->repeats;
+    d->repeats.clear();
+    foreach (const DuplicateFilter::Repeat &repeat, repeats)
+        say(repeat.appId, i18np("Repeated once: %2", "Repeated %1 times: %2", repeat.count, repeat.text),
+            KSpeech::soPlainText);
+}
+
+void Speaker::supersede(const QString &appId, KSpeech::JobPriority priority)
+{
+    const int jobNum = d->latestJobs.take(qMakePair(appId, int(priority)));
+    if (!jobNum)
+        return;
+    // Still waiting in the scheduler, so it is simply dropped.
+    if (d->scheduler.remove(jobNum))
+    {
+        setJobState(jobNum, KSpeech::jsDeleted);
+        return;
+    }
+    // speech-dispatcher cannot drop one message of a connection without the
+    // others, but it can stop the message speaking.  A job not speaking yet is
+    // stopped when it begins.
+    const JobRegistry::Job *job = d->jobs.job(jobNum);
+    if (!job || job->state == KSpeech::jsFinished || job->state == KSpeech::jsDeleted)
+        return;
+    d->superseded.insert(jobNum);
+    if (job->state == KSpeech::jsSpeaking)
+        stopJob(jobNum);
+}
+
+void Speaker::stopJob(int jobNum)
+{
+    if (cancelJob(jobNum))
+        return;
+    // Other jobs are queued behind it, so only the message speaking, which is
+    // the job's, is stopped.  Each later sentence of the job is stopped as it
+    // begins.
+    if (d->ssipJobs.contains(jobNum))
+        d->ssip->command("STOP self");
+    else if (d->connected())
+        spd_stop(d->connection);
+}
+
+bool Speaker::cancelJob(int jobNum)
+{
+    if (!d->ownsConnection(jobNum))
+        return false;
+    if (d->ssipJobs.contains(jobNum))
+        d->ssip->command("CANCEL self");
+    else
+        spd_cancel(d->connection);
+    return true;
+}
+
+void Speaker::dispatchJobs()
+{
+    // Submitting can end jobs in flight, as when the SSIP connection drops.
+    if (d->dispatching)
+        return;
+    d->dispatching = true;
+    const int lookahead = JovieConfig::Instance()->snapshot()->schedulerLookahead();
+    // Screen reader output does not wait for the window, as it must be heard now.
+    while (!d->scheduler.isEmpty() &&
+           (d->inFlight.count() < lookahead || d->scheduler.nextPriority() == KSpeech::jpScreenReaderOutput))
+    {
+        const JobScheduler::Job job = d->scheduler.takeNext();
+        if (submit(job.appId, job.text, job.options, job.priority, job.jobNum) == -1)
+            setJobState(job.jobNum, KSpeech::jsDeleted);
+        else
+        {
+            d->inFlight.insert(job.jobNum);
+            d->admission.setDispatched(job.jobNum);
+        }
+    }
+    d->dispatching = false;
+}
+
+bool Speaker::admit(const QString &appId, AppData *appData, KSpeech::JobPriority priority, qint64 bytes,
+                    const ConfigSnapshot &config)
+{
+    const int rate = appData->rateLimit() ? appData->rateLimit() : config.rateLimit();
+    const int burst = appData->rateBurst() ? appData->rateBurst() : config.rateBurst();
+    if (rate > 0 && !d->admission.takeToken(appId, rate, burst, d->clock.elapsed()))
+    {
+        kWarning() << "refusing a job of" << appId << "over its rate limit";
+        if (!d->throttled.contains(appId))
+        {
+            d->throttled.insert(appId);
+            emit backpressure(appId, true);
+        }
+        return false;
+    }
+    if (d->throttled.remove(appId))
+        emit backpressure(appId, false);
+
+    const qint64 maxBytes = config.maxPendingBytes();
+    if (maxBytes > 0 && d->admission.pendingBytes() + bytes > maxBytes)
+    {
+        QList<int> jobNums;
+        if (!d->admission.makeRoom(bytes, maxBytes, AdmissionControl::policy(config.overflowPolicy()),
+                                   priority, &jobNums))
+        {
+            kWarning() << "refusing a job of" << appId << "with" << d->admission.pendingBytes()
+                       << "bytes of text pending";
+            return false;
+        }
+        foreach (int jobNum, jobNums)
+        {
+            d->scheduler.remove(jobNum);
+            setJobState(jobNum, KSpeech::jsDeleted);
+        }
+    }
+    return true;
+}
+
+void Speaker::updateBackpressure()
+{
+    // On at three quarters of the budget and off again at half, so a queue
+    // hovering around one mark does not flood the bus with signals.
+    const qint64 maxBytes = JovieConfig::Instance()->snapshot()->maxPendingBytes();
+    const qint64 pending = d->admission.pendingBytes();
+    if (!d->budgetPressure && maxBytes > 0 && pending >= maxBytes / 4 * 3)
+    {
+        d->budgetPressure = true;
+        emit backpressure(QString(), true);
+    }
+    else if (d->budgetPressure && (maxBytes <= 0 || pending <= maxBytes / 2))
+    {
+        d->budgetPressure = false;
+        emit backpressure(QString(), false);
+    }
+}
+
+int Speaker::submit(const QString &appId, const QString &text, int sayOptions,
+                    KSpeech::JobPriority priority, int scheduledJobNum)
 {
     QString filteredText = text;
     int jobNum = -1;
 
     AppData* appData = getAppData(appId);
-    KSpeech::JobPriority priority = appData->defaultPriority();
     TalkerCode talkerCode = d->currentTalker;
     //kDebug() << "Speaker::say priority = " << priority;
     //kDebug() << "Running: Speaker::say appId = " << appId << " text = " << text;
     //QString talker = appData->defaultTalker();
 
-    SPDPriority spdpriority = SPD_PROGRESS; // default to least priority
-    switch (priority)
-    {
-        case KSpeech::jpScreenReaderOutput: /**< Screen Reader job. SPD_IMPORTANT */
-            spdpriority = SPD_IMPORTANT;
-            break;
-        case KSpeech::jpWarning: /**< Warning job. SPD_NOTIFICATION */
-            spdpriority = SPD_NOTIFICATION;
-            break;
-        case KSpeech::jpMessage: /**< Message job.SPD_MESSAGE */
-            spdpriority = SPD_MESSAGE;
-            break;
-        case KSpeech::jpText: /**< Text job. SPD_TEXT */
-            spdpriority = SPD_TEXT;
-            break;
-        case KSpeech::jpProgress: /**< Progress report. SPD_PROGRESS added KDE 4.4 */
-            spdpriority = SPD_PROGRESS;
-            break;
-    }
+    const SPDPriority spdpriority = spdPriority(priority);
 
     if (appData->filteringOn()) {
-        filteredText = d->filterMgr->convert(text, &talkerCode, appId);
+        filteredText = d->filters()->convert(text, &talkerCode, appId);
     }
 
     // Change the voice to the talkerCode from the filter if needed.
@@ -421,41 +1202,95 @@ int Speaker::say(const QString& appId, const QString& text, int sayOptions)
     }
     emit newJobFiltered(text, filteredText);
 
-    while (jobNum == -1 && d->connection != NULL)
+    // Text is split once, and its sentences kept until the job ends.
+    SentenceBuffer sentences;
+    if (sayOptions != KSpeech::soSsml && sayOptions != KSpeech::soChar &&
+        sayOptions != KSpeech::soKey && sayOptions != KSpeech::soSoundIcon)
+        sentences = parseText(filteredText, appId);
+
+    if (d->native())
     {
+        // Nothing is waited for; the replies are matched up as they come.
+        jobNum = scheduledJobNum ? scheduledJobNum : ++d->lastJobNum;
+        d->ssip->set("PRIORITY", ssipPriority(spdpriority));
+        int requestId;
         switch (sayOptions)
         {
-            case KSpeech::soNone: /**< No options specified.  Autodetected. */
-                jobNum = spd_say(d->connection, spdpriority, filteredText.toUtf8().data());
+            case KSpeech::soSsml:
+                d->ssip->set("SSML_MODE", "on");
+                requestId = d->ssip->speak(filteredText);
+                d->ssip->set("SSML_MODE", "off");
+                break;
+            case KSpeech::soChar:
+                d->ssip->set("SPELLING", "on");
+                requestId = d->ssip->speak(filteredText);
+                d->ssip->set("SPELLING", "off");
+                break;
+            case KSpeech::soKey:
+                requestId = d->ssip->key(filteredText);
                 break;
+            case KSpeech::soSoundIcon:
+                requestId = d->ssip->soundIcon(filteredText);
+                break;
+            default:
+                // The sentences go in one block, so no other message gets between them.
+                if (sentences.isEmpty())
+                    requestId = d->ssip->speak(filteredText);
+                else
+                    requestId = d->ssip->speakBlock(sentences);
+                break;
+        }
+        d->startSsipJob(jobNum, requestId);
+    }
+
+    QList<int> lostJobNums;
+    while (jobNum == -1 && d->connected())
+    {
+        int msgId = -1;
+        switch (sayOptions)
+        {
+            case KSpeech::soNone: /**< No options specified.  Autodetected. */
             case KSpeech::soPlainText: /**< The text contains plain text. */
-                jobNum = spd_say(d->connection, spdpriority, filteredText.toUtf8().data());
+                // Marks at the sentences tell how far the job got.
+                if (sentences.count() > 1)
+                    msgId = d->sayMarked(spdpriority, sentences, 0);
+                else
+                    msgId = spd_say(d->connection, spdpriority, filteredText.toUtf8().data());
                 break;
             case KSpeech::soHtml: /**< The text contains HTML markup. */
-                jobNum = spd_say(d->connection, spdpriority, filteredText.toUtf8().data());
+                msgId = spd_say(d->connection, spdpriority, filteredText.toUtf8().data());
                 break;
             case KSpeech::soSsml: /**< The text contains SSML markup. */
                 spd_set_data_mode(d->connection, SPD_DATA_SSML);
-                jobNum = spd_say(d->connection, spdpriority, filteredText.toUtf8().data());
+                msgId = spd_say(d->connection, spdpriority, filteredText.toUtf8().data());
                 spd_set_data_mode(d->connection, SPD_DATA_TEXT);
                 break;
             case KSpeech::soChar: /**< The text should be spoken as individual characters. */
                 spd_set_spelling(d->connection, SPD_SPELL_ON);
-                jobNum = spd_say(d->connection, spdpriority, filteredText.toUtf8().data());
+                msgId = spd_say(d->connection, spdpriority, filteredText.toUtf8().data());
                 spd_set_spelling(d->connection, SPD_SPELL_OFF);
                 break;
             case KSpeech::soKey: /**< The text contains a keyboard symbolic key name. */
-                jobNum = spd_key(d->connection, spdpriority, filteredText.toUtf8().data());
+                msgId = spd_key(d->connection, spdpriority, filteredText.toUtf8().data());
                 break;
             case KSpeech::soSoundIcon: /**< The text is the name of a sound icon. */
-                jobNum = spd_sound_icon(d->connection, spdpriority, filteredText.toUtf8().data());
+                msgId = spd_sound_icon(d->connection, spdpriority, filteredText.toUtf8().data());
                 break;
         }
-        if (jobNum == -1 && d->connection != NULL)
+        if (msgId != -1)
+        {
+            // The events of the message come from the event loop, so after this.
+            jobNum = scheduledJobNum ? scheduledJobNum : ++d->lastJobNum;
+            d->speechdJobs.insert(msgId, jobNum);
+        }
+        else if (d->connection != NULL)
         {
             // job failure
             // try to reconnect once
             kDebug() << "trying to reconnect to speech dispatcher";
+            // The messages on the old connection will not end or be cancelled.
+            lostJobNums += d->speechdJobs.values();
+            d->speechdJobs.clear();
             if (!d->reconnect())
             {
                 // replace this with an error stored in kttsd in a log? to be viewed on hover over kttsmgr?
@@ -463,15 +1298,31 @@ int Speaker::say(const QString& appId, const QString& text, int sayOptions)
             }
         }
     }
+    // Releases their text, journal entries and room in the scheduler.
+    foreach (int lostJobNum, lostJobNums)
+        setJobState(lostJobNum, KSpeech::jsDeleted);
+
+    if (jobNum == -1)
+        return -1;
 
-    if (jobNum != -1)
+    StartupTimeline::reached(StartupTimeline::FirstUtterance);
+    if (d->recoveryPending)
     {
-        kDebug() << "incoming job with text: " << text;
-        kDebug() << "saying post filtered text: " << filteredText;
+        d->recoveryPending = false;
+        QTimer::singleShot(0, this, SLOT(slotRecoverJobs()));
     }
-
-    //// Note: Set state last so job is fully populated when jobStateChanged signal is emitted.
-    appData->jobList()->append(jobNum);
+    kDebug() << "incoming job with text: " << text;
+    kDebug() << "saying post filtered text: " << filteredText;
+    // Scheduled jobs were registered when queued.
+    if (!scheduledJobNum)
+        d->jobs.add(jobNum, appId, priority, talkerCode.getTalkerCode());
+    if (!sentences.isEmpty())
+    {
+        d->sentences.insert(jobNum, sentences);
+        d->jobs.setSentenceCount(jobNum, sentences.count());
+    }
+    if (!scheduledJobNum)
+        emit jobStateChanged(appId, jobNum, KSpeech::jsQueued);
     return jobNum;
 }
 
@@ -483,10 +1334,78 @@ int Speaker::findJobNumByAppId(const QString& appId) const
         return getAppData(appId)->lastJobNum();
 }
 
+const JobRegistry* Speaker::jobRegistry() const
+{
+    return &d->jobs;
+}
+
+const SentenceBuffer* Speaker::jobSentences(int jobNum) const
+{
+    QHash<int, SentenceBuffer>::const_iterator it = d->sentences.constFind(jobNum);
+    return it == d->sentences.constEnd() ? 0 : &it.value();
+}
+
+int Speaker::moveRelSentence(int jobNum, int n)
+{
+    const JobRegistry::Job *job = d->jobs.job(jobNum);
+    if (!job || !d->sentences.contains(jobNum))
+        return 0;
+    const int current = qMax(int(job->sentenceNum), 1);
+    const int target = qBound(1, current + n, int(job->sentenceCount));
+    // speech-dispatcher cancels by connection, so the job can only be moved
+    // while no other job is in flight with it.  It is sent again once all
+    // its messages are cancelled.
+    if (target == current || !d->ownsConnection(jobNum))
+        return current;
+    d->seeks.insert(jobNum, target);
+    d->jobs.setSentenceNum(jobNum, target);
+    cancelJob(jobNum);
+    return target;
+}
+
+void Speaker::resubmit(int jobNum, int first)
+{
+    const JobRegistry::Job *job = d->jobs.job(jobNum);
+    const SentenceBuffer sentences = d->sentences.value(jobNum);
+    if (!job || first >= sentences.count())
+    {
+        setJobState(jobNum, KSpeech::jsDeleted);
+        return;
+    }
+    // The sentences were filtered when the job was first sent.
+    const SPDPriority priority = spdPriority(KSpeech::JobPriority(job->priority));
+    d->jobs.setSentenceNum(jobNum, first + 1);
+    if (d->native())
+    {
+        d->ssip->set("PRIORITY", ssipPriority(priority));
+        d->startSsipJob(jobNum, d->ssip->speakBlock(sentences, first), first);
+        return;
+    }
+    const int msgId = d->connected() ? d->sayMarked(priority, sentences, first) : -1;
+    if (msgId == -1)
+    {
+        setJobState(jobNum, KSpeech::jsDeleted);
+        return;
+    }
+    d->speechdJobs.insert(msgId, jobNum);
+}
+
+void Speaker::markReached(int jobNum, const QString &mark)
+{
+    if (!mark.startsWith(QLatin1String(sentenceMark)))
+        return;
+    bool ok;
+    const int sentenceNum = mark.mid(qstrlen(sentenceMark)).toInt(&ok);
+    if (!ok || !d->jobs.job(jobNum))
+        return;
+    d->jobs.setSentenceNum(jobNum, sentenceNum);
+    d->journal.progress(jobNum, sentenceNum - 1);
+}
+
 void Speaker::requestExit()
 {
     // kDebug() << "Speaker::requestExit: Running";
-    //d->exitRequested = true;
+    d->journal.discard();
 }
 
 bool Speaker::isSpeaking()
@@ -501,58 +1420,29 @@ void Speaker::setTalker(int jobNum, const QString &talker)
 
 QStringList Speaker::outputModules()
 {
+    d->connected();
     return d->outputModules;
 }
 
 QStringList Speaker::languagesByModule(const QString & module)
 {
-    QStringList languages;
-    if (d->connection && module != QLatin1String("dummy") &&
-        spd_set_output_module(d->connection, module.toUtf8().data()) == 0)
-    {
-        SPDVoice ** voices = spd_list_synthesis_voices(d->connection);
-        while (voices != NULL && voices[0] != NULL)
-        {
-            if (!languages.contains(QLatin1String( voices[0]->language) ))
-                languages << QLatin1String( voices[0]->language );
-            ++voices;
-        }
-    }
-    return languages;
+    return VoiceCatalog::Instance()->languagesByModule(module);
 }
 
 QStringList Speaker::getPossibleTalkers()
 {
-    QStringList talkers;
-
-    foreach (const QString &module, d->outputModules)
-    {
-        if (d->connection &&
-                spd_set_output_module(d->connection, module.toUtf8().data()) == 0)
-        {
-            SPDVoice ** voices = spd_list_synthesis_voices(d->connection);
-            kDebug() << "Got voices for output module " << module;
-            while (voices != NULL && voices[0] != NULL)
-            {
-                TalkerCode code;
-                code.setOutputModule(module);
-                code.setVoiceName(QLatin1String(voices[0]->name));
-                code.setLanguage(QLatin1String(voices[0]->language));
-                talkers.append (code.getTalkerCode());
-                ++voices;
-            }
-        }
-    }
-
-    return talkers;
+    return VoiceCatalog::Instance()->possibleTalkers();
 }
 
 void Speaker::setSpeed(int speed)
 {
-    if (d->connection) {
+    if (d->native())
+        d->ssip->set("RATE", QByteArray::number(speed));
+    else if (d->connected())
         spd_set_voice_rate(d->connection, speed);
-        d->currentTalker.setRate(speed);
-    }
+    else
+        return;
+    d->currentTalker.setRate(speed);
 }
 
 int Speaker::speed()
@@ -562,10 +1452,13 @@ int Speaker::speed()
 
 void Speaker::setPitch(int pitch)
 {
-    if (d->connection) {
+    if (d->native())
+        d->ssip->set("PITCH", QByteArray::number(pitch));
+    else if (d->connected())
         spd_set_voice_pitch(d->connection, pitch);
-        d->currentTalker.setPitch(pitch);
-    }
+    else
+        return;
+    d->currentTalker.setPitch(pitch);
 }
 
 int Speaker::pitch()
@@ -575,10 +1468,13 @@ int Speaker::pitch()
 
 void Speaker::setVolume(int volume)
 {
-    if (d->connection) {
+    if (d->native())
+        d->ssip->set("VOLUME", QByteArray::number(volume));
+    else if (d->connected())
         spd_set_volume(d->connection, volume);
-        d->currentTalker.setVolume(volume);
-    }
+    else
+        return;
+    d->currentTalker.setVolume(volume);
 }
 
 int Speaker::volume()
@@ -588,7 +1484,11 @@ int Speaker::volume()
 
 void Speaker::setOutputModule(const QString & module)
 {
-    if (d->connection) {
+    if (d->native()) {
+        d->ssip->set("OUTPUT_MODULE", module.toUtf8());
+        d->currentTalker.setOutputModule(module);
+    }
+    else if (d->connected()) {
         int result = spd_set_output_module(d->connection, module.toUtf8().data());
         d->currentTalker.setOutputModule(module);
         // discard result for now, TODO: add error reporting
@@ -602,7 +1502,11 @@ QString Speaker::outputModule()
 
 void Speaker::setVoiceName(const QString & voiceName)
 {
-    if (d->connection) {
+    if (d->native()) {
+        d->ssip->set("SYNTHESIS_VOICE", voiceName.toUtf8());
+        d->currentTalker.setVoiceName(voiceName);
+    }
+    else if (d->connected()) {
         int result = spd_set_synthesis_voice(d->connection, voiceName.toUtf8().data());
         d->currentTalker.setVoiceName(voiceName);
     }
@@ -615,15 +1519,27 @@ QString Speaker::voiceName()
 
 void Speaker::setPunctuationType(int punctuation)
 {
-    if(d->connection && punctuation >= SPD_PUNCT_ALL && punctuation <= SPD_PUNCT_SOME){
+    if (punctuation < SPD_PUNCT_ALL || punctuation > SPD_PUNCT_SOME)
+        return;
+    if (d->native()) {
+        static const char * const names[] = { "all", "none", "some" };
+        d->ssip->set("PUNCTUATION", names[punctuation - SPD_PUNCT_ALL]);
+        d->currentTalker.setPunctuation(punctuation);
+    }
+    else if (d->connected()) {
         int result = spd_set_punctuation(d->connection, SPDPunctuation(punctuation));
+        d->currentTalker.setPunctuation(punctuation);
     }
 }
 
 
 void Speaker::setLanguage(const QString & language)
 {
-    if (d->connection) {
+    if (d->native()) {
+        d->ssip->set("LANGUAGE", language.toUtf8());
+        d->currentTalker.setLanguage(language);
+    }
+    else if (d->connected()) {
         int result = spd_set_language(d->connection, language.toUtf8().data());
         d->currentTalker.setLanguage(language);
         // discard result for now, TODO: add error reporting
@@ -637,7 +1553,14 @@ QString Speaker::language()
 
 void Speaker::setVoiceType(int voiceType)
 {
-    if (d->connection) {
+    if (d->native()) {
+        static const char * const names[] = { "MALE1", "MALE2", "MALE3", "FEMALE1",
+            "FEMALE2", "FEMALE3", "CHILD_MALE", "CHILD_FEMALE" };
+        if (voiceType >= SPD_MALE1 && voiceType <= SPD_CHILD_FEMALE)
+            d->ssip->set("VOICE_TYPE", names[voiceType - SPD_MALE1]);
+        d->currentTalker.setVoiceType(voiceType);
+    }
+    else if (d->connected()) {
         int result = spd_set_voice_type(d->connection, SPDVoiceType(voiceType));
         d->currentTalker.setVoiceType(voiceType);
         // discard result for now, TODO: add error reporting
@@ -653,7 +1576,9 @@ int Speaker::voiceType()
 
 void Speaker::stop()
 {
-    if (d->connection)
+    if (d->native())
+        d->ssip->command("STOP self");
+    else if (d->connected())
         spd_stop(d->connection);
     else
         kDebug() << "unable to stop as there's no connection to speech-dispatcher";
@@ -661,7 +1586,13 @@ void Speaker::stop()
 
 void Speaker::cancel()
 {
-    if (d->connection)
+    foreach (int jobNum, d->scheduler.clear())
+        setJobState(jobNum, KSpeech::jsDeleted);
+    // Jobs being moved to another sentence are not sent again.
+    d->seeks.clear();
+    if (d->native())
+        d->ssip->command("CANCEL self");
+    else if (d->connected())
         spd_cancel(d->connection);
     else
         kDebug() << "unable to cancel as there's no connection to speech-dispatcher";
@@ -669,7 +1600,9 @@ void Speaker::cancel()
 
 void Speaker::pause()
 {
-    if (d->connection)
+    if (d->native())
+        d->ssip->command("PAUSE self");
+    else if (d->connected())
         spd_pause(d->connection);
     else
         kDebug() << "unable to pause as there's no connection to speech-dispatcher";
@@ -677,7 +1610,9 @@ void Speaker::pause()
 
 void Speaker::resume()
 {
-    if (d->connection)
+    if (d->native())
+        d->ssip->command("RESUME self");
+    else if (d->connected())
         spd_resume(d->connection);
     else
         kDebug() << "unable to resume as there's no connection to speech-dispatcher";
@@ -690,6 +1625,55 @@ bool Speaker::isApplicationPaused(const QString& appId)
 
 void Speaker::slotServiceUnregistered(const QString& serviceName)
 {
-    if (d->appData.contains(serviceName))
-        d->appData[serviceName]->setUnregistered(true);
+    releaseAppData(serviceName);
+}
+
+void Speaker::releaseAppData(const QString& appId)
+{
+    if (d->appData.contains(appId))
+    {
+        d->appData[appId]->setUnregistered(true);
+        d->departed.insert(appId);
+        d->collectTimer.start();
+    }
+    d->admission.forget(appId);
+    d->throttled.remove(appId);
+}
+
+void Speaker::slotCollectAppData()
+{
+    foreach (const QString &appId, d->departed)
+    {
+        if (d->jobs.liveCount(appId))
+            continue;
+        d->departed.remove(appId);
+        AppData *appData = d->appData.value(appId);
+        if (!appData)
+            continue;
+        kDebug() << "collecting the data of" << appId;
+        d->appData.remove(appId);
+        delete appData;
+    }
+}
+
+QVariantMap Speaker::stats() const
+{
+    int unregistered = 0;
+    qint64 bytes = d->jobs.memoryUsage();
+    foreach (const SentenceBuffer &sentences, d->sentences)
+        bytes += sentences.memoryUsage();
+    foreach (AppData *appData, d->appData)
+    {
+        if (appData->unregistered())
+            ++unregistered;
+        bytes += appData->memoryUsage();
+    }
+    QVariantMap stats;
+    stats.insert(QLatin1String("applications"), d->appData.count());
+    stats.insert(QLatin1String("unregistered"), unregistered);
+    stats.insert(QLatin1String("jobs"), d->jobs.count());
+    stats.insert(QLatin1String("liveJobs"), d->jobs.liveCount());
+    stats.insert(QLatin1String("appIds"), d->jobs.appIdCount());
+    stats.insert(QLatin1String("bytes"), bytes);
+    return stats;
 }
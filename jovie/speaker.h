@@ -32,6 +32,7 @@
 #include <QtCore/QObject>
 #include <QtCore/QList>
 #include <QtCore/QEvent>
+#include <QtCore/QVariantMap>
 
 #include <kspeech.h>
 
@@ -46,6 +47,8 @@
 #include "filtermgr.h"
 #include "appdata.h"
 #include "speechjob.h"
+#include "jobregistry.h"
+#include "sentencebuffer.h"
 
 /**
  * Struct used to keep a pool of FilterMgr objects.
@@ -58,6 +61,7 @@
 //};
 
 class SpeakerPrivate;
+class ConfigSnapshot;
 
 /**
  * @class Speaker
@@ -77,6 +81,8 @@ public:
     static Speaker * Instance();
 
     static void speechdCallback(size_t msg_id, size_t client_id, SPDNotificationType type);
+    static void speechdIndexMarkCallback(size_t msg_id, size_t client_id, SPDNotificationType type,
+                                         char *index_mark);
 
     /**
     * Destructor.
@@ -84,13 +90,37 @@ public:
     ~Speaker();
 
     /**
-    * (re)initializes the filtermgr
+    * (re)initializes the filtermgr and rereads the talkers.
+    * The filters are loaded when the event loop is next idle, or by the first job.
     */
     void init();
 
     /**
-    * Tells the thread to exit.
-    * TODO: Is this used anymore?
+    * Rereads the filter configuration, loading only the filters that changed.
+    */
+    void reloadFilters();
+
+    /**
+    * Loads a filter again, for example because a file it reads has changed.
+    * @param filterId       ID of the filter, as in the Filter_<ID> group of kttsdrc.
+    */
+    void reloadFilter(const QString &filterId);
+
+    /**
+    * Rereads the talkers and sends speech-dispatcher the settings of the
+    * default talker that changed.
+    */
+    void reloadTalkers();
+
+    /**
+    * Whether the connection to speech-dispatcher is still being opened.
+    * @ref connectionReady is emitted when it is done.
+    */
+    bool isConnecting() const;
+
+    /**
+    * Tells the speaker Jovie is exiting cleanly, so the jobs still pending
+    * are not queued again on the next start.
     */
     void requestExit();
 
@@ -106,10 +136,33 @@ public:
     * with defaults.
     * Caller may set properties, but must not delete the returned AppData object.
     * Use releaseAppData instead.
-    * @param appId          The DBUS senderId of the application.
+    * @param appId          The DBUS senderId of the application.  Jobs and
+    *                       application data are keyed by it, never by the
+    *                       name the application sets for itself.
     */
     AppData* getAppData(const QString& appId) const;
 
+    /**
+    * Get application data without creating it.
+    * @param appId          The DBUS senderId of the application.
+    * @return               The application data, or 0 if there is none.
+    */
+    AppData* findAppData(const QString& appId) const;
+
+    /**
+    * Marks an application as gone, such as a DBUS client that left the bus.
+    * Its data is deleted once none of its jobs is queued or speaking.
+    * @param appId          The DBUS senderId of the application.
+    */
+    void releaseAppData(const QString& appId);
+
+    /**
+    * Counts of the applications and jobs kept, and their approximate memory.
+    * Keys: "applications", "unregistered", "jobs", "liveJobs", "appIds" and
+    * "bytes".
+    */
+    QVariantMap stats() const;
+
     /**
     * Queue and start a speech job.
     * @param appId          The DBUS senderId of the application.
@@ -157,6 +210,33 @@ public:
     */
     SpeechJob* findLastJobByAppId(const QString& appId) const;
 
+    /**
+    * The metadata of the jobs queued, and of the latest jobs that ended.
+    */
+    const JobRegistry* jobRegistry() const;
+
+    /**
+    * The filtered sentences of a plain text job, until it ends.
+    * @param jobNum         Job number.
+    * @return               The sentences, or 0 if none are kept for the job.
+    */
+    const SentenceBuffer* jobSentences(int jobNum) const;
+
+    /**
+    * Moves a plain text job forward or back by sentences, sending it again
+    * from the new sentence.
+    * @param jobNum         Job number.
+    * @param n              Sentences to advance (positive) or rewind (negative).
+    * @return               The sentence moved to, counting from 1.  0 if the
+    *                       job has no sentences kept, such as a job still
+    *                       waiting in the scheduler.
+    *
+    * speech-dispatcher can only cancel all the messages of a connection, so
+    * the job is moved only while no other job is in flight with it.
+    * Otherwise it stays at the sentence it is at, which is returned.
+    */
+    int moveRelSentence(int jobNum, int n);
+
     /**
     * Return true if the application is paused.
     */
@@ -219,8 +299,48 @@ signals:
      */
     void newJobFiltered(const QString &prefilterText, const QString &postfilterText);
 
+    /**
+     * Emitted when opening the connection to speech-dispatcher is done, whether
+     * or not it succeeded.
+     */
+    void connectionReady();
+
+    /**
+     * Emitted when a job is queued and when speech-dispatcher reports it
+     * begins, is paused, resumed, finished or cancelled.
+     * @param appId             The application that queued the job.
+     * @param jobNum            The job number.
+     * @param state             The new state.
+     */
+    void jobStateChanged(const QString &appId, int jobNum, KSpeech::JobState state);
+
+    /**
+     * Emitted when clients should slow down, and when they may speed up again.
+     * @param appId             The application over its rate limit, or empty
+     *                          for all when the pending text nears MaxPendingBytes.
+     * @param active            True to slow down.
+     */
+    void backpressure(const QString &appId, bool active);
+
 private slots:
     void slotServiceUnregistered(const QString& serviceName);
+    void slotConnected();
+    void slotSpeechdEvent(int msgId, int type);
+    void slotSpeechdIndexMark(int msgId, const QString &mark);
+    void slotSsipMessageQueued(int requestId, int msgId);
+    void slotSsipRequestFinished(int requestId, bool ok);
+    void slotSsipEvent(int msgId, int type, const QString &mark);
+    void slotSsipDisconnected();
+    void slotLoadFilters();
+    void slotExpireDuplicates();
+    void slotCollectAppData();
+
+    /**
+    * Queues again the jobs the journal recovered from the previous run,
+    * from the first sentence not spoken.  They are queued for one internal
+    * application, and left in the journal until speech-dispatcher has them.
+    */
+    void slotRecoverJobs();
 
 private:
     /**
@@ -233,14 +353,94 @@ private:
     */
     bool isSsml(const QString &text);
 
+    /**
+    * Records a new state of a job and emits jobStateChanged, if it changed.
+    */
+    void setJobState(int jobNum, KSpeech::JobState state);
+
+    /**
+    * Filters a job and sends it to speech-dispatcher.
+    * @param scheduledJobNum Number of a scheduled job, or 0 to number it now.
+    * @return               The job number, or -1 if it could not be sent.
+    */
+    int submit(const QString &appId, const QString &text, int sayOptions,
+               KSpeech::JobPriority priority, int scheduledJobNum);
+
+    /**
+    * Sends a job again from sentence @p first, counting from 0, using the
+    * sentences kept.  Deletes the job if it cannot be sent.
+    */
+    void resubmit(int jobNum, int first);
+
+    /**
+    * Records the sentence a job has reached, from an index mark.
+    */
+    void markReached(int jobNum, const QString &mark);
+
+    /**
+    * Queues a job with the given priority.  @see say
+    */
+    int say(const QString &appId, const QString &text, int sayOptions, KSpeech::JobPriority priority);
+
+
+    /**
+    * Replaces the latest job of the application and priority: drops it if it
+    * is still waiting, or stops it if speech-dispatcher has it.
+    */
+    void supersede(const QString &appId, KSpeech::JobPriority priority);
+
+    /**
+    * Forgets the messages whose DuplicateWindow ended.  Their repeat counters
+    * are queued, to be said by @ref slotExpireDuplicates rather than from
+    * within say.
+    */
+    void expireDuplicates();
+
+    /**
+    * Stops a job that is speaking, with whatever of it speech-dispatcher
+    * still has queued.
+    */
+    void stopJob(int jobNum);
+
+    /**
+    * Cancels a job and whatever of it speech-dispatcher still has queued, if
+    * no other job has messages in flight on the same connection.
+    * @return               False if nothing was cancelled.
+    */
+    bool cancelJob(int jobNum);
+
+    /**
+    * Hands scheduled jobs to speech-dispatcher while there is room in the
+    * lookahead window.
+    */
+    void dispatchJobs();
+
+    /**
+    * Applies the rate limit of the application and the pending text budget to
+    * a new job, dropping waiting jobs if the overflow policy says so.
+    * @return               False if the job is refused.
+    */
+    bool admit(const QString &appId, AppData *appData, KSpeech::JobPriority priority, qint64 bytes,
+               const ConfigSnapshot &config);
+
+    /**
+    * Emits backpressure when the pending text crosses its marks.
+    */
+    void updateBackpressure();
+
+    /**
+    * Ends a job sent through the SSIP client once all its messages have ended.
+    */
+    void checkSsipJobEnded(int jobNum);
+
     /**
     * Parses a block of text into sentences using the application-specified regular expression
     * or (if not specified), the default regular expression.
     * @param text           The message to be spoken.
     * @param appId          The DBUS senderId of the application.
-    * @return               List of parsed sentences.
+    * @return               The parsed sentences.
     */
-    QStringList parseText(const QString &text, const QString &appId);
+    SentenceBuffer parseText(const QString &text, const QString &appId);
 
 private:
     SpeakerPrivate* const d;
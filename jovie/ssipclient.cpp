@@ -0,0 +1,326 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Asynchronous client of the SSIP protocol of speech-dispatcher.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// SsipClient includes.
+#include "ssipclient.h"
+#include "ssipclient.moc"
+
+// Qt includes.
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtNetwork/QLocalSocket>
+
+// KDE includes.
+#include <kdebug.h>
+
+// KTTSD includes.
+#include "sentencebuffer.h"
+
+SsipClient::SsipClient(QObject *parent) :
+    QObject(parent),
+    m_socket(new QLocalSocket(this)),
+    m_lastRequestId(0),
+    m_open(false)
+{
+    connect(m_socket, SIGNAL(connected()), this, SLOT(slotConnected()));
+    connect(m_socket, SIGNAL(readyRead()), this, SLOT(slotReadyRead()));
+    connect(m_socket, SIGNAL(disconnected()), this, SLOT(slotDisconnected()));
+    // A connection that cannot be opened only reports an error.
+    connect(m_socket, SIGNAL(error(QLocalSocket::LocalSocketError)), this, SLOT(slotDisconnected()));
+}
+
+SsipClient::~SsipClient()
+{
+    m_socket->disconnect(this);
+}
+
+QString SsipClient::defaultAddress()
+{
+    const QByteArray address = qgetenv("SPEECHD_ADDRESS");
+    if (!address.isEmpty())
+    {
+        if (!address.startsWith("unix_socket"))
+            return QString();
+        const int sep = address.indexOf(':');
+        if (sep >= 0 && sep + 1 < address.size())
+            return QFile::decodeName(address.mid(sep + 1));
+    }
+    const QByteArray runtimeDir = qgetenv("XDG_RUNTIME_DIR");
+    if (!runtimeDir.isEmpty())
+        return QFile::decodeName(runtimeDir) + QLatin1String("/speech-dispatcher/speechd.sock");
+    return QDir::homePath() + QLatin1String("/.cache/speech-dispatcher/speechd.sock");
+}
+
+void SsipClient::connectToServer(const QString &path)
+{
+    if (m_open)
+        disconnectFromServer();
+    m_open = true;
+    m_socket->connectToServer(path);
+}
+
+void SsipClient::disconnectFromServer()
+{
+    m_open = false;
+    m_outbox.clear();
+    m_socket->abort();
+    failPending();
+}
+
+bool SsipClient::isOpen() const
+{
+    return m_open;
+}
+
+int SsipClient::pendingReplies() const
+{
+    return m_expected.count();
+}
+
+int SsipClient::command(const QByteArray &line)
+{
+    const int requestId = newRequest();
+    expect(requestId, CommandReply, true);
+    send(line + "\r\n");
+    return requestId;
+}
+
+int SsipClient::set(const QByteArray &parameter, const QByteArray &value)
+{
+    // A line end in the value would end the command early.
+    QByteArray line = "SET self " + parameter + ' ' + value;
+    line.replace('\r', ' ').replace('\n', ' ');
+    return command(line);
+}
+
+int SsipClient::speak(const QString &text)
+{
+    const int requestId = newRequest();
+    sendSpeak(requestId, QStringRef(&text), true);
+    return requestId;
+}
+
+int SsipClient::speakBlock(const QStringList &texts)
+{
+    if (texts.count() == 1)
+        return speak(texts.first());
+    const int requestId = newRequest();
+    expect(requestId, CommandReply, false);
+    send("BLOCK BEGIN\r\n");
+    foreach (const QString &text, texts)
+        sendSpeak(requestId, QStringRef(&text), false);
+    expect(requestId, CommandReply, true);
+    send("BLOCK END\r\n");
+    return requestId;
+}
+
+int SsipClient::speakBlock(const SentenceBuffer &sentences, int first)
+{
+    const int count = sentences.count() - first;
+    if (count == 1)
+        return speak(sentences.sentence(first).toString());
+    const int requestId = newRequest();
+    expect(requestId, CommandReply, false);
+    send("BLOCK BEGIN\r\n");
+    for (int n = first; n < sentences.count(); ++n)
+        sendSpeak(requestId, sentences.sentence(n), false);
+    expect(requestId, CommandReply, true);
+    send("BLOCK END\r\n");
+    return requestId;
+}
+
+int SsipClient::key(const QString &name)
+{
+    const int requestId = newRequest();
+    expect(requestId, QueuedReply, true);
+    send("KEY " + name.toUtf8().simplified() + "\r\n");
+    return requestId;
+}
+
+int SsipClient::soundIcon(const QString &name)
+{
+    const int requestId = newRequest();
+    expect(requestId, QueuedReply, true);
+    send("SOUND_ICON " + name.toUtf8().simplified() + "\r\n");
+    return requestId;
+}
+
+void SsipClient::slotConnected()
+{
+    if (!m_outbox.isEmpty())
+    {
+        m_socket->write(m_outbox);
+        m_outbox.clear();
+    }
+    emit connected();
+}
+
+void SsipClient::slotReadyRead()
+{
+    while (m_socket->canReadLine())
+    {
+        QByteArray line = m_socket->readLine();
+        while (line.endsWith('\n') || line.endsWith('\r'))
+            line.chop(1);
+        bool ok = line.size() >= 4 && (line.at(3) == '-' || line.at(3) == ' ');
+        const int code = ok ? line.left(3).toInt(&ok) : 0;
+        if (!ok)
+        {
+            kWarning() << "SsipClient: not an SSIP reply:" << line;
+            m_socket->abort();
+            return;
+        }
+        const QByteArray text = line.mid(4);
+        const bool more = line.at(3) == '-';
+        // Events come whenever they happen, also between the lines of a reply.
+        if (code >= 700 && code < 800)
+        {
+            if (more)
+                m_eventData.append(text);
+            else
+                handleEvent(code);
+        }
+        else
+        {
+            if (more)
+                m_replyData.append(text);
+            else
+                handleReply(code, text);
+        }
+    }
+}
+
+void SsipClient::slotDisconnected()
+{
+    // Both disconnected() and error() may come for one loss of the connection.
+    if (!m_open || m_socket->state() == QLocalSocket::ConnectedState)
+        return;
+    m_open = false;
+    m_outbox.clear();
+    failPending();
+    emit disconnected();
+}
+
+int SsipClient::newRequest()
+{
+    return ++m_lastRequestId;
+}
+
+void SsipClient::send(const QByteArray &data)
+{
+    if (m_socket->state() == QLocalSocket::ConnectedState)
+        m_socket->write(data);
+    else
+        m_outbox += data;
+}
+
+void SsipClient::expect(int requestId, ReplyKind kind, bool last)
+{
+    Expected expected;
+    expected.requestId = requestId;
+    expected.kind = kind;
+    expected.last = last;
+    m_expected.enqueue(expected);
+}
+
+void SsipClient::sendSpeak(int requestId, const QStringRef &text, bool last)
+{
+    expect(requestId, DataPrompt, false);
+    expect(requestId, QueuedReply, last);
+    // The data follows right away.  speech-dispatcher reads it once it has
+    // answered SPEAK, so there is no need to wait for the answer.
+    send("SPEAK\r\n" + escapeData(text) + "\r\n.\r\n");
+}
+
+void SsipClient::handleReply(int code, const QByteArray &text)
+{
+    const QList<QByteArray> data = m_replyData;
+    m_replyData.clear();
+    if (m_expected.isEmpty())
+    {
+        kWarning() << "SsipClient: reply to no command:" << code << text;
+        return;
+    }
+    const Expected expected = m_expected.dequeue();
+    const bool ok = code >= 200 && code < 300;
+    switch (expected.kind)
+    {
+        case DataPrompt:
+            if (code != 230)
+            {
+                // The data sent after SPEAK would be read as commands, and the
+                // replies to them could not be told apart.  Start over.
+                kWarning() << "SsipClient: SPEAK refused:" << code << text;
+                m_socket->abort();
+                return;
+            }
+            break;
+        case QueuedReply:
+            if (ok && !data.isEmpty())
+                emit messageQueued(expected.requestId, data.first().toInt());
+            break;
+        case CommandReply:
+            break;
+    }
+    if (!ok)
+    {
+        kDebug() << "SsipClient: command failed:" << code << text;
+        m_failed.insert(expected.requestId);
+    }
+    if (expected.last)
+        emit requestFinished(expected.requestId, !m_failed.remove(expected.requestId));
+}
+
+void SsipClient::handleEvent(int code)
+{
+    const QList<QByteArray> data = m_eventData;
+    m_eventData.clear();
+    if (code < 700 || code > 705 || data.isEmpty())
+        return;
+    // Data lines are the message id, the client id and, for index marks, the mark.
+    const QString mark = data.count() > 2 ? QString::fromUtf8(data.at(2)) : QString();
+    emit event(data.first().toInt(), EventType(IndexMark + code - 700), mark);
+}
+
+void SsipClient::failPending()
+{
+    const QQueue<Expected> expected = m_expected;
+    m_expected.clear();
+    m_replyData.clear();
+    m_eventData.clear();
+    m_failed.clear();
+    foreach (const Expected &e, expected)
+    {
+        if (e.last)
+            emit requestFinished(e.requestId, false);
+    }
+}
+
+QByteArray SsipClient::escapeData(const QStringRef &text)
+{
+    // A line of just "." ends the data, so dots starting a line are doubled.
+    QByteArray data = text.toUtf8();
+    if (data.startsWith('.'))
+        data.prepend('.');
+    data.replace("\r\n.", "\r\n..");
+    return data;
+}
@@ -0,0 +1,207 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Asynchronous client of the SSIP protocol of speech-dispatcher.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef SSIPCLIENT_H
+#define SSIPCLIENT_H
+
+// Qt includes.
+#include <QtCore/QObject>
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QQueue>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+
+class QLocalSocket;
+class SentenceBuffer;
+
+/**
+ * @class SsipClient
+ *
+ * Talks SSIP to speech-dispatcher over its unix socket, from the event loop.
+ *
+ * Unlike libspeechd, which sends a command and blocks until the reply comes,
+ * SsipClient writes commands as they are made and does not wait for replies.
+ * speech-dispatcher answers the commands of a connection in order, so each
+ * reply is matched with the oldest command still waiting for one.
+ *
+ * Every call returns a request number.  A request may be several commands,
+ * such as the BLOCK BEGIN, SPEAK ... and BLOCK END of @ref speakBlock.
+ * @ref messageQueued is emitted for each message the request queued and
+ * @ref requestFinished when the last of its replies has come.
+ *
+ * Commands made before the connection is open are sent once it is.
+ */
+class SsipClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Events speech-dispatcher sends about the messages.
+     */
+    enum EventType
+    {
+        IndexMark,
+        Begin,
+        End,
+        Cancel,
+        Pause,
+        Resume
+    };
+
+    explicit SsipClient(QObject *parent = 0);
+    ~SsipClient();
+
+    /**
+     * The socket speech-dispatcher listens on, as libspeechd finds it.
+     * Empty if SPEECHD_ADDRESS asks for something other than a unix socket.
+     */
+    static QString defaultAddress();
+
+    /**
+     * Opens the connection.  @ref connected or @ref disconnected tells how it went.
+     */
+    void connectToServer(const QString &path);
+
+    /**
+     * Closes the connection.  Requests still waiting for replies fail.
+     */
+    void disconnectFromServer();
+
+    /**
+     * Whether the connection is open or being opened.
+     */
+    bool isOpen() const;
+
+    /**
+     * Number of replies not received yet.
+     */
+    int pendingReplies() const;
+
+    /**
+     * Sends a command, such as "STOP self".
+     * @param line              The command, without line end.
+     */
+    int command(const QByteArray &line);
+
+    /**
+     * Sends SET self @p parameter @p value.
+     */
+    int set(const QByteArray &parameter, const QByteArray &value);
+
+    /**
+     * Queues a message.
+     */
+    int speak(const QString &text);
+
+    /**
+     * Queues messages within a BLOCK, so they are spoken together.
+     */
+    int speakBlock(const QStringList &texts);
+
+    /**
+     * Queues the sentences from @p first on within a BLOCK, each a message.
+     */
+    int speakBlock(const SentenceBuffer &sentences, int first = 0);
+
+    /**
+     * Queues a key name, as KEY does.
+     */
+    int key(const QString &name);
+
+    /**
+     * Queues a sound icon, as SOUND_ICON does.
+     */
+    int soundIcon(const QString &name);
+
+signals:
+    void connected();
+
+    /**
+     * The connection was closed or could not be opened.
+     */
+    void disconnected();
+
+    /**
+     * A message of a request was queued.
+     * @param requestId         The request.
+     * @param msgId             Message id, as in the events.
+     */
+    void messageQueued(int requestId, int msgId);
+
+    /**
+     * All replies to a request have come.
+     * @param ok                False if any command of it failed.
+     */
+    void requestFinished(int requestId, bool ok);
+
+    /**
+     * An event about a message.
+     * @param type              @ref EventType
+     * @param mark              Name of the index mark, for IndexMark.
+     */
+    void event(int msgId, int type, const QString &mark);
+
+private slots:
+    void slotConnected();
+    void slotReadyRead();
+    void slotDisconnected();
+
+private:
+    enum ReplyKind
+    {
+        CommandReply,           /* reply to a command */
+        DataPrompt,             /* 230, asking for the data of SPEAK */
+        QueuedReply             /* 225 with the id of the message queued */
+    };
+
+    struct Expected
+    {
+        int requestId;
+        ReplyKind kind;
+        bool last;              /* last reply of the request */
+    };
+
+    int newRequest();
+    void send(const QByteArray &data);
+    void expect(int requestId, ReplyKind kind, bool last);
+    void sendSpeak(int requestId, const QStringRef &text, bool last);
+    void handleReply(int code, const QByteArray &text);
+    void handleEvent(int code);
+    void failPending();
+    static QByteArray escapeData(const QStringRef &text);
+
+    QLocalSocket *m_socket;
+    // Written before the connection was open.
+    QByteArray m_outbox;
+    QQueue<Expected> m_expected;
+    QSet<int> m_failed;
+    // Data lines of the reply and of the event being read.
+    QList<QByteArray> m_replyData;
+    QList<QByteArray> m_eventData;
+    int m_lastRequestId;
+    // Set from connectToServer until the connection is lost or closed.
+    bool m_open;
+};
+
+#endif // SSIPCLIENT_H
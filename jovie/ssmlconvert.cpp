@@ -25,9 +25,9 @@
 #include "ssmlconvert.moc"
 
 // Qt includes.
-#include <QtXml/qdom.h>
 #include <QtCore/QFile>
 #include <QtCore/QTextStream>
+#include <QtCore/QXmlStreamReader>
 
 // KDE includes.
 #include <kdeversion.h>
@@ -37,6 +37,27 @@
 #include <ktemporaryfile.h>
 #include <kdebug.h>
 
+#include <libspeechd.h>
+
+// KTTS includes.
+#include "talkercode.h"
+#include "stylesheetcache.h"
+
+/// Synthesizers known to support prosody changes or SSML markup.
+/// speech-dispatcher does not report what its output modules support, nor
+/// does the voice catalog, so this is a fixed list and other modules are
+/// assumed to support neither.
+static const struct {
+    const char *module;
+    bool prosody;
+    bool ssml;
+} knownSynths[] = {
+    { "festival", true, true },
+    { "hadifix", true, false },
+    { "espeak", true, true },
+    { "ibmtts", false, true }
+};
+
 /// Constructor.
 SSMLConvert::SSMLConvert() {
     m_talkers = QStringList();
@@ -49,11 +70,14 @@ SSMLConvert::SSMLConvert(const QStringList &talkers) {
     m_talkers = talkers;
     m_xsltProc = 0;
     m_state = tsIdle;
+    indexTalkers();
 }
 
 /// Destructor.
 SSMLConvert::~SSMLConvert() {
     delete m_xsltProc;
+    foreach (const QString &stylesheet, m_stylesheets)
+        StylesheetCache::self()->removeStylesheet(stylesheet);
     if (!m_inFilename.isEmpty()) QFile::remove(m_inFilename);
     if (!m_outFilename.isEmpty()) QFile::remove(m_outFilename);
 }
@@ -61,6 +85,78 @@ SSMLConvert::~SSMLConvert() {
 /// Set the talkers to be used as reference for entered text.
 void SSMLConvert::setTalkers(const QStringList &talkers) {
     m_talkers = talkers;
+    indexTalkers();
+}
+
+/// Parse the talkers once into per-attribute sets of talkers.
+void SSMLConvert::indexTalkers() {
+    m_languageSets.clear();
+    m_regionSets.clear();
+    m_choiceCache.clear();
+    const int count = m_talkers.count();
+    m_maleSet = QBitArray(count);
+    m_femaleSet = QBitArray(count);
+    m_prosodySet = QBitArray(count);
+    m_ssmlSet = QBitArray(count);
+
+    for (int ndx = 0; ndx < count; ++ndx) {
+        const QString &code = m_talkers.at(ndx);
+        TalkerCode talkerCode(code);
+        TalkerRecord record;
+
+        QString lang = talkerCode.language().toLower();
+        lang.replace(QLatin1Char('-'), QLatin1Char('_'));
+        record.language = lang.section(QLatin1Char('_'), 0, 0);
+        record.region = lang.section(QLatin1Char('_'), 1, 1);
+
+        record.module = talkerCode.outputModule().toLower();
+        if (record.module.isEmpty())
+            record.module = code.section(QLatin1String( "synthesizer=\"" ), 1, 1).section(QLatin1Char( '"' ), 0, 0).toLower();
+
+        record.gender = 0;
+        if (code.contains(QLatin1String( "voiceType=" ))) {
+            switch (talkerCode.voiceType()) {
+                case SPD_MALE1: case SPD_MALE2: case SPD_MALE3: case SPD_CHILD_MALE:
+                    record.gender = 1;
+                    break;
+                case SPD_FEMALE1: case SPD_FEMALE2: case SPD_FEMALE3: case SPD_CHILD_FEMALE:
+                    record.gender = 2;
+                    break;
+            }
+        } else if (code.contains(QLatin1String( "gender=\"male\"" ))) {
+            record.gender = 1;
+        } else if (code.contains(QLatin1String( "gender=\"female\"" ))) {
+            record.gender = 2;
+        }
+
+        record.capabilities = 0;
+        for (uint i = 0; i < sizeof(knownSynths) / sizeof(knownSynths[0]); ++i) {
+            if (record.module.startsWith(QLatin1String(knownSynths[i].module))) {
+                if (knownSynths[i].prosody) record.capabilities |= tcProsody;
+                if (knownSynths[i].ssml) record.capabilities |= tcSsml;
+            }
+        }
+
+        QBitArray &languageSet = m_languageSets[record.language];
+        if (languageSet.isEmpty()) languageSet = QBitArray(count);
+        languageSet.setBit(ndx);
+        if (!record.region.isEmpty()) {
+            QBitArray &regionSet = m_regionSets[record.language + QLatin1Char('_') + record.region];
+            if (regionSet.isEmpty()) regionSet = QBitArray(count);
+            regionSet.setBit(ndx);
+        }
+        if (record.gender == 1) m_maleSet.setBit(ndx);
+        if (record.gender == 2) m_femaleSet.setBit(ndx);
+        if (record.capabilities & tcProsody) m_prosodySet.setBit(ndx);
+        if (record.capabilities & tcSsml) m_ssmlSet.setBit(ndx);
+    }
+}
+
+QBitArray SSMLConvert::talkerSet(const QHash<QString, QBitArray> &sets, const QString &key) const {
+    QHash<QString, QBitArray>::const_iterator it = sets.constFind(key);
+    if (it == sets.constEnd())
+        return QBitArray(m_talkers.count());
+    return it.value();
 }
 
 QString SSMLConvert::extractTalker(const QString &talkercode) {
@@ -104,90 +200,101 @@ QString SSMLConvert::extractTalker(const QString &talkercode) {
 * QDom is the item of choice for the matching. Just walk the tree..
 */
 QString SSMLConvert::appropriateTalker(const QString &text) const {
-    QDomDocument ssml;
-    ssml.setContent(text, false);  // No namespace processing.
-    /// Matches are stored here. Obviously to begin with every talker matches.
-    QStringList matches = m_talkers;
+    if (m_talkers.isEmpty())
+        return QString();
+
+    /// Only the attributes of the root element are needed, so stop reading at the
+    /// first start element rather than building a DOM of the whole document.
+    QXmlStreamReader reader(text);
+    while (!reader.atEnd() && reader.readNext() != QXmlStreamReader::StartElement)
+        ;
 
     /// Check that this is (well formed) SSML and all our searching will not be in vain.
-    QDomElement root = ssml.documentElement();
-    if(root.tagName() != QLatin1String( "speak" )) {
+    if (reader.tokenType() != QXmlStreamReader::StartElement ||
+        reader.qualifiedName() != QLatin1String( "speak" )) {
         // Not SSML.
         return QString();
     }
+    const QXmlStreamAttributes attributes = reader.attributes();
 
     /**
-    * For each rule that we are looking through, iterate over all currently
-    * matching talkers and remove all the talkers that don't match.
-    *
-    * Storage for talker code components.
+    * Language searching
+    * Default to en (or some form of en - en_US, en_GB, etc). Only one language at a time is allowed
+    * at the moment, and must be specified in the root speak element (<speak xml:lang="en-US">)
     */
-    QString talklang, talkvoice, talkgender, talkvolume, talkrate, talkname;
+    QString lang = QLatin1String( "en" );
+    if (attributes.hasAttribute(QLatin1String( "xml:lang" )))
+        lang = attributes.value(QLatin1String( "xml:lang" )).toString().toLower();
+    lang.replace(QLatin1Char('-'), QLatin1Char('_'));
 
-    kDebug() << "SSMLConvert::appropriateTalker: BEFORE LANGUAGE SEARCH: " << matches.join(QLatin1String( " " ));;
     /**
-    * Language searching
+    * Gender searching
+    * Only male and female are searched for, anything else is ignored.
     */
-    if(root.hasAttribute(QLatin1String( "xml:lang" ))) {
-        QString lang = root.attribute(QLatin1String( "xml:lang" ));
-        kDebug() << "SSMLConvert::appropriateTalker: xml:lang found (" << lang << ")";
-        /// If it is set to en*, then match all english speakers. They all sound the same anyways.
-        if(lang.contains(QLatin1String( "en-" ))) {
-            kDebug() << "SSMLConvert::appropriateTalker: English";
-            lang = QLatin1String( "en" );
-        }
-        /// Find all hits and place them in matches. We don't search for the closing " because if
-        /// the talker emits lang="en-UK" or something we'll be ignoring it, which we don't want.
-        matches = matches.filter(QLatin1String( "lang=\"" ) + lang);
-    }
-    else {
-        kDebug() << "SSMLConvert::appropriateTalker: no xml:lang found. Defaulting to en..";
-        matches = matches.filter(QLatin1String( "lang=\"en" ));
+    int gender = 0;
+    if (attributes.hasAttribute(QLatin1String( "gender" ))) {
+        QStringRef genderAttr = attributes.value(QLatin1String( "gender" ));
+        if (genderAttr == QLatin1String( "male" ))
+            gender = 1;
+        else if (genderAttr == QLatin1String( "female" ))
+            gender = 2;
     }
 
-    kDebug() << "SSMLConvert::appropriateTalker: AFTER LANGUAGE SEARCH: " << matches.join(QLatin1String( " " ));;
+    /// The choice only depends on language and gender, so look it up first.
+    const QString cacheKey = lang + QLatin1Char('|') + QString::number(gender);
+    QHash<QString, int>::const_iterator cached = m_choiceCache.constFind(cacheKey);
+    if (cached != m_choiceCache.constEnd())
+        return m_talkers.at(cached.value());
 
     /**
-    * Gender searching
-    * If, for example, male is specified and only female is found,
-    * ignore the choice and just use female.
+    * For each rule, narrow the set of matching talkers, unless that would leave
+    * no talker at all.  To begin with every talker matches.
     */
-    if(root.hasAttribute(QLatin1String( "gender" ))) {
-        QString gender = root.attribute(QLatin1String( "gender" ));
-        kDebug() << "SSMLConvert::appropriateTalker: gender found (" << gender << ")";
-        /// If the gender found is not 'male' or 'female' then ignore it.
-        if(!(gender == QLatin1String( "male" ) || gender == QLatin1String( "female" ))) {
-            /// Make sure that we don't strip away all the talkers because of no matches.
-            if(matches.filter(QLatin1String( "gender=\"" ) + gender).count() >= 1)
-                matches = matches.filter(QLatin1String( "gender=\"" ) + gender);
+    QBitArray matches(m_talkers.count(), true);
+    QBitArray narrowed;
+
+    /// Language.  Region variants (en_GB, en_US) of the language all match, and
+    /// talkers for the exact region are preferred.
+    const QString language = lang.section(QLatin1Char('_'), 0, 0);
+    narrowed = matches & talkerSet(m_languageSets, language);
+    if (narrowed.count(true) > 0) {
+        matches = narrowed;
+        if (lang.contains(QLatin1Char('_'))) {
+            narrowed = matches & talkerSet(m_regionSets, lang);
+            if (narrowed.count(true) > 0)
+                matches = narrowed;
         }
-    }
-    else {
-        kDebug() << "SSMLConvert::appropriateTalker: no gender found.";
+    } else {
+        kDebug() << "SSMLConvert::appropriateTalker: no talker for language " << lang;
     }
 
-    /**
-    * Prosody
-    * Search for talkers that allow modification of the synth output - louder, higher,
-    * slower, etc. There should be a direct way to query each synth to find out if this
-    * is supported (some function in PlugInConf), but for now, hardcode all the way :(
-    */
-    /// Known to support (feel free to add to the list and if search):
-    ///   Festival Int (not flite), Hadifix
-    if(matches.filter(QLatin1String( "synthesizer=\"Festival Interactive" )).count() >= 1 ||
-    matches.filter(QLatin1String( "synthesizer=\"Hadifix" )).count() >= 1) {
-
-        kDebug() << "SSMLConvert::appropriateTalker: Prosody allowed";
-        QStringList tmpmatches = matches.filter(QLatin1String( "synthesizer=\"Festival Interactive" ));
-        matches = matches.filter(QLatin1String( "synthesizer=\"Hadifix" ));
-        matches = tmpmatches + matches;
+    /// Gender.  If, for example, male is specified and only female is found,
+    /// ignore the choice and just use female.
+    if (gender) {
+        narrowed = matches & (gender == 1 ? m_maleSet : m_femaleSet);
+        if (narrowed.count(true) > 0)
+            matches = narrowed;
     }
+
+    /// SSML support, then prosody support.
+    narrowed = matches & m_ssmlSet;
+    if (narrowed.count(true) > 0)
+        matches = narrowed;
+    narrowed = matches & m_prosodySet;
+    if (narrowed.count(true) > 0)
+        matches = narrowed;
     else
         kDebug() << "SSMLConvert::appropriateTalker: No prosody-supporting talkers found";
 
     /// Return the first match that complies. Maybe a discrete way to
     /// choose between all the matches could be offered in the future. Some form of preference.
-    return matches[0];
+    int winner = 0;
+    while (winner < matches.size() && !matches.testBit(winner))
+        ++winner;
+    if (winner == matches.size())
+        winner = 0;
+    m_choiceCache.insert(cacheKey, winner);
+    return m_talkers.at(winner);
 }
 
 /**
@@ -205,6 +312,11 @@ QString SSMLConvert::appropriateTalker(const QString &text) const {
 
 bool SSMLConvert::transform(const QString &text, const QString &xsltFilename) {
     m_xsltFilename = xsltFilename;
+    /// Stylesheets are watched once used, so an edited one applies from the next transform on.
+    if (!m_stylesheets.contains(xsltFilename)) {
+        m_stylesheets.insert(xsltFilename);
+        StylesheetCache::self()->addStylesheet(xsltFilename);
+    }
     /// Write @param text to a temporary file.
     KTemporaryFile inFile;
     inFile.setPrefix(QLatin1String( "kttsd-" ));
@@ -232,7 +344,7 @@ bool SSMLConvert::transform(const QString &text, const QString &xsltFilename) {
 	QStringList args;
     m_xsltProc = new QProcess;
     args << QLatin1String( "-o" ) << m_outFilename  << QLatin1String( "--novalid" )
-        << m_xsltFilename << m_inFilename;
+        << StylesheetCache::self()->stylesheetFile(m_xsltFilename) << m_inFilename;
     // Warning: This won't compile under KDE 3.2.  See FreeTTS::argsToStringList().
     // kDebug() << "SSMLConvert::transform: executing command: " <<
     //     m_xsltProc->args() << endl;
@@ -26,6 +26,9 @@
 // Qt includes
 #include <QtCore/QObject>
 #include <QtCore/QStringList>
+#include <QtCore/QBitArray>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
 
 class QProcess;
 class QString;
@@ -76,7 +79,8 @@ public:
     * configurable, but better to walk before you can run.
     * Currently, the searching method in place is like a filter: Those that meet the criteria we're
     * searchin for stay while others are sifted out. This should leave us with the right talker to use.
-    * It's not a very good method, but should be appropriate in most cases and should do just fine for now.
+    * The talkers are parsed once, in setTalkers, into per-attribute sets, so each rule is
+    * an intersection of sets and the choice for a given language and gender is cached.
     * 
     * See the implementation file for more detail.
     */
@@ -113,14 +117,46 @@ private slots:
     void slotProcessExited();
 
 private:
+    /// Talker capabilities.
+    enum TalkerCapability {
+        tcProsody = 0x01,       // Talker can change volume, rate and pitch.
+        tcSsml = 0x02           // Talker understands SSML markup.
+    };
+
+    /// A talker code parsed into the attributes used for choosing a talker.
+    struct TalkerRecord {
+        QString language;       // "en" of "en_GB".
+        QString region;         // "gb" of "en_GB".
+        QString module;         // Synthesizer, lower case.
+        int gender;             // 0 unknown, 1 male, 2 female.
+        int capabilities;       // TalkerCapability flags.
+    };
+
+    /// Parses m_talkers and builds the attribute sets.
+    void indexTalkers();
+    /// Returns the set stored for key, or an empty set.
+    QBitArray talkerSet(const QHash<QString, QBitArray> &sets, const QString &key) const;
+
     /// The XSLT processor.
     QProcess *m_xsltProc;
     /// Current talkers.
     QStringList m_talkers;
+    /// Talkers by language ("en") and by language and region ("en_gb").
+    QHash<QString, QBitArray> m_languageSets;
+    QHash<QString, QBitArray> m_regionSets;
+    /// Talkers by gender and capability.
+    QBitArray m_maleSet;
+    QBitArray m_femaleSet;
+    QBitArray m_prosodySet;
+    QBitArray m_ssmlSet;
+    /// Chosen talker index for each requested language and gender.
+    mutable QHash<QString, int> m_choiceCache;
     // Current state.
     int m_state;
     // Name of XSLT file.
     QString m_xsltFilename;
+    // Stylesheets registered with the StylesheetCache.
+    QSet<QString> m_stylesheets;
     // Name of temporary input file.
     QString m_inFilename;
     // Name of temporary output file.
@@ -0,0 +1,54 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Logs how long the steps of starting Jovie take.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// StartupTimeline includes.
+#include "startuptimeline.h"
+
+// Qt includes.
+#include <QtCore/QTime>
+
+// KDE includes.
+#include <kdebug.h>
+
+static QTime s_startTime;
+static bool s_reached[StartupTimeline::MilestoneCount];
+
+static const char * const s_milestoneNames[StartupTimeline::MilestoneCount] =
+{
+    "D-Bus object registered",
+    "speech-dispatcher ready",
+    "filters loaded",
+    "first utterance"
+};
+
+void StartupTimeline::start()
+{
+    s_startTime.start();
+}
+
+void StartupTimeline::reached(Milestone milestone)
+{
+    if (s_reached[milestone] || !s_startTime.isValid())
+        return;
+    s_reached[milestone] = true;
+    kDebug() << "Startup:" << s_milestoneNames[milestone] << "after" << s_startTime.elapsed() << "ms";
+}
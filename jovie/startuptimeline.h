@@ -0,0 +1,53 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Logs how long the steps of starting Jovie take.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef STARTUPTIMELINE_H
+#define STARTUPTIMELINE_H
+
+/**
+ * Jovie is started at login, so the time it takes to become usable matters.
+ * The startup timeline logs the time from the start of main() to each of the
+ * milestones of starting up, once per milestone.
+ */
+namespace StartupTimeline
+{
+    enum Milestone
+    {
+        DBusRegistered,     /* /KSpeech accepts calls */
+        SpeechdReady,       /* the connection to speech-dispatcher is open */
+        FiltersLoaded,      /* the filter plugins are loaded */
+        FirstUtterance,     /* the first text was handed to speech-dispatcher */
+        MilestoneCount
+    };
+
+    /**
+     * Starts the timeline.  Called at the start of main().
+     */
+    void start();
+
+    /**
+     * Logs the time to a milestone, if it has not been reached before.
+     */
+    void reached(Milestone milestone);
+}
+
+#endif // STARTUPTIMELINE_H
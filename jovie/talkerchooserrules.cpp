@@ -0,0 +1,221 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Combined rules of all the Talker Chooser filters.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// TalkerChooserRules includes.
+#include "talkerchooserrules.h"
+
+// Qt includes.
+#include <QtCore/QStringList>
+#include <QtCore/QtAlgorithms>
+
+/* Most applications send from a few appIds, but D-Bus unique names are
+   never reused, so the per appId rules are dropped once there are many. */
+static const int MaxAppIds = 256;
+
+TalkerChooserRules::TalkerChooserRules()
+{
+}
+
+void TalkerChooserRules::clear()
+{
+    m_rules.clear();
+    m_regExps.clear();
+    m_appRules.clear();
+}
+
+void TalkerChooserRules::append(const TalkerChooserRule &rule)
+{
+    m_rules.append(rule);
+    m_regExps.append(QRegExp(rule.matchRegExp));
+    m_appRules.clear();
+}
+
+int TalkerChooserRules::count() const
+{
+    return m_rules.count();
+}
+
+bool TalkerChooserRules::isEmpty() const
+{
+    return m_rules.isEmpty();
+}
+
+const TalkerChooserRule &TalkerChooserRules::at(int ndx) const
+{
+    return m_rules.at(ndx);
+}
+
+bool TalkerChooserRules::appliesToApp(int ndx, const QString &appId) const
+{
+    const QStringList &appIds = m_rules.at(ndx).appIds;
+    if (appIds.isEmpty())
+        return true;
+    foreach (const QString &id, appIds)
+    {
+        if (appId.contains(id))
+            return true;
+    }
+    return false;
+}
+
+TalkerChooserRules::AppRules &TalkerChooserRules::appRules(const QString &appId) const
+{
+    QHash<QString, AppRules>::iterator it = m_appRules.find(appId);
+    if (it != m_appRules.end())
+        return it.value();
+
+    if (m_appRules.count() >= MaxAppIds)
+        m_appRules.clear();
+
+    // Back references would refer to the wrong group once joined with other patterns.
+    static const QRegExp backReference(QLatin1String("\\\\[1-9]"));
+
+    AppRules app;
+    const int rulesCount = m_rules.count();
+    for (int ndx = 0; ndx < rulesCount; ++ndx)
+    {
+        if (!appliesToApp(ndx, appId))
+            continue;
+        const QString &pattern = m_rules.at(ndx).matchRegExp;
+        if (pattern.isEmpty())
+        {
+            // Every rule before this one loses to it.
+            app.fixedWinner = ndx;
+            app.joinable.clear();
+            app.separate.clear();
+        }
+        // An invalid expression never matches, as when the filter ran on its own.
+        else if (m_regExps.at(ndx).isValid())
+        {
+            if (pattern.contains(backReference))
+                app.separate.append(ndx);
+            else
+                app.joinable.append(ndx);
+        }
+    }
+    return m_appRules.insert(appId, app).value();
+}
+
+const TalkerChooserRules::Alternation &TalkerChooserRules::alternation(AppRules &app, int first) const
+{
+    QHash<int, Alternation>::iterator it = app.alternations.find(first);
+    if (it != app.alternations.end())
+        return it.value();
+
+    Alternation alt;
+    QStringList patterns;
+    int group = 1;
+    const int joinableCount = app.joinable.count();
+    for (int i = first; i < joinableCount; ++i)
+    {
+        const int ndx = app.joinable.at(i);
+        patterns.append(QLatin1Char('(') + m_rules.at(ndx).matchRegExp + QLatin1Char(')'));
+        alt.rules.append(ndx);
+        alt.groups.append(group);
+        group += 1 + m_regExps.at(ndx).captureCount();
+    }
+    alt.regExp = QRegExp(patterns.join(QLatin1String("|")));
+    return app.alternations.insert(first, alt).value();
+}
+
+int TalkerChooserRules::match(const QString &text, const QString &appId, QString *reason) const
+{
+    if (m_rules.isEmpty())
+    {
+        if (reason)
+            *reason = QLatin1String("there are no rules");
+        return -1;
+    }
+
+    AppRules &app = appRules(appId);
+    int winner = app.fixedWinner;
+    int matchPos = -1;
+
+    // The alternation reports one of the rules that match.  Whether it is the
+    // last one depends on where and how long the matches are, so look again
+    // among the rules after it until none of them matches.
+    int first = 0;
+    while (first < app.joinable.count())
+    {
+        const Alternation &alt = alternation(app, first);
+        const int pos = alt.regExp.indexIn(text);
+        if (pos < 0)
+            break;
+        int found = -1;
+        const int altCount = alt.rules.count();
+        for (int i = 0; i < altCount; ++i)
+        {
+            if (alt.regExp.pos(alt.groups.at(i)) >= 0)
+            {
+                found = alt.rules.at(i);
+                break;
+            }
+        }
+        if (found < 0)
+            break;
+        winner = found;
+        matchPos = pos;
+        first = qUpperBound(app.joinable.constBegin(), app.joinable.constEnd(), found)
+            - app.joinable.constBegin();
+    }
+
+    for (int i = app.separate.count() - 1; i >= 0; --i)
+    {
+        const int ndx = app.separate.at(i);
+        if (ndx <= winner)
+            break;
+        const int pos = m_regExps.at(ndx).indexIn(text);
+        if (pos >= 0)
+        {
+            winner = ndx;
+            matchPos = pos;
+            break;
+        }
+    }
+
+    if (reason)
+    {
+        if (winner < 0)
+        {
+            *reason = QLatin1String("no rule applies");
+            return winner;
+        }
+        const TalkerChooserRule &rule = m_rules.at(winner);
+        QStringList why;
+        if (!rule.matchRegExp.isEmpty())
+            why.append(QString(QLatin1String("text matches \"%1\" at %2"))
+                .arg(rule.matchRegExp).arg(matchPos));
+        foreach (const QString &id, rule.appIds)
+        {
+            if (appId.contains(id))
+            {
+                why.append(QString(QLatin1String("appId \"%1\" contains \"%2\"")).arg(appId).arg(id));
+                break;
+            }
+        }
+        if (why.isEmpty())
+            why.append(QLatin1String("rule has no conditions"));
+        *reason = QString(QLatin1String("rule %1 (%2): %3"))
+            .arg(winner).arg(rule.name).arg(why.join(QLatin1String(", ")));
+    }
+    return winner;
+}
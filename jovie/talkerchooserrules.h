@@ -0,0 +1,110 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Combined rules of all the Talker Chooser filters.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef TALKERCHOOSERRULES_H
+#define TALKERCHOOSERRULES_H
+
+// Qt includes.
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QRegExp>
+#include <QtCore/QVector>
+
+// KTTS includes.
+#include "talkerchooserrule.h"
+
+/**
+ * @class TalkerChooserRules
+ *
+ * The rules of all the Talker Chooser filters, in filter order.
+ *
+ * When several rules apply to a text, the last one wins, just as when each
+ * filter ran in turn and overwrote the talker of the one before.
+ *
+ * Rules are compiled per appId the first time the appId is seen.  Rules whose
+ * appIds do not match are dropped, rules without a regular expression are
+ * resolved right away, and the regular expressions of the remaining rules are
+ * joined into one alternation, so the text is scanned once for all of them.
+ */
+class TalkerChooserRules
+{
+public:
+    TalkerChooserRules();
+
+    /**
+     * Removes all rules.
+     */
+    void clear();
+
+    /**
+     * Appends a rule.  It wins over the rules already added.
+     */
+    void append(const TalkerChooserRule &rule);
+
+    int count() const;
+    bool isEmpty() const;
+    const TalkerChooserRule &at(int ndx) const;
+
+    /**
+     * Finds the rule that chooses the talker for a text.
+     * @param text              The text to be spoken.
+     * @param appId             The D-Bus appId of the application that queued the text.
+     * @param reason            If not null, receives why the rule applies.
+     * @return                  Index of the winning rule.  -1 if no rule applies.
+     */
+    int match(const QString &text, const QString &appId, QString *reason = 0) const;
+
+private:
+    // Regular expressions of several rules, joined into one.
+    struct Alternation
+    {
+        QRegExp regExp;
+        // Rule and capture group of each alternative.
+        QVector<int> rules;
+        QVector<int> groups;
+    };
+
+    // The rules as they apply to one appId.
+    struct AppRules
+    {
+        AppRules() : fixedWinner(-1) {}
+        // Last applicable rule without a regular expression.
+        int fixedWinner;
+        // Applicable rules after fixedWinner that can be joined, in order.
+        QVector<int> joinable;
+        // Alternations of joinable.mid(i), built when needed.
+        QHash<int, Alternation> alternations;
+        // Applicable rules after fixedWinner that must be matched on their own.
+        QVector<int> separate;
+    };
+
+    bool appliesToApp(int ndx, const QString &appId) const;
+    AppRules &appRules(const QString &appId) const;
+    const Alternation &alternation(AppRules &app, int first) const;
+
+    QList<TalkerChooserRule> m_rules;
+    // Compiled regular expression of each rule.
+    QVector<QRegExp> m_regExps;
+    mutable QHash<QString, AppRules> m_appRules;
+};
+
+#endif      // TALKERCHOOSERRULES_H
@@ -59,56 +59,15 @@ TalkerMgr::~TalkerMgr()
 }
 
 /**
- * load the talkers from the given config object
- * @param c              KConfig object to read configured talkers from
+ * load the talkers from a configuration snapshot
+ * @param config         Snapshot to take the configured talkers from
  */
-void TalkerMgr::loadTalkers(KConfig* c)
+void TalkerMgr::loadTalkers(const ConfigSnapshotPtr& config)
 {
-    m_loadedTalkerCodes.clear();
-    m_loadedTalkerIds.clear();
-    KConfigGroup config(c, "General");
-    QStringList talkerIDsList = config.readEntry("TalkerIDs", QStringList());
-    if (!talkerIDsList.isEmpty())
-    {
-        QStringList::ConstIterator itEnd(talkerIDsList.constEnd());
-        for( QStringList::ConstIterator it = talkerIDsList.constBegin(); it != itEnd; ++it )
-        {
-            // kDebug() << "Loading plugInProc for Talker ID " << *it;
-
-            // Talker ID.
-            QString talkerID = *it;
-
-            // Set the group for the talker to load
-            KConfigGroup talkerConfig(c, "Talkers");
-
-            // Get the DesktopEntryName of the plugin we will try to load.
-            //QString desktopEntryName = talkerConfig.readEntry("DesktopEntryName", QString());
-
-//            // If a DesktopEntryName is not in the config file, it was configured before
-//            // we started using them, when we stored translated plugin names instead.
-//            // Try to convert the translated plugin name to a DesktopEntryName.
-//            // DesktopEntryNames are better because user can change their desktop language
-//            // and DesktopEntryName won't change.
-//            if (desktopEntryName.isEmpty())
-//            {
-//                QString synthName = talkerConfig.readEntry("PlugIn", QString());
-//                // See if the translated name will untranslate.  If not, well, sorry.
-//                desktopEntryName = TalkerCode::TalkerNameToDesktopEntryName(synthName);
-//                // Record the DesktopEntryName from now on.
-//                if (!desktopEntryName.isEmpty()) talkerConfig.writeEntry("DesktopEntryName", desktopEntryName);
-//            }
-
-            // Get the talker code.
-            QString talkerCode = talkerConfig.readEntry(talkerID, QString());
-
-            // Normalize the talker code.
-            //QString fullLanguageCode;
-            //talkerCode = TalkerCode::normalizeTalkerCode(talkerCode, fullLanguageCode);
-
-            m_loadedTalkerCodes.append(TalkerCode(talkerCode));
-            m_loadedTalkerIds.append(talkerID);
-        }
-    }
+    m_loadedTalkerCodes = config->talkers();
+    m_loadedTalkerIds = config->talkerIds();
+    m_talkerToTalkerIndexCache.clear();
+    m_matcher.setTalkers(m_loadedTalkerCodes);
 }
 
 
@@ -239,10 +198,8 @@ void TalkerMgr::loadTalkers(KConfig* c)
 QStringList TalkerMgr::getTalkers()
 {
     QStringList talkerList;
-    //for (int ndx = 0; ndx < int(m_loadedPlugIns.count()); ++ndx)
-    //{
-    //    talkerList.append(m_loadedTalkerCodes[ndx].getTalkerCode());
-    //}
+    foreach (const TalkerCode &talkerCode, m_loadedTalkerCodes)
+        talkerList.append(talkerCode.getTalkerCode());
     return talkerList;
 }
 
@@ -276,6 +233,23 @@ QStringList TalkerMgr::getTalkers()
 //    }
 //}
 
+/**
+ * Given a talker code, returns the index of the closest matching loaded talker.
+ * @param talker          The talker (language) code.
+ * @return                Index into m_loadedTalkerCodes.  -1 if no talkers are loaded.
+ */
+int TalkerMgr::talkerToTalkerIndex(const QString& talker)
+{
+    // If we have a cached match, return that.
+    QHash<QString, int>::const_iterator it = m_talkerToTalkerIndexCache.constFind(talker);
+    if (it != m_talkerToTalkerIndexCache.constEnd())
+        return it.value();
+    int winner = m_matcher.findClosest(talker, true);
+    if (winner >= 0)
+        m_talkerToTalkerIndexCache.insert(talker, winner);
+    return winner;
+}
+
 /**
  * Given a talker code, returns pointer to the closest matching plugin.
  * @param talker          The talker (language) code.
@@ -312,9 +286,10 @@ QStringList TalkerMgr::getTalkers()
  */
 TalkerCode* TalkerMgr::talkerToTalkerCode(const QString& talker)
 {
-//    int talkerNdx = talkerToPluginIndex(talker);
-//    return new TalkerCode(&m_loadedTalkerCodes[talkerNdx]);
-      return NULL;
+    int talkerNdx = talkerToTalkerIndex(talker);
+    if (talkerNdx < 0)
+        return NULL;
+    return new TalkerCode(m_loadedTalkerCodes[talkerNdx]);
 }
 
 /**
@@ -325,9 +300,10 @@ TalkerCode* TalkerMgr::talkerToTalkerCode(const QString& talker)
  */
 QString TalkerMgr::talkerCodeToTalkerId(const QString& talkerCode)
 {
-//    int talkerNdx = talkerToPluginIndex(talkerCode);
-//    return m_loadedTalkerIds[talkerNdx];
-    return QString();
+    int talkerNdx = talkerToTalkerIndex(talkerCode);
+    if (talkerNdx < 0)
+        return QString();
+    return m_loadedTalkerIds[talkerNdx];
 }
 
 /**
@@ -339,6 +315,8 @@ QString TalkerMgr::talkerCodeToTalkerId(const QString& talkerCode)
  */
 QString TalkerMgr::userDefaultTalker() const
 {
+    if (m_loadedTalkerCodes.isEmpty())
+        return QString();
     return m_loadedTalkerCodes[0].getTalkerCode();
 }
 
@@ -25,6 +25,7 @@
 #define TALKERMGR_H
 
 // Qt includes.
+#include <QtCore/QHash>
 #include <QtCore/QMap>
 #include <QtCore/QList>
 #include <QtCore/QStringList>
@@ -35,6 +36,8 @@
 
 // KTTS includes.
 #include "talkercode.h"
+#include "talkermatcher.h"
+#include "jovieconfig.h"
 
 /**
  * @class TalkerMgr
@@ -66,10 +69,10 @@ public:
     QStringList getTalkers();
 
     /**
-     * load the talkers from the given config object
-     * @param c              KConfig object to read configured talkers from
+     * load the talkers from a configuration snapshot
+     * @param config         Snapshot to take the configured talkers from
      */
-    void loadTalkers(KConfig* c);
+    void loadTalkers(const ConfigSnapshotPtr& config);
 
     /**
      * Given a talker code, returns the parsed TalkerCode of the closest matching Talker.
@@ -119,6 +122,13 @@ private:
      */
     explicit TalkerMgr(QObject *parent = 0);
 
+    /**
+     * Given a talker code, returns the index of the closest matching loaded talker.
+     * @param talker          The talker (language) code.
+     * @return                Index into m_loadedTalkerCodes.  -1 if no talkers are loaded.
+     */
+    int talkerToTalkerIndex(const QString& talker);
+
     /**
      * Array of the loaded plug ins for different Talkers.
      * Array of parsed Talker Codes for the plugins.
@@ -126,6 +136,16 @@ private:
     QStringList m_loadedTalkerIds;
     TalkerCode::TalkerCodeList m_loadedTalkerCodes;
 
+    /**
+     * Index of the loaded talkers for matching requested talkers.
+     */
+    TalkerMatcher m_matcher;
+
+    /**
+     * Cache of requested talker codes to index of the matching talker.
+     */
+    QHash<QString, int> m_talkerToTalkerIndexCache;
+
     static TalkerMgr * m_instance;
 };
 
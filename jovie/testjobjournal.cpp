@@ -0,0 +1,122 @@
+#include <QtTest>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include "testjobjournal.h"
+#include "jobjournal.h"
+
+static JobJournal::Job job(int jobNum, const QString &text)
+{
+    JobJournal::Job job;
+    job.jobNum = jobNum;
+    job.appId = QLatin1String("org.kde.jovie.test");
+    job.priority = 4;
+    job.options = 1;
+    job.text = text;
+    return job;
+}
+
+void TestJobJournal::init()
+{
+    m_path = QDir::temp().filePath(QString::fromAscii("jovie-test-journal-%1").arg(QCoreApplication::applicationPid()));
+    QFile::remove(m_path);
+}
+
+void TestJobJournal::cleanup()
+{
+    QFile::remove(m_path);
+}
+
+void TestJobJournal::recover()
+{
+    {
+        JobJournal journal;
+        QVERIFY(journal.open(m_path));
+        QVERIFY(journal.recovered().isEmpty());
+        journal.accept(job(1, QString::fromAscii("First. Second. Third.")));
+        journal.accept(job(2, QString::fromAscii("Ended")));
+        journal.progress(1, 2);
+        journal.end(2);
+        // Destroyed without discard(), as in a crash.
+    }
+    {
+        JobJournal journal;
+        QVERIFY(journal.open(m_path));
+        const QList<JobJournal::Job> recovered = journal.recovered();
+        QCOMPARE(recovered.count(), 1);
+        QCOMPARE(recovered.at(0).jobNum, -1);
+        QCOMPARE(recovered.at(0).appId, QLatin1String("org.kde.jovie.test"));
+        QCOMPARE(recovered.at(0).priority, 4);
+        QCOMPARE(recovered.at(0).options, 1);
+        QCOMPARE(recovered.at(0).text, QString::fromAscii("First. Second. Third."));
+        QCOMPARE(recovered.at(0).sentences, 2);
+        // A job of the new run, then a crash before the recovered one was queued again.
+        journal.accept(job(1, QString::fromAscii("New")));
+    }
+
+    // Recovered jobs are kept until they are ended, and come before the newer ones.
+    JobJournal journal;
+    QVERIFY(journal.open(m_path));
+    QList<JobJournal::Job> recovered = journal.recovered();
+    QCOMPARE(recovered.count(), 2);
+    QCOMPARE(recovered.at(0).jobNum, -1);
+    QCOMPARE(recovered.at(0).text, QString::fromAscii("First. Second. Third."));
+    QCOMPARE(recovered.at(0).sentences, 2);
+    QCOMPARE(recovered.at(1).jobNum, -2);
+    QCOMPARE(recovered.at(1).text, QString::fromAscii("New"));
+    journal.end(-1);
+    journal.end(-2);
+    QVERIFY(journal.recovered().isEmpty());
+    JobJournal again;
+    QVERIFY(again.open(m_path));
+    QVERIFY(again.recovered().isEmpty());
+}
+
+void TestJobJournal::tornRecord()
+{
+    {
+        JobJournal journal;
+        QVERIFY(journal.open(m_path));
+        journal.accept(job(1, QString::fromAscii("Whole")));
+        journal.accept(job(2, QString::fromAscii("Torn")));
+    }
+    // Damage the last record, as a crash in the middle of writing it would.
+    QFile file(m_path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QByteArray data = file.readAll();
+    // The last byte written is the end of the text of the last record.
+    int torn = data.size() - 1;
+    while (torn > 0 && data.at(torn) == 0)
+        --torn;
+    QVERIFY(torn > 0);
+    data[torn] = 'X';
+    QVERIFY(file.seek(0));
+    file.write(data);
+    file.close();
+
+    JobJournal journal;
+    QVERIFY(journal.open(m_path));
+    const QList<JobJournal::Job> recovered = journal.recovered();
+    QCOMPARE(recovered.count(), 1);
+    QCOMPARE(recovered.at(0).text, QString::fromAscii("Whole"));
+}
+
+void TestJobJournal::compaction()
+{
+    JobJournal journal;
+    QVERIFY(journal.open(m_path));
+    const QString text(4096, QLatin1Char('x'));
+    journal.accept(job(1, QString::fromAscii("Kept")));
+    for (int jobNum = 2; jobNum < 1000; ++jobNum)
+    {
+        journal.accept(job(jobNum, text));
+        journal.end(jobNum);
+    }
+    // A thousand jobs of 8 KiB went through, but the file only grew to a
+    // few times the size of the one job left.
+    QVERIFY(QFileInfo(m_path).size() < 1024 * 1024);
+    QVERIFY(journal.contains(1));
+}
+
+QTEST_MAIN(TestJobJournal)
+#include "testjobjournal.moc"
@@ -0,0 +1,22 @@
+#ifndef TESTJOBJOURNAL_H
+#define TESTJOBJOURNAL_H
+
+#include <QObject>
+#include <QString>
+
+class TestJobJournal : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void recover();
+    void tornRecord();
+    void compaction();
+
+private:
+    QString m_path;
+};
+
+#endif // TESTJOBJOURNAL_H
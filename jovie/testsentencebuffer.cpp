@@ -0,0 +1,52 @@
+#include <QtTest>
+
+#include "sentencebuffer.h"
+#include "testsentencebuffer.h"
+
+// The default sentence delimiter of AppData.
+static const char delimiter[] = "([\\.\\?\\!\\:\\;])(\\s|$|(\\n *\\n))";
+
+void TestSentenceBuffer::split()
+{
+    const SentenceBuffer sentences(QString::fromAscii("  One,\ttwo.  Three\nlines?\n\n\nFour!"),
+        QRegExp(QLatin1String(delimiter)));
+    QCOMPARE(sentences.count(), 3);
+    QCOMPARE(sentences.sentence(0).toString(), QString::fromAscii("One, two."));
+    QCOMPARE(sentences.sentence(1).toString(), QString::fromAscii("Three lines?"));
+    QCOMPARE(sentences.sentence(2).toString(), QString::fromAscii("Four!"));
+    QVERIFY(sentences.sentence(3).isNull());
+
+    QVERIFY(SentenceBuffer(QString::fromAscii(" \n \n"), QRegExp(QLatin1String(delimiter))).isEmpty());
+    QCOMPARE(SentenceBuffer(QString::fromAscii("No end"), QRegExp(QLatin1String(delimiter))).count(), 1);
+}
+
+void TestSentenceBuffer::text()
+{
+    const SentenceBuffer sentences(QString::fromAscii("First. Second. Third."), QRegExp(QLatin1String(delimiter)));
+    QCOMPARE(sentences.text(), QString::fromAscii("First. Second. Third."));
+    QCOMPARE(sentences.text(1), QString::fromAscii("Second. Third."));
+    QVERIFY(sentences.text(3).isEmpty());
+
+    const QString ssml = QString::fromAscii("<speak>One. Two.</speak>");
+    QCOMPARE(SentenceBuffer(ssml).count(), 1);
+    QCOMPARE(SentenceBuffer(ssml).sentence(0).toString(), ssml);
+}
+
+void TestSentenceBuffer::benchmarkSplit()
+{
+    // About a megabyte: 20000 sentences of 50 characters.
+    QString book;
+    for (int i = 0; i < 20000; ++i)
+        book += QString::fromAscii("This is sentence number %1 of a rather long book. ").arg(i, 5);
+    const QRegExp rx(QLatin1String(delimiter));
+    SentenceBuffer sentences;
+    QBENCHMARK {
+        sentences = SentenceBuffer(book, rx);
+    }
+    QCOMPARE(sentences.count(), 20000);
+    // Two bytes a character and a few a sentence.
+    QVERIFY(sentences.memoryUsage() < qint64(book.length()) * 2 + 20000 * 8);
+}
+
+QTEST_MAIN(TestSentenceBuffer)
+#include "testsentencebuffer.moc"
@@ -0,0 +1,16 @@
+#ifndef TESTSENTENCEBUFFER_H
+#define TESTSENTENCEBUFFER_H
+
+#include <QObject>
+
+class TestSentenceBuffer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void split();
+    void text();
+    void benchmarkSplit();
+};
+
+#endif // TESTSENTENCEBUFFER_H
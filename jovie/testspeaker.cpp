@@ -0,0 +1,387 @@
+#include <QtTest>
+#include <QtCore/QDir>
+#include <QtCore/QTime>
+
+#include <kconfig.h>
+#include <kconfiggroup.h>
+#include <qtest_kde.h>
+
+#include "testspeaker.h"
+#include "mockspeechd.h"
+#include "speaker.h"
+#include "jovieconfig.h"
+
+static const char appId[] = "org.kde.jovie.test";
+static const char otherAppId[] = "org.kde.jovie.test2";
+
+bool TestSpeaker::waitForState(int jobNum, KSpeech::JobState state, int timeout)
+{
+    QTime time;
+    time.start();
+    while (time.elapsed() < timeout)
+    {
+        const JobRegistry::Job *job = Speaker::Instance()->jobRegistry()->job(jobNum);
+        if (job && job->state == state)
+            return true;
+        QTest::qWait(10);
+    }
+    return false;
+}
+
+void TestSpeaker::setScheduler(bool on, int lookahead)
+{
+    KConfig config(QLatin1String("kttsdrc"));
+    KConfigGroup generalConfig(&config, "General");
+    generalConfig.writeEntry("Scheduler", on);
+    generalConfig.writeEntry("SchedulerLookahead", lookahead);
+    config.sync();
+    JovieConfig::Instance()->refresh();
+    QCOMPARE(JovieConfig::Instance()->snapshot()->scheduler(), on);
+}
+
+void TestSpeaker::initTestCase()
+{
+    m_speechd = new MockSpeechd(this);
+    const QString path = QDir::temp().filePath(
+        QString::fromAscii("jovie-test-speechd-%1").arg(QCoreApplication::applicationPid()));
+    QVERIFY(m_speechd->listen(path));
+    qputenv("SPEECHD_ADDRESS", m_speechd->address());
+
+    KConfig config(QLatin1String("kttsdrc"));
+    KConfigGroup generalConfig(&config, "General");
+    generalConfig.writeEntry("NativeSsip", true);
+    config.sync();
+    JovieConfig::Instance()->refresh();
+
+    Speaker *speaker = Speaker::Instance();
+    for (int i = 0; i < 500 && speaker->isConnecting(); ++i)
+        QTest::qWait(10);
+    QVERIFY(!speaker->isConnecting());
+    speaker->getAppData(QLatin1String(appId))->setFilteringOn(false);
+    speaker->getAppData(QLatin1String(otherAppId))->setFilteringOn(false);
+
+    // libspeechd and the SSIP client both connected.
+    bool native = false;
+    for (int i = 0; i < 300 && !native; ++i)
+    {
+        foreach (const QByteArray &command, m_speechd->commands())
+            native = native || (command.startsWith("SET self CLIENT_NAME") && command.endsWith(":jovie:native"));
+        if (!native)
+            QTest::qWait(10);
+    }
+    QVERIFY(native);
+}
+
+void TestSpeaker::cleanupTestCase()
+{
+    delete Speaker::Instance();
+}
+
+void TestSpeaker::init()
+{
+    m_speechd->setSpeakingDuration(10);
+    m_speechd->setReplyDelay(0);
+    m_speechd->setError(QByteArray(), QByteArray());
+}
+
+void TestSpeaker::say()
+{
+    const int messages = m_speechd->messages().count();
+    const int jobNum = Speaker::Instance()->say(QLatin1String(appId),
+        QString::fromAscii("First sentence. Second sentence."), KSpeech::soPlainText);
+    QVERIFY(jobNum > 0);
+    QVERIFY(waitForState(jobNum, KSpeech::jsFinished));
+
+    QCOMPARE(m_speechd->messages().mid(messages),
+        QList<QByteArray>() << "First sentence." << "Second sentence.");
+    QVERIFY(m_speechd->commands().contains("BLOCK BEGIN"));
+    QVERIFY(m_speechd->commands().contains("SET self PRIORITY text"));
+    const JobRegistry *registry = Speaker::Instance()->jobRegistry();
+    QCOMPARE(registry->appId(*registry->job(jobNum)), QLatin1String(appId));
+}
+
+void TestSpeaker::cancel()
+{
+    m_speechd->setSpeakingDuration(5000);
+    const int jobNum = Speaker::Instance()->say(QLatin1String(appId),
+        QString::fromAscii("A long message"), KSpeech::soPlainText);
+    QVERIFY(waitForState(jobNum, KSpeech::jsSpeaking));
+    Speaker::Instance()->cancel();
+    QVERIFY(waitForState(jobNum, KSpeech::jsDeleted));
+    QCOMPARE(m_speechd->queuedCount(), 0);
+}
+
+void TestSpeaker::pauseResume()
+{
+    m_speechd->setSpeakingDuration(300);
+    const int jobNum = Speaker::Instance()->say(QLatin1String(appId),
+        QString::fromAscii("Paused for a while"), KSpeech::soPlainText);
+    QVERIFY(waitForState(jobNum, KSpeech::jsSpeaking));
+    Speaker::Instance()->pause();
+    QVERIFY(waitForState(jobNum, KSpeech::jsPaused));
+    Speaker::Instance()->resume();
+    QVERIFY(waitForState(jobNum, KSpeech::jsSpeaking));
+    QVERIFY(waitForState(jobNum, KSpeech::jsFinished));
+}
+
+void TestSpeaker::slowReplies()
+{
+    m_speechd->setReplyDelay(500);
+    QTime time;
+    time.start();
+    const int jobNum = Speaker::Instance()->say(QLatin1String(appId),
+        QString::fromAscii("Not waited for"), KSpeech::soPlainText);
+    // say() does not wait for speech-dispatcher.
+    QVERIFY(time.elapsed() < 250);
+    QVERIFY(waitForState(jobNum, KSpeech::jsFinished));
+}
+
+void TestSpeaker::refusedKey()
+{
+    m_speechd->setError("KEY", "410 ERR UNKNOWN KEY\r\n");
+    const int jobNum = Speaker::Instance()->say(QLatin1String(appId),
+        QString::fromAscii("nokey"), KSpeech::soKey);
+    QVERIFY(waitForState(jobNum, KSpeech::jsDeleted));
+}
+
+void TestSpeaker::benchmarkThroughput()
+{
+    m_speechd->setSpeakingDuration(0);
+    const int count = 200;
+    int jobNum = 0;
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < count; ++i)
+            jobNum = Speaker::Instance()->say(QLatin1String(appId),
+                QString::fromAscii("Message %1.").arg(i), KSpeech::soPlainText);
+        QVERIFY(waitForState(jobNum, KSpeech::jsFinished, 10000));
+    }
+}
+
+void TestSpeaker::schedulerFairness()
+{
+    setScheduler(true, 1);
+    m_speechd->setSpeakingDuration(20);
+    const int messages = m_speechd->messages().count();
+    for (int i = 0; i < 6; ++i)
+        Speaker::Instance()->say(QLatin1String(appId), QString::fromAscii("Flood %1").arg(i), KSpeech::soPlainText);
+    const int jobNum = Speaker::Instance()->say(QLatin1String(otherAppId),
+        QString::fromAscii("Other"), KSpeech::soPlainText);
+    QVERIFY(waitForState(jobNum, KSpeech::jsFinished));
+
+    // Without the scheduler it would have come last.  With it, the other
+    // application overtook the flood right after the job in flight.
+    QCOMPARE(m_speechd->messages().mid(messages).indexOf("Other"), 1);
+    QVERIFY(waitForState(jobNum - 1, KSpeech::jsFinished));
+    setScheduler(false, 1);
+}
+
+void TestSpeaker::rateLimit()
+{
+    AppData *appData = Speaker::Instance()->getAppData(QLatin1String(otherAppId));
+    appData->setRateLimit(1, 2);
+    QSignalSpy spy(Speaker::Instance(), SIGNAL(backpressure(QString,bool)));
+    QVERIFY(Speaker::Instance()->say(QLatin1String(otherAppId), QString::fromAscii("One"), KSpeech::soPlainText) > 0);
+    QVERIFY(Speaker::Instance()->say(QLatin1String(otherAppId), QString::fromAscii("Two"), KSpeech::soPlainText) > 0);
+    QCOMPARE(Speaker::Instance()->say(QLatin1String(otherAppId), QString::fromAscii("Three"), KSpeech::soPlainText), -1);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toString(), QLatin1String(otherAppId));
+    QCOMPARE(spy.at(0).at(1).toBool(), true);
+
+    // Other applications are not limited.
+    QVERIFY(Speaker::Instance()->say(QLatin1String(appId), QString::fromAscii("Mine"), KSpeech::soPlainText) > 0);
+
+    // The bucket refills.
+    QTest::qWait(1100);
+    QVERIFY(Speaker::Instance()->say(QLatin1String(otherAppId), QString::fromAscii("Four"), KSpeech::soPlainText) > 0);
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(spy.at(1).at(1).toBool(), false);
+    appData->setRateLimit(0, 0);
+}
+
+void TestSpeaker::supersede()
+{
+    AppData *appData = Speaker::Instance()->getAppData(QLatin1String(otherAppId));
+    appData->setDefaultPriority(KSpeech::jpProgress);
+
+    // The job speaking is stopped, and nothing else of the application.
+    m_speechd->setSpeakingDuration(5000);
+    const int first = Speaker::Instance()->say(QLatin1String(otherAppId),
+        QString::fromAscii("40 percent"), KSpeech::soPlainText);
+    QVERIFY(waitForState(first, KSpeech::jsSpeaking));
+    m_speechd->setSpeakingDuration(10);
+    const int second = Speaker::Instance()->say(QLatin1String(otherAppId),
+        QString::fromAscii("50 percent"), KSpeech::soPlainText);
+    QVERIFY(waitForState(first, KSpeech::jsDeleted));
+    QVERIFY(waitForState(second, KSpeech::jsFinished));
+
+    // Every sentence of a job is cut off, not just the one speaking.
+    m_speechd->setSpeakingDuration(300);
+    const int spoken = m_speechd->spokenCount();
+    const int steps = Speaker::Instance()->say(QLatin1String(otherAppId),
+        QString::fromAscii("Step one. Step two. Step three."), KSpeech::soPlainText);
+    QVERIFY(waitForState(steps, KSpeech::jsSpeaking));
+    m_speechd->setSpeakingDuration(10);
+    const int lastStep = Speaker::Instance()->say(QLatin1String(otherAppId),
+        QString::fromAscii("Step four."), KSpeech::soPlainText);
+    QVERIFY(waitForState(steps, KSpeech::jsDeleted));
+    QVERIFY(waitForState(lastStep, KSpeech::jsFinished));
+    QCOMPARE(m_speechd->spokenCount() - spoken, 1);
+
+    // With another job queued behind, which must be kept, each sentence is
+    // stopped as it begins.
+    m_speechd->setSpeakingDuration(300);
+    const int spokenBehind = m_speechd->spokenCount();
+    const int parts = Speaker::Instance()->say(QLatin1String(otherAppId),
+        QString::fromAscii("Part one. Part two. Part three."), KSpeech::soPlainText);
+    QVERIFY(waitForState(parts, KSpeech::jsSpeaking));
+    const int behind = Speaker::Instance()->say(QLatin1String(appId),
+        QString::fromAscii("b"), KSpeech::soKey);
+    const int lastPart = Speaker::Instance()->say(QLatin1String(otherAppId),
+        QString::fromAscii("Part four."), KSpeech::soPlainText);
+    QVERIFY(waitForState(parts, KSpeech::jsDeleted));
+    QVERIFY(waitForState(behind, KSpeech::jsFinished));
+    QVERIFY(waitForState(lastPart, KSpeech::jsFinished));
+    QCOMPARE(m_speechd->spokenCount() - spokenBehind, 2);
+
+    // With the scheduler, a job still waiting is dropped before it is filtered.
+    setScheduler(true, 1);
+    m_speechd->setSpeakingDuration(300);
+    const int blocking = Speaker::Instance()->say(QLatin1String(appId),
+        QString::fromAscii("In the way"), KSpeech::soPlainText);
+    const int waiting = Speaker::Instance()->say(QLatin1String(otherAppId),
+        QString::fromAscii("60 percent"), KSpeech::soPlainText);
+    const int latest = Speaker::Instance()->say(QLatin1String(otherAppId),
+        QString::fromAscii("70 percent"), KSpeech::soPlainText);
+    QCOMPARE(Speaker::Instance()->jobRegistry()->job(waiting)->state, KSpeech::jsDeleted);
+    QVERIFY(waitForState(blocking, KSpeech::jsFinished));
+    QVERIFY(waitForState(latest, KSpeech::jsFinished));
+    QVERIFY(!m_speechd->messages().contains("60 percent"));
+    setScheduler(false, 1);
+    appData->setDefaultPriority(KSpeech::jpMessage);
+}
+
+void TestSpeaker::duplicates()
+{
+    const int messages = m_speechd->messages().count();
+    const int jobNum = Speaker::Instance()->say(QLatin1String(appId),
+        QString::fromAscii("New mail"), KSpeech::soPlainText);
+    QVERIFY(jobNum > 0);
+    // Repeats are answered with the first job, whatever their case and spacing.
+    QCOMPARE(Speaker::Instance()->say(QLatin1String(appId),
+        QString::fromAscii(" new  MAIL"), KSpeech::soPlainText), jobNum);
+    // The same text from another application is spoken.
+    const int otherJobNum = Speaker::Instance()->say(QLatin1String(otherAppId),
+        QString::fromAscii("New mail"), KSpeech::soPlainText);
+    QVERIFY(otherJobNum > 0 && otherJobNum != jobNum);
+    // Keys typed twice are.
+    const int keyJobNum = Speaker::Instance()->say(QLatin1String(appId), QString::fromAscii("a"), KSpeech::soKey);
+    QVERIFY(Speaker::Instance()->say(QLatin1String(appId), QString::fromAscii("a"), KSpeech::soKey) != keyJobNum);
+    QVERIFY(waitForState(otherJobNum, KSpeech::jsFinished));
+    QCOMPARE(m_speechd->messages().mid(messages).count("New mail"), 2);
+}
+
+void TestSpeaker::departedApplication()
+{
+    const QString departedAppId = QLatin1String("org.kde.jovie.departed");
+    m_speechd->setSpeakingDuration(500);
+    // A name set by the application does not keep its data alive.
+    Speaker::Instance()->getAppData(departedAppId)->setApplicationName(
+        QLatin1String("Departed"));
+    const int jobNum = Speaker::Instance()->say(departedAppId,
+        QString::fromAscii("Gone soon"), KSpeech::soPlainText);
+    QVERIFY(waitForState(jobNum, KSpeech::jsSpeaking));
+    Speaker::Instance()->releaseAppData(departedAppId);
+    // Kept while its job speaks, collected once it has ended.
+    QTest::qWait(50);
+    QVERIFY(Speaker::Instance()->findAppData(departedAppId));
+    QVERIFY(waitForState(jobNum, KSpeech::jsFinished));
+    QTest::qWait(50);
+    QVERIFY(!Speaker::Instance()->findAppData(departedAppId));
+    QVERIFY(!Speaker::Instance()->findAppData(QLatin1String("Departed")));
+    // The job is still there for pollers.
+    const JobRegistry *registry = Speaker::Instance()->jobRegistry();
+    QCOMPARE(registry->appId(*registry->job(jobNum)), departedAppId);
+    QCOMPARE(registry->liveCount(departedAppId), 0);
+    m_speechd->setSpeakingDuration(10);
+}
+
+void TestSpeaker::moveRelSentence()
+{
+    m_speechd->setSpeakingDuration(1000);
+    const int messages = m_speechd->messages().count();
+    const int jobNum = Speaker::Instance()->say(QLatin1String(appId),
+        QString::fromAscii("One. Two. Three. Four."), KSpeech::soPlainText);
+    QVERIFY(waitForState(jobNum, KSpeech::jsSpeaking));
+    const JobRegistry *registry = Speaker::Instance()->jobRegistry();
+    QCOMPARE(registry->job(jobNum)->sentenceNum, 1);
+    QCOMPARE(registry->job(jobNum)->sentenceCount, 4);
+
+    // Skipping ahead sends the rest again, without filtering it again.
+    m_speechd->setSpeakingDuration(10);
+    QCOMPARE(Speaker::Instance()->moveRelSentence(jobNum, 2), 3);
+    QVERIFY(waitForState(jobNum, KSpeech::jsFinished));
+    QCOMPARE(m_speechd->messages().mid(messages), QList<QByteArray>()
+        << "One." << "Two." << "Three." << "Four." << "Three." << "Four.");
+    QCOMPARE(registry->job(jobNum)->sentenceNum, 4);
+    // An ended job keeps no sentences.
+    QCOMPARE(Speaker::Instance()->moveRelSentence(jobNum, -1), 0);
+
+    // Another application's job queued behind would be cancelled with it, so
+    // the job is not moved.
+    m_speechd->setSpeakingDuration(1000);
+    const int moved = Speaker::Instance()->say(QLatin1String(appId),
+        QString::fromAscii("Five. Six. Seven."), KSpeech::soPlainText);
+    QVERIFY(waitForState(moved, KSpeech::jsSpeaking));
+    const int key = Speaker::Instance()->say(QLatin1String(otherAppId),
+        QString::fromAscii("a"), KSpeech::soKey);
+    QVERIFY(waitForState(key, KSpeech::jsQueued));
+    const int commands = m_speechd->commands().count();
+    m_speechd->setSpeakingDuration(10);
+    QCOMPARE(Speaker::Instance()->moveRelSentence(moved, 1), 1);
+    QCOMPARE(registry->job(moved)->sentenceNum, 1);
+    QVERIFY(waitForState(moved, KSpeech::jsFinished));
+    QVERIFY(waitForState(key, KSpeech::jsFinished));
+    QCOMPARE(m_speechd->messages().mid(messages + 6), QList<QByteArray>()
+        << "Five." << "Six." << "Seven." << "a");
+    foreach (const QByteArray &command, m_speechd->commands().mid(commands))
+        QVERIFY(!command.startsWith("CANCEL"));
+}
+
+void TestSpeaker::lostConnection()
+{
+    m_speechd->setSpeakingDuration(5000);
+    const int jobNum = Speaker::Instance()->say(QLatin1String(appId),
+        QString::fromAscii("Cut off"), KSpeech::soPlainText);
+    QVERIFY(waitForState(jobNum, KSpeech::jsSpeaking));
+    m_speechd->disconnectClients("native");
+    QVERIFY(waitForState(jobNum, KSpeech::jsDeleted));
+
+    // Speaker goes on through libspeechd, numbering jobs as before.
+    m_speechd->setSpeakingDuration(10);
+    const int nextJobNum = Speaker::Instance()->say(QLatin1String(appId),
+        QString::fromAscii("Still there"), KSpeech::soPlainText);
+    QCOMPARE(nextJobNum, jobNum + 1);
+    QVERIFY(waitForState(nextJobNum, KSpeech::jsFinished));
+}
+
+void TestSpeaker::schedulerToggled()
+{
+    // Runs after lostConnection, so the jobs go through libspeechd.
+    m_speechd->setSpeakingDuration(200);
+    const int first = Speaker::Instance()->say(QLatin1String(appId),
+        QString::fromAscii("Not scheduled"), KSpeech::soPlainText);
+    setScheduler(true, 1);
+    const int second = Speaker::Instance()->say(QLatin1String(appId),
+        QString::fromAscii("Scheduled"), KSpeech::soPlainText);
+    setScheduler(false, 1);
+    const int third = Speaker::Instance()->say(QLatin1String(appId),
+        QString::fromAscii("Not scheduled again"), KSpeech::soPlainText);
+    QCOMPARE(second, first + 1);
+    QCOMPARE(third, second + 1);
+    QVERIFY(waitForState(first, KSpeech::jsFinished));
+    QVERIFY(waitForState(second, KSpeech::jsFinished));
+    QVERIFY(waitForState(third, KSpeech::jsFinished));
+}
+
+QTEST_KDEMAIN_CORE(TestSpeaker)
+#include "testspeaker.moc"
@@ -0,0 +1,43 @@
+#ifndef TESTSPEAKER_H
+#define TESTSPEAKER_H
+
+#include <QObject>
+
+#include <kspeech.h>
+
+class MockSpeechd;
+
+// Runs Speaker against MockSpeechd, through Jovie's own SSIP client.
+class TestSpeaker : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void say();
+    void cancel();
+    void pauseResume();
+    void slowReplies();
+    void refusedKey();
+    void benchmarkThroughput();
+    void schedulerFairness();
+    void rateLimit();
+    void supersede();
+    void duplicates();
+    void departedApplication();
+    void moveRelSentence();
+    void lostConnection();
+    void schedulerToggled();
+
+private:
+    // Waits until the job is in the state.
+    bool waitForState(int jobNum, KSpeech::JobState state, int timeout = 3000);
+    // Turns the scheduler on or off in kttsdrc.
+    void setScheduler(bool on, int lookahead);
+
+    MockSpeechd *m_speechd;
+};
+
+#endif // TESTSPEAKER_H
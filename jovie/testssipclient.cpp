@@ -0,0 +1,150 @@
+#include <QtTest>
+#include <QtCore/QDir>
+#include "testssipclient.h"
+#include "ssipclient.h"
+#include "mockspeechd.h"
+
+static bool waitFor(QSignalSpy &spy, int count)
+{
+    for (int i = 0; i < 100 && spy.count() < count; ++i)
+        QTest::qWait(20);
+    return spy.count() >= count;
+}
+
+void TestSsipClient::init()
+{
+    m_path = QDir::temp().filePath(QString::fromAscii("jovie-test-ssip-%1").arg(QCoreApplication::applicationPid()));
+    m_server = new MockSpeechd(this);
+    QVERIFY(m_server->listen(m_path));
+}
+
+void TestSsipClient::cleanup()
+{
+    delete m_server;
+    m_server = 0;
+}
+
+void TestSsipClient::pipelining()
+{
+    SsipClient client;
+    QSignalSpy queued(&client, SIGNAL(messageQueued(int,int)));
+    QSignalSpy finished(&client, SIGNAL(requestFinished(int,bool)));
+    m_server->setHolding(true);
+
+    // Made before the connection is open.
+    const int set = client.set("PRIORITY", "text");
+    client.connectToServer(m_path);
+    const int first = client.speak(QString::fromAscii("One."));
+    const int second = client.speak(QString::fromAscii("Two."));
+
+    // All commands arrive although none was answered.
+    for (int i = 0; i < 100 && m_server->messages().count() < 2; ++i)
+        QTest::qWait(20);
+    QCOMPARE(m_server->commands(), QList<QByteArray>() << "SET self PRIORITY text" << "SPEAK" << "SPEAK");
+    QCOMPARE(m_server->messages(), QList<QByteArray>() << "One." << "Two.");
+    QCOMPARE(queued.count(), 0);
+    QCOMPARE(client.pendingReplies(), 5);
+
+    m_server->setHolding(false);
+    QVERIFY(waitFor(finished, 3));
+    QCOMPARE(finished.at(0).at(0).toInt(), set);
+    QCOMPARE(queued.count(), 2);
+    QCOMPARE(queued.at(0).at(0).toInt(), first);
+    QCOMPARE(queued.at(0).at(1).toInt(), 1);
+    QCOMPARE(queued.at(1).at(0).toInt(), second);
+    QCOMPARE(queued.at(1).at(1).toInt(), 2);
+    QCOMPARE(client.pendingReplies(), 0);
+}
+
+void TestSsipClient::block()
+{
+    SsipClient client;
+    QSignalSpy queued(&client, SIGNAL(messageQueued(int,int)));
+    QSignalSpy finished(&client, SIGNAL(requestFinished(int,bool)));
+    client.connectToServer(m_path);
+    const int request = client.speakBlock(QStringList() << QString::fromAscii("A.")
+        << QString::fromAscii("B.") << QString::fromAscii("C."));
+
+    QVERIFY(waitFor(finished, 1));
+    QCOMPARE(finished.at(0).at(0).toInt(), request);
+    QCOMPARE(finished.at(0).at(1).toBool(), true);
+    QCOMPARE(m_server->commands(), QList<QByteArray>() << "BLOCK BEGIN" << "SPEAK" << "SPEAK" << "SPEAK" << "BLOCK END");
+    QCOMPARE(queued.count(), 3);
+    for (int i = 0; i < 3; ++i)
+        QCOMPARE(queued.at(i).at(0).toInt(), request);
+}
+
+void TestSsipClient::escaping()
+{
+    SsipClient client;
+    QSignalSpy finished(&client, SIGNAL(requestFinished(int,bool)));
+    client.connectToServer(m_path);
+    const QString text = QString::fromAscii(".start\r\n.\r\nend");
+    client.speak(text);
+
+    QVERIFY(waitFor(finished, 1));
+    QCOMPARE(m_server->messages(), QList<QByteArray>() << text.toAscii());
+}
+
+void TestSsipClient::events()
+{
+    SsipClient client;
+    QSignalSpy queued(&client, SIGNAL(messageQueued(int,int)));
+    QSignalSpy events(&client, SIGNAL(event(int,int,QString)));
+    client.connectToServer(m_path);
+    m_server->setHolding(true);
+    client.speak(QString::fromAscii("Hello."));
+    for (int i = 0; i < 100 && m_server->messages().isEmpty(); ++i)
+        QTest::qWait(20);
+
+    // An event between the lines of the reply.
+    m_server->sendRaw("230 OK RECEIVING DATA\r\n225-1\r\n701-1\r\n701-7\r\n701 BEGIN\r\n");
+    m_server->sendRaw("225 OK MESSAGE QUEUED\r\n700-1\r\n700-7\r\n700-s2\r\n700 INDEX MARK\r\n");
+    m_server->sendRaw("702-1\r\n702-7\r\n702 END\r\n");
+    QVERIFY(waitFor(events, 3));
+    QCOMPARE(queued.count(), 1);
+    QCOMPARE(queued.at(0).at(1).toInt(), 1);
+    QCOMPARE(events.at(0).at(0).toInt(), 1);
+    QCOMPARE(events.at(0).at(1).toInt(), int(SsipClient::Begin));
+    QCOMPARE(events.at(1).at(1).toInt(), int(SsipClient::IndexMark));
+    QCOMPARE(events.at(1).at(2).toString(), QString::fromAscii("s2"));
+    QCOMPARE(events.at(2).at(1).toInt(), int(SsipClient::End));
+}
+
+void TestSsipClient::failedCommand()
+{
+    SsipClient client;
+    QSignalSpy finished(&client, SIGNAL(requestFinished(int,bool)));
+    m_server->setError("SET self OUTPUT_MODULE", "410 ERR UNKNOWN MODULE\r\n");
+    client.connectToServer(m_path);
+    const int failed = client.set("OUTPUT_MODULE", "nonexistent");
+    const int next = client.set("RATE", "10");
+
+    QVERIFY(waitFor(finished, 2));
+    QCOMPARE(finished.at(0).at(0).toInt(), failed);
+    QCOMPARE(finished.at(0).at(1).toBool(), false);
+    QCOMPARE(finished.at(1).at(0).toInt(), next);
+    QCOMPARE(finished.at(1).at(1).toBool(), true);
+}
+
+void TestSsipClient::lostConnection()
+{
+    SsipClient client;
+    QSignalSpy finished(&client, SIGNAL(requestFinished(int,bool)));
+    QSignalSpy disconnected(&client, SIGNAL(disconnected()));
+    client.connectToServer(m_path);
+    m_server->setHolding(true);
+    const int request = client.speak(QString::fromAscii("Lost."));
+    for (int i = 0; i < 100 && m_server->messages().isEmpty(); ++i)
+        QTest::qWait(20);
+    m_server->disconnectClients();
+
+    QVERIFY(waitFor(disconnected, 1));
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(finished.at(0).at(0).toInt(), request);
+    QCOMPARE(finished.at(0).at(1).toBool(), false);
+    QVERIFY(!client.isOpen());
+}
+
+QTEST_MAIN(TestSsipClient)
+#include "testssipclient.moc"
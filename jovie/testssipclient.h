@@ -0,0 +1,28 @@
+#ifndef TESTSSIPCLIENT_H
+#define TESTSSIPCLIENT_H
+
+#include <QObject>
+#include <QString>
+
+class MockSpeechd;
+
+class TestSsipClient : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void pipelining();
+    void block();
+    void escaping();
+    void events();
+    void failedCommand();
+    void lostConnection();
+
+private:
+    MockSpeechd *m_server;
+    QString m_path;
+};
+
+#endif // TESTSSIPCLIENT_H
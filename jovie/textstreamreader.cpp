@@ -0,0 +1,171 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Reads the text of a job from a file descriptor, a piece at a time.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// TextStreamReader includes.
+#include "textstreamreader.h"
+#include "textstreamreader.moc"
+
+// System includes.
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+// Qt includes.
+#include <QtCore/QRegExp>
+#include <QtCore/QTextCodec>
+#include <QtCore/QTextDecoder>
+#include <QtCore/QtConcurrentRun>
+
+// KDE includes.
+#include <kdebug.h>
+
+/* Size of the reads. */
+static const int ReadSize = 64 * 1024;
+/* A piece is passed on once this many characters are read. */
+static const int PieceSize = 16 * 1024;
+/* Pieces read ahead of the ones taken. */
+static const int ReadAhead = 4;
+/* How often a blocked reader checks whether to stop, in ms. */
+static const int StopCheckInterval = 250;
+
+TextStreamReader::TextStreamReader(int fd, QTextCodec *codec, Splitting splitting, qint64 maxWholeBytes,
+                                   QObject *parent) :
+    QObject(parent),
+    m_fd(fd),
+    m_codec(codec ? codec : QTextCodec::codecForName("UTF-8")),
+    m_splitting(splitting),
+    m_maxWholeBytes(maxWholeBytes),
+    m_slots(ReadAhead),
+    m_stop(0)
+{
+}
+
+TextStreamReader::~TextStreamReader()
+{
+    m_stop = 1;
+    m_future.waitForFinished();
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+void TextStreamReader::start()
+{
+    m_future = QtConcurrent::run(this, &TextStreamReader::run);
+}
+
+void TextStreamReader::pieceDone()
+{
+    m_slots.release();
+}
+
+int TextStreamReader::pieceLength(const QString &text)
+{
+    int length = text.lastIndexOf(QLatin1String("\n\n"));
+    if (length >= 0)
+        return length + 2;
+    length = qMax(text.lastIndexOf(QLatin1String(". ")),
+        qMax(text.lastIndexOf(QLatin1String("! ")), text.lastIndexOf(QLatin1String("? "))));
+    if (length >= 0)
+        return length + 2;
+    length = text.lastIndexOf(QLatin1Char('\n'));
+    if (length < 0)
+        length = text.lastIndexOf(QLatin1Char(' '));
+    return length >= 0 ? length + 1 : text.length();
+}
+
+bool TextStreamReader::startsSsml(const QString &text)
+{
+    // As Speaker::isSsml, the root element decides; an XML declaration may come first.
+    QRegExp root(QLatin1String("^\\s*(<\\?xml[^>]*>\\s*)?<speak[\\s/>]"));
+    return root.indexIn(text) == 0;
+}
+
+bool TextStreamReader::acquireSlot()
+{
+    while (!m_slots.tryAcquire(1, StopCheckInterval))
+    {
+        if (m_stop)
+            return false;
+    }
+    return !m_stop;
+}
+
+void TextStreamReader::run()
+{
+    QTextDecoder *decoder = m_codec->makeDecoder();
+    QByteArray buffer(ReadSize, '\0');
+    QString pending;
+    bool ok = true;
+    bool whole = (m_splitting == KeepWhole);
+    bool decided = (m_splitting != SplitUnlessSsml);
+
+    while (!m_stop)
+    {
+        struct pollfd pfd;
+        pfd.fd = m_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ready = ::poll(&pfd, 1, StopCheckInterval);
+        if (ready == 0 || (ready < 0 && errno == EINTR))
+            continue;
+        ssize_t count = ready < 0 ? -1 : ::read(m_fd, buffer.data(), buffer.size());
+        if (count < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            kDebug() << "TextStreamReader: read failed, errno " << errno;
+            ok = false;
+            break;
+        }
+        if (count == 0)
+            break;
+        pending += decoder->toUnicode(buffer.constData(), count);
+
+        // Decided before the first piece is cut, from its first PieceSize characters.
+        if (!decided && pending.length() >= PieceSize)
+        {
+            decided = true;
+            whole = startsSsml(pending);
+        }
+        if (whole && m_maxWholeBytes > 0 && qint64(pending.length()) * sizeof(QChar) > m_maxWholeBytes)
+        {
+            kDebug() << "TextStreamReader: markup longer than" << m_maxWholeBytes << "bytes";
+            ok = false;
+            break;
+        }
+
+        while (!whole && pending.length() >= PieceSize && !m_stop)
+        {
+            const int length = pieceLength(pending);
+            if (!acquireSlot())
+                break;
+            emit pieceRead(pending.left(length));
+            pending.remove(0, length);
+        }
+    }
+    delete decoder;
+
+    if (!m_stop && ok && !pending.trimmed().isEmpty() && acquireSlot())
+        emit pieceRead(pending);
+    if (!m_stop)
+        emit finished(ok);
+}
@@ -0,0 +1,116 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Reads the text of a job from a file descriptor, a piece at a time.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef TEXTSTREAMREADER_H
+#define TEXTSTREAMREADER_H
+
+// Qt includes.
+#include <QtCore/QObject>
+#include <QtCore/QFuture>
+#include <QtCore/QSemaphore>
+#include <QtCore/QAtomicInt>
+
+class QTextCodec;
+
+/**
+ * @class TextStreamReader
+ *
+ * Reads text from a file descriptor, such as a pipe or memfd handed over by
+ * sayFd, in a worker thread.  The text is decoded as it arrives and passed on
+ * in pieces that end at a paragraph or sentence boundary, so a large text is
+ * never held in one piece.  Only a few pieces are read ahead of the ones
+ * taken by @ref pieceDone; after that the reader waits.
+ *
+ * Markup cannot be split, so it is read to its end and passed on whole, up
+ * to a maximum length.
+ */
+class TextStreamReader : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Splitting
+    {
+        Split,                  /* plain text, passed on in pieces */
+        KeepWhole,              /* markup, passed on in one piece */
+        SplitUnlessSsml         /* kept whole if it turns out to be SSML */
+    };
+
+    /**
+     * Constructor.
+     * @param fd                The file descriptor.  The reader closes it.
+     * @param codec             Encoding of the text.  UTF-8 if null.
+     * @param splitting         Whether the text may be split.
+     * @param maxWholeBytes     Most text, as UTF-16, read for one piece when it
+     *                          is kept whole.  No limit if 0.
+     */
+    TextStreamReader(int fd, QTextCodec *codec, Splitting splitting, qint64 maxWholeBytes,
+                     QObject *parent = 0);
+
+    /**
+     * Destructor.  Stops reading.
+     */
+    ~TextStreamReader();
+
+    /**
+     * Starts reading.
+     */
+    void start();
+
+    /**
+     * Tells the reader a piece has been taken, so it may read another.
+     */
+    void pieceDone();
+
+signals:
+    /**
+     * Emitted in the worker thread for each piece of text.
+     */
+    void pieceRead(const QString &text);
+
+    /**
+     * Emitted in the worker thread when the end of the text was reached.
+     * @param ok                False if reading failed, or if text kept whole
+     *                          was longer than allowed.
+     */
+    void finished(bool ok);
+
+private:
+    void run();
+    // Waits until another piece may be read ahead.  False if stopped meanwhile.
+    bool acquireSlot();
+    // Returns the length of the longest start of text that ends at a boundary.
+    static int pieceLength(const QString &text);
+    // Returns whether the start of text is the root element of an SSML document.
+    static bool startsSsml(const QString &text);
+
+    int m_fd;
+    QTextCodec *m_codec;
+    Splitting m_splitting;
+    qint64 m_maxWholeBytes;
+    QFuture<void> m_future;
+    // Pieces that may be read ahead.
+    QSemaphore m_slots;
+    QAtomicInt m_stop;
+};
+
+#endif // TEXTSTREAMREADER_H
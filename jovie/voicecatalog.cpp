@@ -0,0 +1,386 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Catalog of the voices speech-dispatcher offers.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// VoiceCatalog includes.
+#include "voicecatalog.h"
+#include "voicecatalog.moc"
+
+// System includes.
+#include <stdlib.h>
+
+// Qt includes.
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QtConcurrentRun>
+
+// KDE includes.
+#include <kdebug.h>
+#include <ksavefile.h>
+#include <kstandarddirs.h>
+
+// KTTS includes.
+#include "talkercode.h"
+
+// KTTSD includes.
+#include <config-jovie.h>
+// define spd_debug here to avoid a link error in speech-dispatcher 0.6.7's header file for now
+#define spd_debug spd_debug3
+#include <libspeechd.h>
+
+/* Identifies the catalog file, and the layout of its contents. */
+static const quint32 CatalogMagic = 0x4a564331;     // "JVC1"
+
+static QString speechdVersion()
+{
+#ifdef SPEECHD_VERSION
+    return QLatin1String(SPEECHD_VERSION);
+#else
+    return QString();
+#endif
+}
+
+/**
+ * Fingerprint of the output modules.  The configuration directories of the modules
+ * are included, since installing or configuring voices touches them without
+ * changing the list of modules.
+ */
+static uint modulesFingerprint(const QStringList &modules)
+{
+    QStringList sorted = modules;
+    sorted.sort();
+    QStringList parts = sorted;
+    QStringList configDirs;
+    configDirs << QLatin1String("/etc/speech-dispatcher/modules")
+        << QDir::homePath() + QLatin1String("/.config/speech-dispatcher/modules");
+    foreach (const QString &dir, configDirs)
+    {
+        QFileInfo info(dir);
+        if (info.exists())
+            parts << QString::number(info.lastModified().toTime_t());
+    }
+    return qHash(parts.join(QLatin1String("\n")));
+}
+
+static void freeModules(char **modules)
+{
+    if (!modules)
+        return;
+    for (char **module = modules; *module; ++module)
+        free(*module);
+    free(modules);
+}
+
+static void freeVoices(SPDVoice **voices)
+{
+    if (!voices)
+        return;
+    for (SPDVoice **voice = voices; *voice; ++voice)
+    {
+        free((*voice)->name);
+        free((*voice)->language);
+        free((*voice)->variant);
+        free(*voice);
+    }
+    free(voices);
+}
+
+/**
+ * Scans speech-dispatcher on a connection of its own.  Runs in a worker thread.
+ * The voices are only listed if the version or fingerprint differ from the given
+ * ones, or if @p force is set.
+ */
+static VoiceCatalogData scanSpeechd(const QString &version, uint fingerprint, bool force)
+{
+    VoiceCatalogData data;
+    data.version = speechdVersion();
+    SPDConnection *connection = spd_open("jovie", "catalog", NULL, SPD_MODE_SINGLE);
+    if (!connection)
+        return data;
+    data.valid = true;
+
+    char **modules = spd_list_modules(connection);
+    for (char **module = modules; module && *module; ++module)
+        data.modules << QString::fromUtf8(*module);
+    freeModules(modules);
+    data.fingerprint = modulesFingerprint(data.modules);
+
+    if (force || data.version != version || data.fingerprint != fingerprint)
+    {
+        foreach (const QString &module, data.modules)
+        {
+            if (module == QLatin1String("dummy") ||
+                spd_set_output_module(connection, module.toUtf8().data()) != 0)
+                continue;
+            SPDVoice **voices = spd_list_synthesis_voices(connection);
+            for (SPDVoice **voice = voices; voice && *voice; ++voice)
+            {
+                CatalogVoice v;
+                v.module = module;
+                v.name = QString::fromUtf8((*voice)->name);
+                v.language = QString::fromUtf8((*voice)->language);
+                v.variant = QString::fromUtf8((*voice)->variant);
+                data.voices.append(v);
+            }
+            freeVoices(voices);
+        }
+        data.hasVoices = true;
+    }
+    spd_close(connection);
+    return data;
+}
+
+// "en-US" and "en_us" both give "en".
+static QString primaryLanguage(const QString &language)
+{
+    QString lang = language.toLower();
+    for (int i = 0; i < lang.length(); ++i)
+    {
+        if (lang.at(i) == QLatin1Char('-') || lang.at(i) == QLatin1Char('_'))
+        {
+            lang.truncate(i);
+            break;
+        }
+    }
+    return lang;
+}
+
+static QString normalizedLanguage(const QString &language)
+{
+    QString lang = language.toLower();
+    lang.replace(QLatin1Char('_'), QLatin1Char('-'));
+    return lang;
+}
+
+VoiceCatalog * VoiceCatalog::m_instance = NULL;
+
+VoiceCatalog * VoiceCatalog::Instance()
+{
+    if (m_instance == NULL)
+    {
+        m_instance = new VoiceCatalog();
+    }
+    return m_instance;
+}
+
+VoiceCatalog::VoiceCatalog() :
+    m_loaded(false),
+    m_scanPending(false)
+{
+    connect(&m_scan, SIGNAL(finished()), this, SLOT(slotScanFinished()));
+    m_loaded = load();
+    refresh();
+}
+
+VoiceCatalog::~VoiceCatalog()
+{
+    m_scan.waitForFinished();
+}
+
+void VoiceCatalog::refresh(bool force)
+{
+    if (m_scanPending)
+        return;
+    m_scanPending = true;
+    m_scan.setFuture(QtConcurrent::run(scanSpeechd, m_data.version, m_data.fingerprint,
+        force || !m_loaded));
+}
+
+void VoiceCatalog::slotScanFinished()
+{
+    if (!m_scanPending)
+        return;
+    m_scanPending = false;
+    VoiceCatalogData data = m_scan.result();
+    if (!data.valid)
+    {
+        kDebug() << "VoiceCatalog: could not connect to speech-dispatcher";
+    }
+    else if (!data.hasVoices)
+    {
+        // Still up to date.
+        m_loaded = true;
+    }
+    else
+    {
+        kDebug() << "VoiceCatalog: found" << data.voices.count() << "voices in"
+            << data.modules.count() << "output modules";
+        setData(data);
+        m_loaded = true;
+        save();
+        emit catalogChanged();
+    }
+    emit scanFinished();
+}
+
+void VoiceCatalog::ensureLoaded() const
+{
+    if (m_loaded || !m_scanPending)
+        return;
+    VoiceCatalog *self = const_cast<VoiceCatalog *>(this);
+    self->m_scan.waitForFinished();
+    self->slotScanFinished();
+}
+
+void VoiceCatalog::setData(const VoiceCatalogData &data)
+{
+    m_data = data;
+    m_byModule.clear();
+    m_byLanguage.clear();
+    m_languagesByModule.clear();
+    m_possibleTalkers.clear();
+    const int voicesCount = m_data.voices.count();
+    for (int ndx = 0; ndx < voicesCount; ++ndx)
+    {
+        const CatalogVoice &voice = m_data.voices.at(ndx);
+        m_byModule[voice.module].append(ndx);
+        m_byLanguage[primaryLanguage(voice.language)].append(ndx);
+        QStringList &languages = m_languagesByModule[voice.module];
+        if (!languages.contains(voice.language))
+            languages.append(voice.language);
+
+        TalkerCode code;
+        code.setOutputModule(voice.module);
+        code.setVoiceName(voice.name);
+        code.setLanguage(voice.language);
+        m_possibleTalkers.append(code.getTalkerCode());
+    }
+}
+
+bool VoiceCatalog::isLoaded() const
+{
+    return m_loaded;
+}
+
+bool VoiceCatalog::isScanning() const
+{
+    return m_scanPending;
+}
+
+QStringList VoiceCatalog::modules() const
+{
+    ensureLoaded();
+    return m_data.modules;
+}
+
+QStringList VoiceCatalog::languagesByModule(const QString &module) const
+{
+    ensureLoaded();
+    return m_languagesByModule.value(module);
+}
+
+QList<CatalogVoice> VoiceCatalog::voices(const QString &module, const QString &language) const
+{
+    ensureLoaded();
+    if (module.isEmpty() && language.isEmpty())
+        return m_data.voices;
+
+    // Walk the shorter of the two indexes.
+    const QVector<int> *candidates = 0;
+    QVector<int> byModule = m_byModule.value(module);
+    QVector<int> byLanguage = m_byLanguage.value(primaryLanguage(language));
+    if (module.isEmpty())
+        candidates = &byLanguage;
+    else if (language.isEmpty() || byModule.count() <= byLanguage.count())
+        candidates = &byModule;
+    else
+        candidates = &byLanguage;
+
+    const QString wanted = normalizedLanguage(language);
+    const bool wantRegion = wanted.contains(QLatin1Char('-'));
+    QList<CatalogVoice> result;
+    foreach (int ndx, *candidates)
+    {
+        const CatalogVoice &voice = m_data.voices.at(ndx);
+        if (!module.isEmpty() && voice.module != module)
+            continue;
+        if (!language.isEmpty())
+        {
+            if (wantRegion && normalizedLanguage(voice.language) != wanted)
+                continue;
+            if (!wantRegion && primaryLanguage(voice.language) != wanted)
+                continue;
+        }
+        result.append(voice);
+    }
+    return result;
+}
+
+QStringList VoiceCatalog::possibleTalkers() const
+{
+    ensureLoaded();
+    return m_possibleTalkers;
+}
+
+bool VoiceCatalog::load()
+{
+    QFile file(KStandardDirs::locateLocal("cache", QLatin1String("jovie/voicecatalog")));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_6);
+    quint32 magic;
+    stream >> magic;
+    if (magic != CatalogMagic)
+        return false;
+
+    VoiceCatalogData data;
+    quint32 voicesCount;
+    stream >> data.version >> data.fingerprint >> data.modules >> voicesCount;
+    for (quint32 i = 0; i < voicesCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        CatalogVoice voice;
+        stream >> voice.module >> voice.name >> voice.language >> voice.variant;
+        data.voices.append(voice);
+    }
+    if (stream.status() != QDataStream::Ok)
+    {
+        kDebug() << "VoiceCatalog: ignoring damaged catalog" << file.fileName();
+        return false;
+    }
+    // A different speech-dispatcher may list different voices.
+    if (data.version != speechdVersion())
+        return false;
+    data.valid = true;
+    data.hasVoices = true;
+    setData(data);
+    return true;
+}
+
+void VoiceCatalog::save() const
+{
+    KSaveFile file(KStandardDirs::locateLocal("cache", QLatin1String("jovie/voicecatalog")));
+    if (!file.open())
+    {
+        kDebug() << "VoiceCatalog: could not write" << file.fileName();
+        return;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << CatalogMagic << m_data.version << m_data.fingerprint << m_data.modules
+        << quint32(m_data.voices.count());
+    foreach (const CatalogVoice &voice, m_data.voices)
+        stream << voice.module << voice.name << voice.language << voice.variant;
+    file.finalize();
+}
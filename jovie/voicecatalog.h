@@ -0,0 +1,169 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Catalog of the voices speech-dispatcher offers.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef VOICECATALOG_H
+#define VOICECATALOG_H
+
+// Qt includes.
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QtCore/QFutureWatcher>
+
+/**
+ * A voice of a speech-dispatcher output module.
+ */
+struct CatalogVoice
+{
+    QString module;         /* output module */
+    QString name;           /* synthesizer voice name */
+    QString language;       /* language code, as speech-dispatcher reports it */
+    QString variant;        /* dialect or variant, may be empty */
+};
+
+/**
+ * Contents of the catalog, as scanned from speech-dispatcher or read from disk.
+ */
+struct VoiceCatalogData
+{
+    VoiceCatalogData() : fingerprint(0), valid(false), hasVoices(false) {}
+
+    QString version;        /* speech-dispatcher version */
+    uint fingerprint;       /* fingerprint of the output modules */
+    QStringList modules;
+    QList<CatalogVoice> voices;
+    bool valid;             /* false if speech-dispatcher could not be reached */
+    bool hasVoices;         /* false if the voices were not listed, because nothing changed */
+};
+
+/**
+ * @class VoiceCatalog
+ *
+ * The output modules and voices speech-dispatcher offers, indexed by module and
+ * by language.
+ *
+ * Listing the voices of every module takes a while, and needs the output module
+ * of the connection to be switched, so it is done on a separate connection in a
+ * worker thread.  The result is saved to disk together with the speech-dispatcher
+ * version and a fingerprint of the output modules, so later starts can answer
+ * right away.  @ref refresh checks the fingerprint in the background and only
+ * lists the voices again when it has changed.
+ */
+class VoiceCatalog : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * singleton accessor
+     */
+    static VoiceCatalog * Instance();
+
+    /**
+     * Destructor.
+     */
+    ~VoiceCatalog();
+
+    /**
+     * The output modules of speech-dispatcher.
+     */
+    QStringList modules() const;
+
+    /**
+     * The languages of the voices of an output module.
+     */
+    QStringList languagesByModule(const QString &module) const;
+
+    /**
+     * The voices of an output module speaking a language.
+     * @param module            Output module.  If empty, all modules.
+     * @param language          Language code.  If empty, all languages.
+     *                          "en" also matches "en-us" and "en_GB".
+     */
+    QList<CatalogVoice> voices(const QString &module = QString(),
+        const QString &language = QString()) const;
+
+    /**
+     * A talker code for every voice in the catalog.
+     */
+    QStringList possibleTalkers() const;
+
+    /**
+     * Whether the catalog has been read from disk or from speech-dispatcher.
+     * If not, the first query waits for the background scan to finish.
+     */
+    bool isLoaded() const;
+
+    /**
+     * Whether a background scan is running.
+     */
+    bool isScanning() const;
+
+public slots:
+    /**
+     * Checks in the background whether the catalog is still up to date, and
+     * rescans speech-dispatcher if not.
+     * @param force             Rescan even if the fingerprint has not changed.
+     */
+    void refresh(bool force = false);
+
+signals:
+    /**
+     * Emitted when a background scan changed the catalog.
+     */
+    void catalogChanged();
+
+    /**
+     * Emitted when a background scan is over, whether or not it changed the catalog.
+     */
+    void scanFinished();
+
+private slots:
+    void slotScanFinished();
+
+private:
+    VoiceCatalog();
+
+    // Makes the catalog available, waiting for a running scan if there is nothing else.
+    void ensureLoaded() const;
+    // Replaces the contents of the catalog and rebuilds the indexes.
+    void setData(const VoiceCatalogData &data);
+    bool load();
+    void save() const;
+
+    VoiceCatalogData m_data;
+    bool m_loaded;
+    // Indexes into m_data.voices.
+    QHash<QString, QVector<int> > m_byModule;
+    QHash<QString, QVector<int> > m_byLanguage;
+    QHash<QString, QStringList> m_languagesByModule;
+    QStringList m_possibleTalkers;
+    QFutureWatcher<VoiceCatalogData> m_scan;
+    // True while a scan has been started and its result not yet taken.
+    bool m_scanPending;
+
+    static VoiceCatalog * m_instance;
+};
+
+#endif // VOICECATALOG_H
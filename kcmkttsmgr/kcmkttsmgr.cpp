@@ -64,12 +64,13 @@
 #include <kspeech.h>
 #include <kpluginfactory.h>
 #include <kpluginloader.h>
-#include <kservicetypetrader.h>
 
 // KTTS includes.
 #include "talkercode.h"
 #include "filterconf.h"
+#include "filterplugins.h"
 #include "kttsjobmgr.h"
+#include "jovieinterface.h"
 
 // Some constants.
 // Defaults set when clicking Defaults button.
@@ -599,10 +600,12 @@ void KCMKttsMgr::save()
     if (enableJovieWasToggled)
         slotEnableJovie_toggled (false);
     else {
-        // If Jovie is running, reinitialize it.
+        // If Jovie is running, have it load what changed.
         if (m_kspeech) {
-            kDebug() << "Restarting Jovie";
-            m_kspeech->reinit();
+            kDebug() << "Reloading Jovie configuration";
+            OrgKdeJovieInterface jovie (QLatin1String( "org.kde.jovie" ), QLatin1String( "/KSpeech" ), QDBusConnection::sessionBus());
+            // Filters whose Filter_nn group changed are rebuilt.
+            jovie.reloadConfig();
         }
     }
 }
@@ -687,40 +690,10 @@ const KAboutData* KCMKttsMgr::aboutData() const
 KttsFilterConf* KCMKttsMgr::loadFilterPlugin (const QString& plugInName)
 {
     // kDebug() << "KCMKttsMgr::loadPlugin: Running";
-
-    // Find the plugin.
-    KService::List offers = KServiceTypeTrader::self()->query (QLatin1String( "Jovie/FilterPlugin" ),
-                            QString (QLatin1String( "DesktopEntryName == '%1'" )).arg (plugInName));
-
-    if (offers.count() == 1) {
-        // When the entry is found, load the plug in
-        // First create a factory for the library
-        KLibFactory *factory = KLibLoader::self()->factory (QLatin1String( offers[0]->library().toLatin1() ));
-        if (factory) {
-            // If the factory is created successfully, instantiate the KttsFilterConf class for the
-            // specific plug in to get the plug in configuration object.
-            int errorNo = 0;
-            KttsFilterConf *plugIn =
-                KLibLoader::createInstance<KttsFilterConf> (
-                    QLatin1String( offers[0]->library().toLatin1() ), NULL, QStringList ( QLatin1String( offers[0]->library().toLatin1() )),
-                    &errorNo);
-            if (plugIn) {
-                // If everything went ok, return the plug in pointer.
-                return plugIn;
-            } else {
-                // Something went wrong, returning null.
-                kDebug() << "KCMKttsMgr::loadFilterPlugin: Unable to instantiate KttsFilterConf class for plugin " << plugInName << " error: " << errorNo;
-                return NULL;
-            }
-        } else {
-            // Something went wrong, returning null.
-            kDebug() << "KCMKttsMgr::loadFilterPlugin: Unable to create Factory object for plugin " << plugInName;
-            return NULL;
-        }
-    }
-    // The plug in was not found (unexpected behaviour, returns null).
-    kDebug() << "KCMKttsMgr::loadFilterPlugin: KTrader did not return an offer for plugin " << plugInName;
-    return NULL;
+    KttsFilterConf *plugIn = FilterPlugins::self()->create<KttsFilterConf> (plugInName);
+    if (!plugIn)
+        kDebug() << "KCMKttsMgr::loadFilterPlugin: Unable to instantiate KttsFilterConf class for plugin " << plugInName;
+    return plugIn;
 }
 
 /**
@@ -775,12 +748,11 @@ void KCMKttsMgr::addFilter()
         }
     }
     // Append those available plugins not yet in the list at all.
-    KService::List offers = KServiceTypeTrader::self()->query (QLatin1String( "Jovie/FilterPlugin" ));
+    const KService::List offers = FilterPlugins::self()->offers();
     for (int i = 0; i < offers.count() ; ++i) {
         QString filterPlugInName = offers[i]->name();
         if (countFilterPlugins (filterPlugInName) == 0) {
-            QString desktopEntryName = FilterNameToDesktopEntryName (filterPlugInName);
-            KttsFilterConf* filterConf = loadFilterPlugin (desktopEntryName);
+            KttsFilterConf* filterConf = loadFilterPlugin (offers[i]->desktopEntryName());
             if (filterConf) {
                 filterPlugInNames.append (filterPlugInName);
                 delete filterConf;
@@ -1324,7 +1296,7 @@ void KCMKttsMgr::slotConfigFilterDlg_CancelClicked()
 }
 
 /**
- * Uses KTrader to convert a translated Filter Plugin Name to DesktopEntryName.
+ * Converts a translated Filter Plugin Name to DesktopEntryName.
  * @param name                   The translated plugin name.  From Name= line in .desktop file.
  * @return                       DesktopEntryName.  The name of the .desktop file (less .desktop).
  *                               QString() if not found.
@@ -1332,28 +1304,18 @@ void KCMKttsMgr::slotConfigFilterDlg_CancelClicked()
 QString KCMKttsMgr::FilterNameToDesktopEntryName (const QString& name)
 {
     if (name.isEmpty()) return QString();
-    const KService::List  offers =  KServiceTypeTrader::self()->query (QLatin1String( "Jovie/FilterPlugin" ));
-    for (int ndx = 0; ndx < offers.count(); ++ndx)
-        if (offers[ndx]->name() == name)
-            return offers[ndx]->desktopEntryName();
-    return QString();
+    return FilterPlugins::self()->desktopEntryName (name);
 }
 
 /**
- * Uses KTrader to convert a DesktopEntryName into a translated Filter Plugin Name.
+ * Converts a DesktopEntryName into a translated Filter Plugin Name.
  * @param desktopEntryName       The DesktopEntryName.
  * @return                       The translated Name of the plugin, from Name= line in .desktop file.
  */
 QString KCMKttsMgr::FilterDesktopEntryNameToName (const QString& desktopEntryName)
 {
     if (desktopEntryName.isEmpty()) return QString();
-    KService::List offers = KServiceTypeTrader::self()->query (QLatin1String( "Jovie/FilterPlugin" ),
-                            QString (QLatin1String( "DesktopEntryName == '%1'" )).arg (desktopEntryName));
-
-    if (offers.count() == 1)
-        return offers[0]->name();
-    else
-        return QString();
+    return FilterPlugins::self()->name (desktopEntryName);
 }
 
 
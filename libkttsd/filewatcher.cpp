@@ -0,0 +1,102 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Watches the files filters read their data from.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// FileWatcher includes.
+#include "filewatcher.h"
+#include "filewatcher.moc"
+
+// Qt includes.
+#include <QtCore/QTimer>
+
+// KDE includes.
+#include <kdebug.h>
+#include <kdirwatch.h>
+#include <kglobal.h>
+
+class FileWatcherSingleton
+{
+public:
+    FileWatcher self;
+};
+
+K_GLOBAL_STATIC(FileWatcherSingleton, s_fileWatcher)
+
+FileWatcher *FileWatcher::self()
+{
+    return &s_fileWatcher->self;
+}
+
+FileWatcher::FileWatcher() :
+    m_dirWatch(new KDirWatch(this)),
+    m_timer(new QTimer(this))
+{
+    connect(m_dirWatch, SIGNAL(dirty(QString)), this, SLOT(slotDirty(QString)));
+    connect(m_dirWatch, SIGNAL(created(QString)), this, SLOT(slotDirty(QString)));
+    connect(m_dirWatch, SIGNAL(deleted(QString)), this, SLOT(slotDirty(QString)));
+    m_timer->setSingleShot(true);
+    m_timer->setInterval(300);
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(slotTimeout()));
+}
+
+FileWatcher::~FileWatcher()
+{
+}
+
+void FileWatcher::addFile(const QString &path)
+{
+    if (path.isEmpty())
+        return;
+    if (m_users[path]++ == 0)
+        m_dirWatch->addFile(path);
+}
+
+void FileWatcher::removeFile(const QString &path)
+{
+    QHash<QString, int>::iterator it = m_users.find(path);
+    if (it == m_users.end())
+        return;
+    if (--it.value() == 0)
+    {
+        m_users.erase(it);
+        m_dirWatch->removeFile(path);
+        m_changed.remove(path);
+    }
+}
+
+void FileWatcher::slotDirty(const QString &path)
+{
+    if (!m_users.contains(path))
+        return;
+    m_changed.insert(path);
+    m_timer->start();
+}
+
+void FileWatcher::slotTimeout()
+{
+    const QSet<QString> changed = m_changed;
+    m_changed.clear();
+    foreach (const QString &path, changed)
+    {
+        kDebug() << "FileWatcher: changed " << path;
+        emit fileChanged(path);
+    }
+}
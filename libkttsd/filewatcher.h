@@ -0,0 +1,91 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Watches the files filters read their data from.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+// Qt includes.
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+
+// KDE includes.
+#include <kdemacros.h>
+
+class KDirWatch;
+class QTimer;
+
+/**
+ * @class FileWatcher
+ *
+ * One watch for all the files filters read their data from, such as word
+ * lists and stylesheets.  A file registered by several filters is watched
+ * once.  Editors often write a file in several steps, so the notifications
+ * for a file are collected and @ref fileChanged is emitted once they stop.
+ */
+class KDE_EXPORT FileWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * The watcher.
+     */
+    static FileWatcher *self();
+
+    ~FileWatcher();
+
+    /**
+     * Starts watching a file.  Each call must be matched by a call to
+     * @ref removeFile.
+     */
+    void addFile(const QString &path);
+
+    /**
+     * Stops watching a file once all that added it have removed it.
+     */
+    void removeFile(const QString &path);
+
+signals:
+    /**
+     * Emitted when a watched file was changed, created or deleted.
+     */
+    void fileChanged(const QString &path);
+
+private slots:
+    void slotDirty(const QString &path);
+    void slotTimeout();
+
+private:
+    FileWatcher();
+
+    KDirWatch *m_dirWatch;
+    // Number of users of each watched file.
+    QHash<QString, int> m_users;
+    // Files changed since the timer was started.
+    QSet<QString> m_changed;
+    QTimer *m_timer;
+
+    friend class FileWatcherSingleton;
+};
+
+#endif      // FILEWATCHER_H
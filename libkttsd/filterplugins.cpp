@@ -0,0 +1,135 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Registry of the installed filter plugins.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// FilterPlugins includes.
+#include "filterplugins.h"
+#include "filterplugins.moc"
+
+// KDE includes.
+#include <kdebug.h>
+#include <kglobal.h>
+#include <kpluginloader.h>
+#include <kservicetypetrader.h>
+#include <ksycoca.h>
+
+class FilterPluginsSingleton
+{
+public:
+    FilterPlugins self;
+};
+
+K_GLOBAL_STATIC(FilterPluginsSingleton, s_filterPlugins)
+
+FilterPlugins *FilterPlugins::self()
+{
+    return &s_filterPlugins->self;
+}
+
+FilterPlugins::FilterPlugins() :
+    m_offersValid(false)
+{
+    connect(KSycoca::self(), SIGNAL(databaseChanged(QStringList)),
+        this, SLOT(slotDatabaseChanged(QStringList)));
+}
+
+FilterPlugins::~FilterPlugins()
+{
+}
+
+void FilterPlugins::ensureOffers()
+{
+    if (m_offersValid)
+        return;
+    m_offers = KServiceTypeTrader::self()->query(QLatin1String("Jovie/FilterPlugin"));
+    m_byDesktopEntryName.clear();
+    m_desktopEntryNameByName.clear();
+    foreach (const KService::Ptr &offer, m_offers)
+    {
+        m_byDesktopEntryName.insert(offer->desktopEntryName(), offer);
+        m_desktopEntryNameByName.insert(offer->name(), offer->desktopEntryName());
+    }
+    m_offersValid = true;
+}
+
+void FilterPlugins::slotDatabaseChanged(const QStringList &changedResources)
+{
+    if (changedResources.contains(QLatin1String("services")) ||
+        changedResources.contains(QLatin1String("servicetypes")))
+    {
+        kDebug() << "FilterPlugins: services changed, looking up the filter plugins again";
+        m_offersValid = false;
+        m_offers.clear();
+        m_byDesktopEntryName.clear();
+        m_desktopEntryNameByName.clear();
+        // A plugin may have been updated or removed.  Libraries are not
+        // unloaded, so instances created earlier stay valid.
+        m_factories.clear();
+    }
+}
+
+KService::List FilterPlugins::offers()
+{
+    ensureOffers();
+    return m_offers;
+}
+
+KService::Ptr FilterPlugins::service(const QString &desktopEntryName)
+{
+    ensureOffers();
+    return m_byDesktopEntryName.value(desktopEntryName);
+}
+
+QString FilterPlugins::desktopEntryName(const QString &name)
+{
+    ensureOffers();
+    return m_desktopEntryNameByName.value(name);
+}
+
+QString FilterPlugins::name(const QString &desktopEntryName)
+{
+    KService::Ptr offer = service(desktopEntryName);
+    return offer ? offer->name() : QString();
+}
+
+KPluginFactory *FilterPlugins::factory(const QString &desktopEntryName)
+{
+    QHash<QString, KPluginFactory *>::const_iterator it = m_factories.constFind(desktopEntryName);
+    if (it != m_factories.constEnd())
+        return it.value();
+
+    KService::Ptr offer = service(desktopEntryName);
+    if (!offer)
+    {
+        kDebug() << "FilterPlugins::factory: no filter plugin named" << desktopEntryName;
+        return 0;
+    }
+    KPluginLoader loader(offer->library());
+    KPluginFactory *pluginFactory = loader.factory();
+    if (!pluginFactory)
+    {
+        kDebug() << "FilterPlugins::factory: unable to load" << offer->library()
+            << ":" << loader.errorString();
+        return 0;
+    }
+    m_factories.insert(desktopEntryName, pluginFactory);
+    return pluginFactory;
+}
@@ -0,0 +1,114 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Registry of the installed filter plugins.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef FILTERPLUGINS_H
+#define FILTERPLUGINS_H
+
+// Qt includes.
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QStringList>
+
+// KDE includes.
+#include <kdemacros.h>
+#include <kpluginfactory.h>
+#include <kservice.h>
+
+/**
+ * @class FilterPlugins
+ *
+ * The installed Jovie/FilterPlugin services, looked up once and indexed by
+ * DesktopEntryName and by translated name.
+ *
+ * The factory of a plugin is resolved the first time it is needed and kept,
+ * so further instances of the plugin only cost a call to the factory.  The
+ * registry is rebuilt when the sycoca database reports changed services.
+ */
+class KDE_EXPORT FilterPlugins : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * The registry.
+     */
+    static FilterPlugins *self();
+
+    ~FilterPlugins();
+
+    /**
+     * All installed filter plugins.
+     */
+    KService::List offers();
+
+    /**
+     * The plugin with a DesktopEntryName.  Null if not installed.
+     */
+    KService::Ptr service(const QString &desktopEntryName);
+
+    /**
+     * Converts a translated plugin name (Name= line of the .desktop file) to the
+     * DesktopEntryName.  QString() if not found.
+     */
+    QString desktopEntryName(const QString &name);
+
+    /**
+     * Converts a DesktopEntryName to the translated plugin name.  QString() if not found.
+     */
+    QString name(const QString &desktopEntryName);
+
+    /**
+     * The factory of the plugin with a DesktopEntryName.  Null if the plugin
+     * is not installed or its library cannot be loaded.
+     */
+    KPluginFactory *factory(const QString &desktopEntryName);
+
+    /**
+     * Creates an instance of a plugin.
+     * @param desktopEntryName  DesktopEntryName of the plugin.
+     * @param parent            Parent of the instance.
+     * @return                  The instance, or null.  T is KttsFilterProc or KttsFilterConf.
+     */
+    template<class T>
+    T *create(const QString &desktopEntryName, QObject *parent = 0)
+    {
+        KPluginFactory *pluginFactory = factory(desktopEntryName);
+        return pluginFactory ? pluginFactory->create<T>(parent) : 0;
+    }
+
+private slots:
+    void slotDatabaseChanged(const QStringList &changedResources);
+
+private:
+    FilterPlugins();
+    void ensureOffers();
+
+    bool m_offersValid;
+    KService::List m_offers;
+    QHash<QString, KService::Ptr> m_byDesktopEntryName;
+    QHash<QString, QString> m_desktopEntryNameByName;
+    QHash<QString, KPluginFactory *> m_factories;
+
+    friend class FilterPluginsSingleton;
+};
+
+#endif      // FILTERPLUGINS_H
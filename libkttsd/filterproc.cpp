@@ -66,6 +66,13 @@ bool KttsFilterProc::init(KConfig * /*config*/, const QString & /*configGroup*/)
  */
 /*virtual*/ bool KttsFilterProc::isSBD() { return false; }
 
+/**
+ * Returns True if this filter only chooses a talker, without changing the text.
+ * @param rule      Receives the rule of the filter.
+ * @return          True if this filter is a talker chooser.
+ */
+/*virtual*/ bool KttsFilterProc::talkerChooserRule(TalkerChooserRule* /*rule*/) { return false; }
+
 /**
  * Returns True if the plugin supports asynchronous processing,
  * i.e., supports asyncConvert method.
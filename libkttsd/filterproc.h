@@ -34,6 +34,7 @@
 
 class TalkerCode;
 class KConfig;
+struct TalkerChooserRule;
 
 class KDE_EXPORT KttsFilterProc : public QObject
 {
@@ -75,6 +76,16 @@ public:
      */
     virtual bool isSBD();
 
+    /**
+     * Returns True if this filter only chooses a talker, without changing the text.
+     * If so, the rule for choosing the talker is returned and FilterMgr evaluates
+     * it together with the rules of all the other talker choosers, instead of
+     * calling @ref convert .
+     * @param rule      Receives the rule of the filter.
+     * @return          True if this filter is a talker chooser.
+     */
+    virtual bool talkerChooserRule(TalkerChooserRule *rule);
+
      /**
       * Returns True if the plugin supports asynchronous processing,
       * i.e., supports asyncConvert method.
@@ -0,0 +1,212 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Checked private copies of the XSLT stylesheets filters apply.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// StylesheetCache includes.
+#include "stylesheetcache.h"
+#include "stylesheetcache.moc"
+
+// Qt includes.
+#include <QtCore/QFile>
+#include <QtCore/QtConcurrentRun>
+#include <QtXml/QDomDocument>
+
+// KDE includes.
+#include <kdebug.h>
+#include <kglobal.h>
+#include <kstandarddirs.h>
+
+// KTTS includes.
+#include "filewatcher.h"
+
+static const char xsltNamespace[] = "http://www.w3.org/1999/XSL/Transform";
+
+/* Results of copyStylesheet. */
+enum CopyResult
+{
+    Copied,                 /* the copy is good */
+    UseSource,              /* use the stylesheet itself */
+    Broken                  /* keep the last good copy */
+};
+
+/**
+ * Checks a stylesheet and copies it to @p target.  Runs in a worker thread.
+ */
+static int copyStylesheet(const QString &source, const QString &target)
+{
+    QFile file(source);
+    if (!file.open(QIODevice::ReadOnly))
+        return Broken;
+    const QByteArray data = file.readAll();
+    file.close();
+
+    QDomDocument doc;
+    if (!doc.setContent(data, true))
+        return Broken;
+    const QDomElement root = doc.documentElement();
+    if (root.namespaceURI() != QLatin1String(xsltNamespace) &&
+        root.attributeNS(QLatin1String(xsltNamespace), QLatin1String("version")).isEmpty())
+        return Broken;
+    if (doc.elementsByTagNameNS(QLatin1String(xsltNamespace), QLatin1String("import")).count() ||
+        doc.elementsByTagNameNS(QLatin1String(xsltNamespace), QLatin1String("include")).count())
+        return UseSource;
+
+    QFile copy(target);
+    if (!copy.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return UseSource;
+    const bool written = (copy.write(data) == data.size());
+    copy.close();
+    if (!written)
+    {
+        QFile::remove(target);
+        return UseSource;
+    }
+    return Copied;
+}
+
+class StylesheetCacheSingleton
+{
+public:
+    StylesheetCache self;
+};
+
+K_GLOBAL_STATIC(StylesheetCacheSingleton, s_stylesheetCache)
+
+StylesheetCache *StylesheetCache::self()
+{
+    return &s_stylesheetCache->self;
+}
+
+StylesheetCache::StylesheetCache()
+{
+    m_cacheDir = KStandardDirs::locateLocal("cache", QLatin1String("jovie/xslt/"));
+    connect(FileWatcher::self(), SIGNAL(fileChanged(QString)),
+        this, SLOT(slotFileChanged(QString)));
+}
+
+StylesheetCache::~StylesheetCache()
+{
+    foreach (Entry *entry, m_entries)
+    {
+        entry->watcher.waitForFinished();
+        removeCopies(entry);
+        delete entry;
+    }
+}
+
+void StylesheetCache::addStylesheet(const QString &path)
+{
+    if (path.isEmpty())
+        return;
+    Entry *&entry = m_entries[path];
+    if (!entry)
+    {
+        entry = new Entry;
+        connect(&entry->watcher, SIGNAL(finished()), this, SLOT(slotCopied()));
+        FileWatcher::self()->addFile(path);
+        startCopy(path, entry);
+    }
+    ++entry->users;
+}
+
+void StylesheetCache::removeStylesheet(const QString &path)
+{
+    Entry *entry = m_entries.value(path);
+    if (!entry || --entry->users > 0)
+        return;
+    m_entries.remove(path);
+    FileWatcher::self()->removeFile(path);
+    entry->watcher.waitForFinished();
+    removeCopies(entry);
+    delete entry;
+}
+
+QString StylesheetCache::stylesheetFile(const QString &path) const
+{
+    Entry *entry = m_entries.value(path);
+    if (!entry || entry->copy.isEmpty())
+        return path;
+    return entry->copy;
+}
+
+void StylesheetCache::slotFileChanged(const QString &path)
+{
+    Entry *entry = m_entries.value(path);
+    if (!entry)
+        return;
+    if (entry->watcher.isRunning())
+        entry->rerun = true;
+    else
+        startCopy(path, entry);
+}
+
+void StylesheetCache::startCopy(const QString &path, Entry *entry)
+{
+    // Each version gets its own name, so a job still reading the last one is not disturbed.
+    entry->target = m_cacheDir + QString::number(qHash(path), 16) + QLatin1Char('-') +
+        QString::number(++entry->generation) + QLatin1String(".xsl");
+    entry->rerun = false;
+    entry->watcher.setFuture(QtConcurrent::run(copyStylesheet, path, entry->target));
+}
+
+void StylesheetCache::slotCopied()
+{
+    QHash<QString, Entry *>::iterator it = m_entries.begin();
+    while (it != m_entries.end() && &it.value()->watcher != sender())
+        ++it;
+    if (it == m_entries.end())
+        return;
+    const QString path = it.key();
+    Entry *entry = it.value();
+
+    switch (entry->watcher.result())
+    {
+        case Copied:
+            if (!entry->previousCopy.isEmpty())
+                QFile::remove(entry->previousCopy);
+            entry->previousCopy = entry->copy;
+            entry->copy = entry->target;
+            emit stylesheetChanged(path);
+            break;
+        case UseSource:
+            if (!entry->previousCopy.isEmpty())
+                QFile::remove(entry->previousCopy);
+            entry->previousCopy = entry->copy;
+            entry->copy.clear();
+            emit stylesheetChanged(path);
+            break;
+        default:
+            kDebug() << "StylesheetCache: " << path << " is not a usable stylesheet, keeping the last good version";
+            break;
+    }
+    entry->target.clear();
+
+    if (entry->rerun)
+        startCopy(path, entry);
+}
+
+void StylesheetCache::removeCopies(Entry *entry)
+{
+    if (!entry->copy.isEmpty())
+        QFile::remove(entry->copy);
+    if (!entry->previousCopy.isEmpty())
+        QFile::remove(entry->previousCopy);
+}
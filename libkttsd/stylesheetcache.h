@@ -0,0 +1,115 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Checked private copies of the XSLT stylesheets filters apply.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef STYLESHEETCACHE_H
+#define STYLESHEETCACHE_H
+
+// Qt includes.
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QFutureWatcher>
+
+// KDE includes.
+#include <kdemacros.h>
+
+/**
+ * @class StylesheetCache
+ *
+ * Keeps a private copy of each stylesheet in use, which is what xsltproc is
+ * given.  The stylesheets are watched with @ref FileWatcher.  When one
+ * changes, the new version is parsed and copied in the background, and the
+ * copy only replaces the previous one if the stylesheet is well formed XSLT.
+ * A job always starts with a complete stylesheet, even while the user is
+ * saving it, and a broken edit leaves the last good version in use.
+ *
+ * Stylesheets that import or include others are not copied, since relative
+ * references would break; xsltproc is given the stylesheet itself.
+ *
+ * Only to be used from the main thread.
+ */
+class KDE_EXPORT StylesheetCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * The cache.
+     */
+    static StylesheetCache *self();
+
+    ~StylesheetCache();
+
+    /**
+     * Starts using a stylesheet.  Each call must be matched by a call to
+     * @ref removeStylesheet.
+     */
+    void addStylesheet(const QString &path);
+
+    /**
+     * Stops using a stylesheet.  Its copy is removed once nobody uses it.
+     */
+    void removeStylesheet(const QString &path);
+
+    /**
+     * The file to pass to xsltproc for a stylesheet.  Ask at the start of each
+     * job, so a new version is picked up between jobs.
+     * @param path              The stylesheet.
+     * @return                  The last good copy, or @p path if there is none yet.
+     */
+    QString stylesheetFile(const QString &path) const;
+
+signals:
+    /**
+     * Emitted when a new version of a stylesheet is in use.
+     */
+    void stylesheetChanged(const QString &path);
+
+private slots:
+    void slotFileChanged(const QString &path);
+    void slotCopied();
+
+private:
+    StylesheetCache();
+
+    struct Entry
+    {
+        Entry() : users(0), generation(0), rerun(false) {}
+
+        int users;
+        int generation;
+        QString copy;                       /* last good copy, if any */
+        QString previousCopy;               /* may still be read by a running job */
+        QString target;                     /* copy being made */
+        QFutureWatcher<int> watcher;
+        bool rerun;                         /* changed again while copying */
+    };
+
+    void startCopy(const QString &path, Entry *entry);
+    void removeCopies(Entry *entry);
+
+    QString m_cacheDir;
+    QHash<QString, Entry *> m_entries;
+
+    friend class StylesheetCacheSingleton;
+};
+
+#endif      // STYLESHEETCACHE_H
@@ -0,0 +1,47 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  The rule of a Talker Chooser filter.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef TALKERCHOOSERRULE_H
+#define TALKERCHOOSERRULE_H
+
+// Qt includes.
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+// KTTS includes.
+#include "talkercode.h"
+
+/**
+ * When a Talker Chooser filter picks a talker.
+ *
+ * The rule applies when the text matches @ref matchRegExp and the appId contains
+ * one of @ref appIds .  An empty criterion always matches.
+ */
+struct TalkerChooserRule
+{
+    QString name;           /* user's name for the filter, for reporting */
+    QString matchRegExp;    /* regular expression the text must match */
+    QStringList appIds;     /* the appId must contain one of these */
+    TalkerCode talkerCode;  /* talker chosen when the rule applies */
+};
+
+#endif      // TALKERCHOOSERRULE_H
@@ -24,10 +24,11 @@
 
 // TalkerCode includes.
 #include "talkercode.h"
+#include "talkermatcher.h"
 
 // Qt includes.
-#include <QtCore/QVector>
-#include <QtXml/QDomDocument>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
 
 // KDE includes.
 #include <kconfig.h>
@@ -39,11 +40,35 @@
 
 #include <libspeechd.h>
 
-class TalkerCodePrivate
+class TalkerCodePrivate : public QSharedData
 {
 public:
-    TalkerCodePrivate(TalkerCode *parent)
-        :q(parent)
+    TalkerCodePrivate() :
+        voiceType(SPD_MALE1),
+        volume(0),
+        rate(0),
+        pitch(0),
+        punctuation(SPD_PUNCT_NONE),
+        voiceHash(0),
+        voice(0),
+        interned(false)
+    {
+    }
+
+    TalkerCodePrivate(const TalkerCodePrivate &other) :
+        QSharedData(other),
+        name(other.name),
+        language(other.language),
+        voiceType(other.voiceType),
+        volume(other.volume),
+        rate(other.rate),
+        pitch(other.pitch),
+        voiceName(other.voiceName),
+        outputModule(other.outputModule),
+        punctuation(other.punctuation),
+        voiceHash(0),
+        voice(0),
+        interned(false)
     {
     }
 
@@ -51,6 +76,31 @@ public:
     {
     }
 
+    uint computeVoiceHash() const
+    {
+        uint h = qHash(language);
+        h = h * 31 + qHash(voiceName);
+        h = h * 31 + qHash(outputModule);
+        h = h * 31 + uint(voiceType);
+        h = h * 31 + uint(volume);
+        h = h * 31 + uint(rate);
+        h = h * 31 + uint(pitch);
+        h = h * 31 + uint(punctuation);
+        return h;
+    }
+
+    bool sameVoice(const TalkerCodePrivate &other) const
+    {
+        return language == other.language &&
+               voiceType == other.voiceType &&
+               rate == other.rate &&
+               volume == other.volume &&
+               pitch == other.pitch &&
+               voiceName == other.voiceName &&
+               outputModule == other.outputModule &&
+               punctuation == other.punctuation;
+    }
+
     QString name;           /* name="xxx"        */
     QString language;       /* lang="xx"         */
     int voiceType;          /* voiceType="xxx"   */
@@ -60,19 +110,347 @@ public:
     QString voiceName;      /* voiceName="xxx"   */
     QString outputModule;   /* synthesizer="xxx" */
     int punctuation;        /* punctuation="xxx" */
-    TalkerCode *q;
 
+    /* Hash of the voice attributes.  Only valid once interned. */
+    uint voiceHash;
+    /* The first interned entry with the same voice.  Only valid once interned. */
+    const TalkerCodePrivate *voice;
+    /* True if this is an entry of the intern table.  Set before the entry is
+       shared, under the table lock; interned entries are never modified. */
+    bool interned;
+};
+
+/**
+ * Table of interned TalkerCodePrivate objects.
+ *
+ * Talker codes are parsed once per distinct talker code string and then shared.
+ * Entries that differ only in name point at the same voice entry, since
+ * equality ignores the name.  The table holds a reference to each of its
+ * entries.  It is bounded, codes created after it is full simply stay private
+ * and are compared field by field.
+ */
+class TalkerCodeTable
+{
+public:
+    enum { MaxEntries = 1024 };
+
+    ~TalkerCodeTable()
+    {
+        foreach (TalkerCodePrivate *entry, entries)
+            if (!entry->ref.deref())
+                delete entry;
+    }
+
+    /* Finds the interned entry equal to p (name included), interning p if there
+       is none.  p must not be shared yet.  Called with the mutex held. */
+    TalkerCodePrivate *findOrInsert(TalkerCodePrivate *p)
+    {
+        uint h = p->computeVoiceHash();
+        const TalkerCodePrivate *voice = 0;
+        QMultiHash<uint, TalkerCodePrivate*>::const_iterator it = entries.constFind(h);
+        for (; it != entries.constEnd() && it.key() == h; ++it)
+        {
+            if (!it.value()->sameVoice(*p))
+                continue;
+            if (it.value()->name == p->name)
+                return it.value();
+            voice = it.value()->voice;
+        }
+        if (entries.count() >= MaxEntries)
+            return p;
+        p->voiceHash = h;
+        p->voice = voice ? voice : p;
+        p->interned = true;
+        p->ref.ref();
+        entries.insert(h, p);
+        return p;
+    }
 
+    QMutex mutex;
+    /* Interned entries keyed by the talker code string they were parsed from. */
+    QHash<QString, TalkerCodePrivate*> byCode;
+    /* All interned entries keyed by their voice hash. */
+    QMultiHash<uint, TalkerCodePrivate*> entries;
 };
 
+K_GLOBAL_STATIC(TalkerCodeTable, s_talkerCodeTable)
+
+/**
+ * Parser for the talker code grammar:
+ *
+ *   <voice name="..." lang="..." outputModule="..." voiceName="..." voiceType="n">
+ *       <prosody volume="n" rate="n" pitch="n" punctuation="n"/>
+ *   </voice>
+ *
+ * Works directly on the characters of the code.  The only allocations made
+ * are for the string attributes stored in the result.
+ */
+class TalkerCodeParser
+{
+public:
+    TalkerCodeParser(const QString &code) :
+        m_pos(code.unicode()),
+        m_end(code.unicode() + code.length())
+    {
+    }
+
+    void parse(TalkerCodePrivate *p)
+    {
+        bool inVoice = false;
+        bool gotVoice = false;
+        bool gotProsody = false;
+        while (skipTo(QLatin1Char('<')))
+        {
+            ++m_pos;
+            if (m_pos == m_end)
+                break;
+            if (*m_pos == QLatin1Char('/'))
+            {
+                // Closing tag.
+                const QChar *name = ++m_pos;
+                int len = scanName();
+                if (equals(name, len, "voice"))
+                    inVoice = false;
+                skipTo(QLatin1Char('>'));
+                continue;
+            }
+            if (*m_pos == QLatin1Char('?') || *m_pos == QLatin1Char('!'))
+            {
+                // Processing instruction, comment or doctype.
+                skipTo(QLatin1Char('>'));
+                continue;
+            }
+            const QChar *name = m_pos;
+            int len = scanName();
+            bool isVoice = !gotVoice && equals(name, len, "voice");
+            bool isProsody = inVoice && !gotProsody && equals(name, len, "prosody");
+            bool empty = false;
+            const QChar *attrName;
+            int attrLen;
+            const QChar *value;
+            int valueLen;
+            while (nextAttribute(&attrName, &attrLen, &value, &valueLen, &empty))
+            {
+                if (isVoice)
+                    voiceAttribute(p, attrName, attrLen, value, valueLen);
+                else if (isProsody)
+                    prosodyAttribute(p, attrName, attrLen, value, valueLen);
+            }
+            if (isVoice)
+            {
+                gotVoice = true;
+                inVoice = !empty;
+            }
+            if (isProsody)
+                gotProsody = true;
+        }
+        if (!gotVoice)
+            kDebug() << "got a voice with no voice tag";
+        else if (!gotProsody)
+            kDebug() << "got a voice with no prosody tag";
+    }
+
+private:
+    static bool isSpace(QChar c)
+    {
+        return c == QLatin1Char(' ') || c == QLatin1Char('\t') ||
+               c == QLatin1Char('\n') || c == QLatin1Char('\r');
+    }
+
+    static bool equals(const QChar *s, int len, const char *latin1)
+    {
+        int i = 0;
+        for (; i < len; ++i)
+        {
+            if (!latin1[i] || s[i].unicode() != ushort(uchar(latin1[i])))
+                return false;
+        }
+        return latin1[i] == 0;
+    }
+
+    bool skipTo(QChar c)
+    {
+        while (m_pos < m_end && *m_pos != c)
+            ++m_pos;
+        return m_pos < m_end;
+    }
+
+    void skipSpaces()
+    {
+        while (m_pos < m_end && isSpace(*m_pos))
+            ++m_pos;
+    }
+
+    int scanName()
+    {
+        const QChar *start = m_pos;
+        while (m_pos < m_end && !isSpace(*m_pos) && *m_pos != QLatin1Char('=') &&
+               *m_pos != QLatin1Char('/') && *m_pos != QLatin1Char('>'))
+            ++m_pos;
+        return m_pos - start;
+    }
+
+    // Reads the next attribute of the current tag.  Returns false at the end of the tag.
+    bool nextAttribute(const QChar **name, int *nameLen, const QChar **value, int *valueLen, bool *empty)
+    {
+        forever
+        {
+            skipSpaces();
+            if (m_pos >= m_end)
+                return false;
+            if (*m_pos == QLatin1Char('>'))
+            {
+                ++m_pos;
+                return false;
+            }
+            if (*m_pos == QLatin1Char('/'))
+            {
+                *empty = true;
+                ++m_pos;
+                continue;
+            }
+            *name = m_pos;
+            *nameLen = scanName();
+            if (*nameLen == 0)
+            {
+                // Garbage, skip it.
+                ++m_pos;
+                continue;
+            }
+            skipSpaces();
+            if (m_pos >= m_end || *m_pos != QLatin1Char('='))
+                continue;
+            ++m_pos;
+            skipSpaces();
+            if (m_pos >= m_end)
+                return false;
+            QChar quote = *m_pos;
+            if (quote != QLatin1Char('"') && quote != QLatin1Char('\''))
+                continue;
+            *value = ++m_pos;
+            if (!skipTo(quote))
+                return false;
+            *valueLen = m_pos - *value;
+            ++m_pos;
+            return true;
+        }
+    }
+
+    static QString toString(const QChar *s, int len)
+    {
+        QString str(s, len);
+        if (str.contains(QLatin1Char('&')))
+        {
+            str.replace(QLatin1String("&quot;"), QLatin1String("\""));
+            str.replace(QLatin1String("&apos;"), QLatin1String("'"));
+            str.replace(QLatin1String("&lt;"), QLatin1String("<"));
+            str.replace(QLatin1String("&gt;"), QLatin1String(">"));
+            str.replace(QLatin1String("&amp;"), QLatin1String("&"));
+        }
+        return str;
+    }
+
+    static int toInt(const QChar *s, int len, int defaultValue)
+    {
+        while (len > 0 && isSpace(*s))
+        {
+            ++s;
+            --len;
+        }
+        while (len > 0 && isSpace(s[len - 1]))
+            --len;
+        bool negative = false;
+        if (len > 0 && (*s == QLatin1Char('-') || *s == QLatin1Char('+')))
+        {
+            negative = (*s == QLatin1Char('-'));
+            ++s;
+            --len;
+        }
+        if (len <= 0 || len > 9)
+            return defaultValue;
+        int value = 0;
+        for (int i = 0; i < len; ++i)
+        {
+            ushort c = s[i].unicode();
+            if (c < '0' || c > '9')
+                return defaultValue;
+            value = value * 10 + (c - '0');
+        }
+        return negative ? -value : value;
+    }
+
+    static void voiceAttribute(TalkerCodePrivate *p, const QChar *name, int len,
+                               const QChar *value, int valueLen)
+    {
+        if (equals(name, len, "name"))
+            p->name = toString(value, valueLen);
+        else if (equals(name, len, "lang"))
+            p->language = toString(value, valueLen);
+        else if (equals(name, len, "outputModule"))
+            p->outputModule = toString(value, valueLen);
+        else if (equals(name, len, "voiceName"))
+            p->voiceName = toString(value, valueLen);
+        else if (equals(name, len, "voiceType"))
+            p->voiceType = toInt(value, valueLen, SPD_MALE1);
+    }
+
+    static void prosodyAttribute(TalkerCodePrivate *p, const QChar *name, int len,
+                                 const QChar *value, int valueLen)
+    {
+        if (equals(name, len, "volume"))
+            p->volume = toInt(value, valueLen, 0);
+        else if (equals(name, len, "rate"))
+            p->rate = toInt(value, valueLen, 0);
+        else if (equals(name, len, "pitch"))
+            p->pitch = toInt(value, valueLen, 0);
+        else if (equals(name, len, "punctuation"))
+            p->punctuation = toInt(value, valueLen, SPD_PUNCT_NONE); // Default to no punctuation
+    }
+
+    const QChar *m_pos;
+    const QChar *m_end;
+};
+
+/**
+ * Returns the interned TalkerCodePrivate for a talker code string, parsing
+ * the string only if it has not been seen before.
+ */
+static TalkerCodePrivate *internTalkerCode(const QString &code)
+{
+    if (s_talkerCodeTable.isDestroyed())
+    {
+        TalkerCodePrivate *p = new TalkerCodePrivate();
+        TalkerCodeParser(code).parse(p);
+        return p;
+    }
+    TalkerCodeTable *table = s_talkerCodeTable;
+    QMutexLocker locker(&table->mutex);
+    TalkerCodePrivate *p = table->byCode.value(code);
+    if (p)
+        return p;
+    p = new TalkerCodePrivate();
+    TalkerCodeParser(code).parse(p);
+    TalkerCodePrivate *entry = table->findOrInsert(p);
+    if (entry != p)
+    {
+        delete p;
+        p = entry;
+    }
+    if (p->interned && table->byCode.count() < TalkerCodeTable::MaxEntries)
+        table->byCode.insert(code, p);
+    return p;
+}
+
 /**
  * Constructor.
  */
 TalkerCode::TalkerCode(const QString &code/*=QString()*/, bool normal /*=false*/)
-:d(new TalkerCodePrivate(this))
 {
+    Q_UNUSED(normal);
     if (!code.isEmpty())
-        parseTalkerCode(code);
+        d = internTalkerCode(code);
+    else
+        d = new TalkerCodePrivate();
     //if (normal)
     //    normalize();
 }
@@ -81,17 +459,8 @@ TalkerCode::TalkerCode(const QString &code/*=QString()*/, bool normal /*=false*/
  * Copy Constructor.
  */
 TalkerCode::TalkerCode(const TalkerCode& other)
-:d(new TalkerCodePrivate(this))
+:d(other.d)
 {
-    d->name = other.name();
-    d->language = other.language();
-    d->voiceType = other.voiceType();
-    d->volume = other.volume();
-    d->rate = other.rate();
-    d->pitch = other.pitch();
-    d->voiceName = other.voiceName();
-    d->outputModule = other.outputModule();
-    d->punctuation = other.punctuation();
 }
 
 /**
@@ -99,23 +468,21 @@ TalkerCode::TalkerCode(const TalkerCode& other)
  */
 TalkerCode::~TalkerCode()
 {
-    delete d;
 }
 
 TalkerCode &TalkerCode::operator=(const TalkerCode &other)
 {
-    d->name = other.name();
-    d->language = other.language();
-    d->voiceType = other.voiceType();
-    d->volume = other.volume();
-    d->rate = other.rate();
-    d->pitch = other.pitch();
-    d->voiceName = other.voiceName();
-    d->outputModule = other.outputModule();
-    d->punctuation = other.punctuation();
+    d = other.d;
     return *this;
 }
 
+void TalkerCode::detach()
+{
+    // interned never changes once d is shared, so it can be read unlocked.
+    if (d->interned || d->ref != 1)
+        d = new TalkerCodePrivate(*d);
+}
+
 TalkerCode::TalkerCodeList TalkerCode::loadTalkerCodesFromConfig(KConfig* c)
 {
     TalkerCodeList list;
@@ -210,47 +577,56 @@ QString TalkerCode::punctuationName() const
 
 void TalkerCode::setPunctuation(int value)
 {
+    detach();
     d->punctuation=value;
 }
 
 
 void TalkerCode::setName(const QString &name)
 {
+    detach();
     d->name = name;
 }
 
 void TalkerCode::setLanguage(const QString &language)
 {
+    detach();
     d->language = language;
 }
 
 void TalkerCode::setVoiceType(int voiceType)
 {
+    detach();
     d->voiceType = voiceType;
 }
 
 void TalkerCode::setVolume(int volume)
 {
+    detach();
     d->volume = volume;
 }
 
 void TalkerCode::setRate(int rate)
 {
+    detach();
     d->rate = rate;
 }
 
 void TalkerCode::setPitch(int pitch)
 {
+    detach();
     d->pitch = pitch;
 }
 
 void TalkerCode::setVoiceName(const QString &voiceName)
 {
+    detach();
     d->voiceName = voiceName;
 }
 
 void TalkerCode::setOutputModule(const QString &moduleName)
 {
+    detach();
     d->outputModule = moduleName;
 }
 
@@ -259,7 +635,10 @@ void TalkerCode::setOutputModule(const QString &moduleName)
  */
 void TalkerCode::setTalkerCode(const QString& code)
 {
-    parseTalkerCode(code);
+    if (!code.isEmpty())
+        d = internTalkerCode(code);
+    else
+        d = new TalkerCodePrivate();
 }
 
 
@@ -369,55 +748,6 @@ QString TalkerCode::translatedVoiceType(int voiceType)
     return language;
 }
 
-/**
- * Given a talker code, parses out the attributes.
- * @param talkerCode       The talker code.
- */
-void TalkerCode::parseTalkerCode(const QString &talkerCode)
-{
-    QDomDocument doc;
-    doc.setContent(talkerCode);
-
-    QDomElement voice = doc.firstChildElement(QLatin1String( "voice" ));
-    if (!voice.isNull())
-    {
-        d->name = voice.attribute(QLatin1String( "name" ));
-        d->language = voice.attribute(QLatin1String( "lang" ));
-        d->outputModule = voice.attribute(QLatin1String( "outputModule" ));
-        d->voiceName = voice.attribute(QLatin1String( "voiceName" ));
-        bool result = false;
-        d->voiceType = voice.attribute(QLatin1String( "voiceType" )).toInt(&result);
-        if (!result)
-            d->voiceType = 1;
-
-        QDomElement prosody = voice.firstChildElement(QLatin1String( "prosody" ));
-        if (!prosody.isNull())
-        {
-            bool result = false;
-            d->volume = prosody.attribute(QLatin1String( "volume" )).toInt(&result);
-            if (!result)
-                d->volume = 0;
-            d->rate = prosody.attribute(QLatin1String( "rate" )).toInt(&result);
-            if (!result)
-                d->rate = 0;
-            d->pitch = prosody.attribute(QLatin1String( "pitch" )).toInt(&result);
-            if (!result)
-                d->pitch = 0;
-            d->punctuation = prosody.attribute(QLatin1String("punctuation")).toInt(&result);
-            if (!result)
-                d->punctuation = SPD_PUNCT_NONE; // Default to no punctuation
-        }
-        else
-        {
-            kDebug() << "got a voice with no prosody tag";
-        }
-    }
-    else
-    {
-        kDebug() << "got a voice with no voice tag";
-    }
-}
-
 /**
  * Given a list of parsed talker codes and a desired talker code, finds the closest
  * matching talker in the list.
@@ -433,85 +763,9 @@ void TalkerCode::parseTalkerCode(const QString &talkerCode)
     bool assumeDefaultLang)
 {
     // kDebug() << "TalkerCode::findClosestMatchingTalker: matching on talker code " << talker;
-    // If nothing to match on, winner is top in the list.
-    if (talker.isEmpty()) return 0;
-    // Parse the given talker.
-    TalkerCode parsedTalkerCode(talker);
-    // If no language code specified, use the language code of the default talker.
-    if (assumeDefaultLang)
-    {
-        if (parsedTalkerCode.language().isEmpty()) parsedTalkerCode.setLanguage(
-            talkers[0].language());
-    }
-    // The talker that matches on the most priority attributes wins.
-    int talkersCount = int(talkers.count());
-    QVector<int> priorityMatch(talkersCount);
-    for (int ndx = 0; ndx < talkersCount; ++ndx)
-    {
-        priorityMatch[ndx] = 0;
-        // kDebug() << "Comparing language code " << parsedTalkerCode.languageCode() << " to " << d->loadedPlugIns[ndx].parsedTalkerCode.languageCode();
-    }
-    // Determine the maximum number of priority attributes that were matched.
-    int maxPriority = -1;
-    for (int ndx = 0; ndx < talkersCount; ++ndx)
-    {
-        if (priorityMatch[ndx] > maxPriority) maxPriority = priorityMatch[ndx];
-    }
-    // Find the talker(s) that matched on most priority attributes.
-    int winnerCount = 0;
-    int winner = -1;
-    for (int ndx = 0; ndx < talkersCount; ++ndx)
-    {
-        if (priorityMatch[ndx] == maxPriority)
-        {
-            ++winnerCount;
-            winner = ndx;
-        }
-    }
-    // kDebug() << "Priority phase: winnerCount = " << winnerCount
-    //     << " winner = " << winner
-    //     << " maxPriority = " << maxPriority << endl;
-    // If a tie, the one that matches on the most priority and preferred attributes wins.
-    // If there is still a tie, the one nearest the top of the kttsmgr display
-    // (first configured) will be chosen.
-    if (winnerCount > 1)
-    {
-        QVector<int> preferredMatch(talkersCount);
-        for (int ndx = 0; ndx < talkersCount; ++ndx)
-        {
-            preferredMatch[ndx] = 0;
-            if (priorityMatch[ndx] == maxPriority)
-            {
-            }
-        }
-        // Determine the maximum number of preferred attributes that were matched.
-        int maxPreferred = -1;
-        for (int ndx = 0; ndx < talkersCount; ++ndx)
-        {
-            if (preferredMatch[ndx] > maxPreferred) maxPreferred = preferredMatch[ndx];
-        }
-        winner = -1;
-        winnerCount = 0;
-        // Find the talker that matched on most priority and preferred attributes.
-        // Work bottom to top so topmost wins in a tie.
-        for (int ndx = talkersCount-1; ndx >= 0; --ndx)
-        {
-            if (priorityMatch[ndx] == maxPriority)
-            {
-                if (preferredMatch[ndx] == maxPreferred)
-                {
-                    ++winnerCount;
-                    winner = ndx;
-                }
-            }
-        }
-        // kDebug() << "Preferred phase: winnerCount = " << winnerCount
-        //     << " winner = " << winner
-        //     << " maxPreferred = " << maxPreferred << endl;
-    }
+    int winner = TalkerMatcher(talkers).findClosest(talker, assumeDefaultLang);
     // If no winner found, use the first talker.
     if (winner < 0) winner = 0;
-    // kDebug() << "TalkerCode::findClosestMatchingTalker: returning winner = " << winner;
     return winner;
 }
 
@@ -527,26 +781,21 @@ void TalkerCode::parseTalkerCode(const QString &talkerCode)
     }
 }
 
-bool TalkerCode::operator==(TalkerCode &other) const
+bool TalkerCode::operator==(const TalkerCode &other) const
+{
+    if (d == other.d)
+        return true;
+    if (d->interned && other.d->interned)
+        return d->voice == other.d->voice;
+    return d->sameVoice(*other.d);
+}
+
+bool TalkerCode::operator!=(const TalkerCode &other) const
 {
-    return d->language == other.language() &&
-           d->voiceType == other.voiceType() &&
-           d->rate == other.rate() &&
-           d->volume == other.volume() &&
-           d->pitch == other.pitch() &&
-           d->voiceName == other.voiceName() &&
-           d->outputModule == other.outputModule() &&
-           d->punctuation == other.punctuation();
+    return !(*this == other);
 }
 
-bool TalkerCode::operator!=(TalkerCode &other) const
+uint TalkerCode::hash() const
 {
-    return d->language != other.language() ||
-           d->voiceType != other.voiceType() ||
-           d->rate != other.rate() ||
-           d->volume != other.volume() ||
-           d->pitch != other.pitch() ||
-           d->voiceName != other.voiceName() ||
-           d->outputModule != other.outputModule() ||
-           d->punctuation != other.punctuation();
+    return d->interned ? d->voiceHash : d->computeVoiceHash();
 }
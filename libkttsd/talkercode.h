@@ -29,6 +29,7 @@
 // Qt includes.
 #include <QtCore/QList>
 #include <QtCore/QString>
+#include <QtCore/QSharedDataPointer>
 
 // KDE includes.
 #include <kdemacros.h>
@@ -36,6 +37,16 @@
 class KConfig;
 class TalkerCodePrivate;
 
+/**
+ * @class TalkerCode
+ *
+ * TalkerCode is implicitly shared, so copying one is cheap.  Codes built
+ * from talker code strings are interned in a global table when they are
+ * constructed, and interned codes with the same voice share one voice entry,
+ * so comparing and hashing them is constant time and TalkerCode can be used
+ * as a QHash key.  Codes changed by a setter, or made once the table is
+ * full, are not interned and are compared field by field.
+ */
 class KDE_EXPORT TalkerCode
 {
     public:
@@ -56,8 +67,12 @@ class KDE_EXPORT TalkerCode
 
         TalkerCode &operator=(const TalkerCode &other);
 
-        bool operator==(TalkerCode &other) const;
-        bool operator!=(TalkerCode &other) const;
+        /**
+         * Two TalkerCodes are equal when they describe the same voice.
+         * The user given name is not compared.
+         */
+        bool operator==(const TalkerCode &other) const;
+        bool operator!=(const TalkerCode &other) const;
 
         typedef QList<TalkerCode> TalkerCodeList;
 
@@ -158,6 +173,9 @@ class KDE_EXPORT TalkerCode
          * @param assumeDefaultLang             If true, and desired talker code lacks a language code,
          *                                      the default language is assumed.
          * @return                              Index into talkers of the closest matching talker.
+         *
+         * This builds a TalkerMatcher for the list on every call.  Callers matching
+         * repeatedly against the same talkers should keep a TalkerMatcher instead.
          */
         static int findClosestMatchingTalker(
             const TalkerCodeList& talkers,
@@ -169,15 +187,22 @@ class KDE_EXPORT TalkerCode
          */
         static QString stripPrefer( const QString& code, bool& preferred);
 
+        /**
+         * Returns a hash of the voice attributes, i.e. everything but the name.
+         * Constant time for an interned code.
+         */
+        uint hash() const;
+
     private:
         /**
-         * Given a talker code, parses out the attributes.
-         * @param talkerCode       The talker code.
+         * Makes d unshared before it is modified.
          */
-        void parseTalkerCode(const QString &talkerCode);
+        void detach();
 
-        TalkerCodePrivate * const d;
+        QExplicitlySharedDataPointer<TalkerCodePrivate> d;
 
 };
 
+inline uint qHash(const TalkerCode &talkerCode) { return talkerCode.hash(); }
+
 #endif      // TALKERCODE_H
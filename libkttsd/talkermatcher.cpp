@@ -0,0 +1,267 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Finds the configured talker that best matches a requested talker.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+// TalkerMatcher includes.
+#include "talkermatcher.h"
+
+// Qt includes.
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+#include <libspeechd.h>
+
+/**
+ * Attributes of a talker, or of a talker request, that take part in matching.
+ * Strings are lower case.  Empty strings and zero values mean "not specified".
+ */
+struct TalkerAttributes
+{
+    TalkerAttributes() : voiceType(0), gender(0) {}
+
+    QString language;       /* "en" of "en_GB" */
+    QString region;         /* "gb" of "en_GB" */
+    QString module;         /* speech-dispatcher output module */
+    QString voiceName;      /* synthesizer voice name */
+    int voiceType;          /* SPDVoiceType */
+    int gender;             /* 1 male, 2 female */
+};
+
+/* Weights of the attributes.  Each outweighs all of the ones below it. */
+enum MatchWeight
+{
+    RegionWeight = 16,
+    ModuleWeight = 8,
+    VoiceNameWeight = 4,
+    VoiceTypeWeight = 2,
+    GenderWeight = 1
+};
+
+static void splitLanguage(const QString &code, QString *language, QString *region)
+{
+    QString lang = code.trimmed().toLower();
+    if (lang.startsWith(QLatin1Char('*')))
+        lang = lang.mid(1);
+    // Drop charset and modifier, as in "en_GB.UTF-8@euro".
+    int end = lang.indexOf(QLatin1Char('.'));
+    if (end >= 0)
+        lang.truncate(end);
+    end = lang.indexOf(QLatin1Char('@'));
+    if (end >= 0)
+        lang.truncate(end);
+    int sep = lang.indexOf(QLatin1Char('_'));
+    if (sep < 0)
+        sep = lang.indexOf(QLatin1Char('-'));
+    if (sep >= 0)
+    {
+        *language = lang.left(sep);
+        *region = lang.mid(sep + 1);
+    }
+    else
+    {
+        *language = lang;
+        region->clear();
+    }
+}
+
+static int genderOfVoiceType(int voiceType)
+{
+    switch (voiceType)
+    {
+        case SPD_MALE1:
+        case SPD_MALE2:
+        case SPD_MALE3:
+        case SPD_CHILD_MALE:
+            return 1;
+        case SPD_FEMALE1:
+        case SPD_FEMALE2:
+        case SPD_FEMALE3:
+        case SPD_CHILD_FEMALE:
+            return 2;
+    }
+    return 0;
+}
+
+static TalkerAttributes talkerAttributes(const TalkerCode &code)
+{
+    TalkerAttributes attrs;
+    splitLanguage(code.language(), &attrs.language, &attrs.region);
+    attrs.module = code.outputModule().toLower();
+    attrs.voiceName = code.voiceName();
+    attrs.voiceType = code.voiceType();
+    attrs.gender = genderOfVoiceType(attrs.voiceType);
+    return attrs;
+}
+
+/**
+ * Extracts the attributes of a request.  Only attributes actually present in the
+ * request are set, so defaults filled in by TalkerCode do not bias the match.
+ */
+static TalkerAttributes requestAttributes(const QString &talker)
+{
+    TalkerAttributes attrs;
+    QString request = talker.trimmed();
+    if (!request.startsWith(QLatin1Char('<')))
+    {
+        // Just a language code.
+        splitLanguage(request, &attrs.language, &attrs.region);
+        return attrs;
+    }
+    TalkerCode code(request);
+    splitLanguage(code.language(), &attrs.language, &attrs.region);
+    attrs.module = code.outputModule().toLower();
+    attrs.voiceName = code.voiceName();
+    if (request.contains(QLatin1String("voiceType=")))
+    {
+        attrs.voiceType = code.voiceType();
+        attrs.gender = genderOfVoiceType(attrs.voiceType);
+    }
+    // Talker codes of older versions gave a gender instead of a voice type.
+    if (request.contains(QLatin1String("gender=\"female\"")))
+        attrs.gender = 2;
+    else if (request.contains(QLatin1String("gender=\"male\"")))
+        attrs.gender = 1;
+    return attrs;
+}
+
+class TalkerMatcherPrivate
+{
+public:
+    void buildIndex()
+    {
+        attributes.clear();
+        byLanguage.clear();
+        all.clear();
+        const int talkersCount = talkers.count();
+        attributes.reserve(talkersCount);
+        all.reserve(talkersCount);
+        for (int ndx = 0; ndx < talkersCount; ++ndx)
+        {
+            attributes.append(talkerAttributes(talkers.at(ndx)));
+            byLanguage[attributes.last().language].append(ndx);
+            all.append(ndx);
+        }
+    }
+
+    int score(const TalkerAttributes &request, int ndx) const
+    {
+        const TalkerAttributes &talker = attributes.at(ndx);
+        int score = 0;
+        if (!request.region.isEmpty() && request.region == talker.region)
+            score += RegionWeight;
+        if (!request.module.isEmpty() && request.module == talker.module)
+            score += ModuleWeight;
+        if (!request.voiceName.isEmpty() && request.voiceName == talker.voiceName)
+            score += VoiceNameWeight;
+        if (request.voiceType && request.voiceType == talker.voiceType)
+            score += VoiceTypeWeight;
+        if (request.gender && request.gender == talker.gender)
+            score += GenderWeight;
+        return score;
+    }
+
+    TalkerCode::TalkerCodeList talkers;
+    /* Attributes of each talker, parallel to talkers. */
+    QVector<TalkerAttributes> attributes;
+    /* Indexes of the talkers for each language, in list order. */
+    QHash<QString, QVector<int> > byLanguage;
+    /* Indexes of all talkers, used when the language is not known. */
+    QVector<int> all;
+};
+
+TalkerMatcher::TalkerMatcher(const TalkerCode::TalkerCodeList &talkers) :
+    d(new TalkerMatcherPrivate)
+{
+    setTalkers(talkers);
+}
+
+TalkerMatcher::TalkerMatcher(const TalkerMatcher &other) :
+    d(new TalkerMatcherPrivate(*other.d))
+{
+}
+
+TalkerMatcher::~TalkerMatcher()
+{
+    delete d;
+}
+
+TalkerMatcher &TalkerMatcher::operator=(const TalkerMatcher &other)
+{
+    *d = *other.d;
+    return *this;
+}
+
+void TalkerMatcher::setTalkers(const TalkerCode::TalkerCodeList &talkers)
+{
+    d->talkers = talkers;
+    d->buildIndex();
+}
+
+TalkerCode::TalkerCodeList TalkerMatcher::talkers() const
+{
+    return d->talkers;
+}
+
+int TalkerMatcher::count() const
+{
+    return d->talkers.count();
+}
+
+int TalkerMatcher::findClosest(const QString &talker, bool assumeDefaultLang) const
+{
+    if (d->talkers.isEmpty())
+        return -1;
+    // If nothing to match on, winner is top in the list.
+    if (talker.isEmpty())
+        return 0;
+
+    TalkerAttributes request = requestAttributes(talker);
+    // If no language code specified, use the language code of the default talker.
+    if (request.language.isEmpty() && assumeDefaultLang)
+        request.language = d->attributes.first().language;
+
+    // Only talkers speaking the language are candidates.  If there are none,
+    // the language cannot be honoured and every talker is a candidate.
+    const QVector<int> *candidates = &d->all;
+    if (!request.language.isEmpty())
+    {
+        QHash<QString, QVector<int> >::const_iterator it = d->byLanguage.constFind(request.language);
+        if (it != d->byLanguage.constEnd())
+            candidates = &it.value();
+    }
+
+    // Candidates are in list order, so only a strictly better score replaces
+    // the winner and the first configured talker wins a tie.
+    int winner = candidates->first();
+    int maxScore = -1;
+    const int candidatesCount = candidates->count();
+    for (int i = 0; i < candidatesCount; ++i)
+    {
+        const int ndx = candidates->at(i);
+        const int score = d->score(request, ndx);
+        if (score > maxScore)
+        {
+            maxScore = score;
+            winner = ndx;
+        }
+    }
+    return winner;
+}
@@ -0,0 +1,103 @@
+/***************************************************** vim:set ts=4 sw=4 sts=4:
+  Finds the configured talker that best matches a requested talker.
+  -------------------
+  Copyright:
+  (C) 2026 by the Jovie developers
+  -------------------
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************/
+
+#ifndef TALKERMATCHER_H
+#define TALKERMATCHER_H
+
+// Qt includes.
+#include <QtCore/QString>
+
+// KDE includes.
+#include <kdemacros.h>
+
+// KTTS includes.
+#include "talkercode.h"
+
+class TalkerMatcherPrivate;
+
+/**
+ * @class TalkerMatcher
+ *
+ * Matches requested talkers against a list of talkers.
+ *
+ * The attributes of every talker (language, region, output module, voice name,
+ * voice type and gender) are extracted once, when the list is set, and the
+ * talkers are indexed by language.  A match only looks at the talkers that
+ * speak the requested language, so its cost depends on the number of
+ * candidates for that language rather than on the number of talkers.
+ *
+ * Candidates are scored on the attributes the request specifies, in order of
+ * importance: region, output module, voice name, voice type and gender.
+ * On a tie the talker nearest the top of the list (first configured) wins.
+ */
+class KDE_EXPORT TalkerMatcher
+{
+public:
+    /**
+     * Constructor.
+     * @param talkers          The talkers to match against.
+     */
+    explicit TalkerMatcher(const TalkerCode::TalkerCodeList &talkers = TalkerCode::TalkerCodeList());
+
+    /**
+     * Copy Constructor.
+     */
+    TalkerMatcher(const TalkerMatcher &other);
+
+    /**
+     * Destructor.
+     */
+    ~TalkerMatcher();
+
+    TalkerMatcher &operator=(const TalkerMatcher &other);
+
+    /**
+     * Sets the talkers to match against and rebuilds the index.
+     */
+    void setTalkers(const TalkerCode::TalkerCodeList &talkers);
+
+    /**
+     * The talkers being matched against.
+     */
+    TalkerCode::TalkerCodeList talkers() const;
+
+    /**
+     * Number of talkers.
+     */
+    int count() const;
+
+    /**
+     * Finds the talker that best matches a requested talker.
+     * @param talker            The requested talker.  Either a talker code, or
+     *                          just a language code such as "en" or "en_GB".
+     * @param assumeDefaultLang If true, and the request lacks a language code,
+     *                          the language of the first talker is assumed.
+     * @return                  Index of the closest matching talker.
+     *                          -1 if there are no talkers.
+     */
+    int findClosest(const QString &talker, bool assumeDefaultLang = true) const;
+
+private:
+    TalkerMatcherPrivate *d;
+};
+
+#endif      // TALKERMATCHER_H
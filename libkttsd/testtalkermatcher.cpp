@@ -0,0 +1,80 @@
+#include <QtTest>
+#include "testtalkermatcher.h"
+#include "talkermatcher.h"
+
+static TalkerCode talker(const char *lang, const char *module, int voiceType)
+{
+    TalkerCode code;
+    code.setLanguage(QLatin1String(lang));
+    code.setOutputModule(QLatin1String(module));
+    code.setVoiceType(voiceType);
+    return code;
+}
+
+static TalkerCode::TalkerCodeList configuredTalkers()
+{
+    TalkerCode::TalkerCodeList list;
+    list << talker("en", "espeak", 1)       // 0
+         << talker("en_GB", "festival", 4)  // 1
+         << talker("de", "espeak", 1)       // 2
+         << talker("en_US", "espeak", 4)    // 3
+         << talker("de", "espeak", 2);      // 4
+    return list;
+}
+
+void TestTalkerMatcher::findClosest_data()
+{
+    QTest::addColumn<QString>("request");
+    QTest::addColumn<int>("winner");
+
+    QTest::newRow("empty") << QString() << 0;
+    QTest::newRow("language") << QString::fromAscii("en") << 0;
+    QTest::newRow("region") << QString::fromAscii("en_GB") << 1;
+    QTest::newRow("region with dash") << QString::fromAscii("en-us") << 3;
+    QTest::newRow("preferred language") << QString::fromAscii("*de") << 2;
+    QTest::newRow("unknown language") << QString::fromAscii("fr") << 0;
+    QTest::newRow("module") << QString::fromAscii("<voice lang=\"en\" outputModule=\"festival\"/>") << 1;
+    QTest::newRow("voice type") << QString::fromAscii("<voice lang=\"de\" voiceType=\"2\"/>") << 4;
+    QTest::newRow("default language") << QString::fromAscii("<voice voiceType=\"4\"/>") << 1;
+    QTest::newRow("legacy gender") << QString::fromAscii("<voice lang=\"en\" gender=\"female\"/>") << 1;
+    QTest::newRow("region outweighs module")
+        << QString::fromAscii("<voice lang=\"en_US\" outputModule=\"festival\"/>") << 3;
+}
+
+void TestTalkerMatcher::findClosest()
+{
+    QFETCH(QString, request);
+    QFETCH(int, winner);
+
+    TalkerMatcher matcher(configuredTalkers());
+    QCOMPARE(matcher.findClosest(request), winner);
+    QCOMPARE(TalkerCode::findClosestMatchingTalker(configuredTalkers(), request), winner);
+}
+
+void TestTalkerMatcher::noTalkers()
+{
+    TalkerMatcher matcher;
+    QCOMPARE(matcher.findClosest(QString::fromAscii("en")), -1);
+}
+
+void TestTalkerMatcher::benchmarkFindClosest()
+{
+    static const char * const languages[] = { "en", "de", "fr", "es", "it", "pl", "cs", "ru", "fi", "nl" };
+    static const char * const modules[] = { "espeak", "festival", "flite", "pico", "ibmtts" };
+    TalkerCode::TalkerCodeList list;
+    for (int ndx = 0; ndx < 1000; ++ndx)
+    {
+        list << talker(languages[ndx % 10], modules[(ndx / 10) % 5], 1 + ndx % 8);
+    }
+    TalkerMatcher matcher(list);
+    const QString request = QString::fromAscii("<voice lang=\"fr\" outputModule=\"pico\" voiceType=\"5\"/>");
+    int winner = -1;
+    QBENCHMARK {
+        winner = matcher.findClosest(request);
+    }
+    QVERIFY(winner >= 0);
+    QCOMPARE(list.at(winner).language(), QString::fromAscii("fr"));
+}
+
+QTEST_MAIN(TestTalkerMatcher)
+#include "testtalkermatcher.moc"
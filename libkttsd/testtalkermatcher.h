@@ -0,0 +1,17 @@
+#ifndef TESTTALKERMATCHER_H
+#define TESTTALKERMATCHER_H
+
+#include <QObject>
+
+class TestTalkerMatcher : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void findClosest_data();
+    void findClosest();
+    void noTalkers();
+    void benchmarkFindClosest();
+};
+
+#endif // TESTTALKERMATCHER_H